@@ -0,0 +1,260 @@
+#define _GNU_SOURCE
+#include "nizam_launch.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+
+static struct nizam_launch_stats launch_stats;
+static pid_t *launch_children;
+static size_t launch_child_count;
+static size_t launch_child_cap;
+static int launch_sigchld_installed;
+
+int64_t nizam_launch_now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void nizam_launch_free_argv(char **argv) {
+  if (!argv) {
+    return;
+  }
+  for (char **p = argv; *p; ++p) {
+    free(*p);
+  }
+  free(argv);
+}
+
+static int argv_push(char ***argv, int *argc, const char *word, size_t len) {
+  char **next = realloc(*argv, (size_t)(*argc + 2) * sizeof(**argv));
+  if (!next) {
+    return 0;
+  }
+  *argv = next;
+  next[*argc] = strndup(word, len);
+  if (!next[*argc]) {
+    next[*argc] = NULL;
+    return 0;
+  }
+  (*argc)++;
+  next[*argc] = NULL;
+  return 1;
+}
+
+int nizam_launch_split_exec(const char *exec, char ***out_argv) {
+  *out_argv = NULL;
+  if (!exec) {
+    return 0;
+  }
+  size_t cap = strlen(exec) + 1;
+  char *word = malloc(cap);
+  if (!word) {
+    return -1;
+  }
+  char **argv = NULL;
+  int argc = 0;
+  size_t len = 0;
+  int started = 0;
+  int quoted = 0;
+  int shell = 0;
+  const char *s = exec;
+  for (;; ++s) {
+    char c = *s;
+    if (quoted) {
+      if (c == '\0') {
+        shell = 1;
+        break;
+      }
+      if (c == '"') {
+        quoted = 0;
+      } else if (c == '\\' && s[1] && strchr("\"`$\\", s[1])) {
+        word[len++] = *++s;
+      } else if (c == '`' || c == '$') {
+        shell = 1;
+        break;
+      } else {
+        word[len++] = c;
+      }
+      continue;
+    }
+    if (c == '\0' || c == ' ' || c == '\t' || c == '\n') {
+      if (started) {
+        if (argc == 0 && memchr(word, '=', len)) {
+          shell = 1;
+          break;
+        }
+        if (!argv_push(&argv, &argc, word, len)) {
+          shell = 1;
+          break;
+        }
+      }
+      len = 0;
+      started = 0;
+      if (c == '\0') {
+        break;
+      }
+      continue;
+    }
+    if (c == '"') {
+      quoted = 1;
+      started = 1;
+      continue;
+    }
+    if (c == '%') {
+      if (s[1] == '%') {
+        word[len++] = '%';
+        started = 1;
+      }
+      if (s[1]) {
+        ++s;
+      }
+      continue;
+    }
+    if (strchr("'\\><|&;$*?()`", c) || (!started && (c == '~' || c == '#'))) {
+      shell = 1;
+      break;
+    }
+    word[len++] = c;
+    started = 1;
+  }
+  free(word);
+  if (shell) {
+    nizam_launch_free_argv(argv);
+    return -1;
+  }
+  *out_argv = argv;
+  return argc;
+}
+
+static void launch_on_sigchld(int sig) {
+  (void)sig;
+}
+
+static void launch_install_sigchld(void) {
+  if (launch_sigchld_installed) {
+    return;
+  }
+  launch_sigchld_installed = 1;
+  struct sigaction old;
+  if (sigaction(SIGCHLD, NULL, &old) != 0 || old.sa_handler != SIG_DFL) {
+    return;
+  }
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = launch_on_sigchld;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  sigaction(SIGCHLD, &sa, NULL);
+}
+
+static void launch_track(pid_t pid) {
+  if (launch_child_count == launch_child_cap) {
+    size_t next = launch_child_cap ? launch_child_cap * 2 : 8;
+    pid_t *children = realloc(launch_children, next * sizeof(*children));
+    if (!children) {
+      return;
+    }
+    launch_children = children;
+    launch_child_cap = next;
+  }
+  launch_children[launch_child_count++] = pid;
+}
+
+void nizam_launch_reap(void) {
+  size_t i = 0;
+  while (i < launch_child_count) {
+    pid_t r = waitpid(launch_children[i], NULL, WNOHANG);
+    if (r == 0 || (r < 0 && errno == EINTR)) {
+      i++;
+      continue;
+    }
+    launch_children[i] = launch_children[--launch_child_count];
+    if (r > 0) {
+      launch_stats.reaped++;
+    }
+  }
+}
+
+int nizam_launch_spawn(const char *exec, int64_t click_us, int flags) {
+  if (!exec || !*exec) {
+    return -1;
+  }
+  if (click_us <= 0) {
+    click_us = nizam_launch_now_us();
+  }
+  launch_install_sigchld();
+  nizam_launch_reap();
+
+  char **argv = NULL;
+  int argc = nizam_launch_split_exec(exec, &argv);
+  if (argc == 0) {
+    return -1;
+  }
+  char *sh_argv[] = {"sh", "-c", (char *)exec, NULL};
+  char *const *spawn_argv = argc > 0 ? argv : sh_argv;
+
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+  if (flags & NIZAM_LAUNCH_QUIET) {
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+  }
+  posix_spawnattr_init(&attr);
+  sigset_t mask;
+  sigemptyset(&mask);
+  posix_spawnattr_setsigmask(&attr, &mask);
+  sigfillset(&mask);
+  posix_spawnattr_setsigdefault(&attr, &mask);
+  short attr_flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+  attr_flags |= POSIX_SPAWN_SETSID;
+#endif
+  posix_spawnattr_setflags(&attr, attr_flags);
+
+  pid_t pid = -1;
+  int rc = argc > 0 ? posix_spawnp(&pid, spawn_argv[0], &actions, &attr, spawn_argv, environ)
+                    : posix_spawn(&pid, "/bin/sh", &actions, &attr, spawn_argv, environ);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  nizam_launch_free_argv(argv);
+
+  launch_stats.launches++;
+  if (rc != 0) {
+    launch_stats.failures++;
+    fprintf(stderr, "nizam: cannot launch \"%s\": %s\n", exec, strerror(rc));
+    return -1;
+  }
+  if (argc > 0) {
+    launch_stats.direct++;
+  } else {
+    launch_stats.shell++;
+  }
+  launch_track(pid);
+
+  int64_t latency = nizam_launch_now_us() - click_us;
+  launch_stats.last_us = latency;
+  launch_stats.total_us += latency;
+  if (latency > launch_stats.max_us) {
+    launch_stats.max_us = latency;
+  }
+  return (int)pid;
+}
+
+void nizam_launch_get_stats(struct nizam_launch_stats *out) {
+  if (out) {
+    *out = launch_stats;
+  }
+}
@@ -0,0 +1,27 @@
+#ifndef NIZAM_LAUNCH_H
+#define NIZAM_LAUNCH_H
+
+#include <stdint.h>
+
+#define NIZAM_LAUNCH_QUIET 1
+
+struct nizam_launch_stats {
+  uint64_t launches;
+  uint64_t direct;
+  uint64_t shell;
+  uint64_t failures;
+  uint64_t reaped;
+  int64_t last_us;
+  int64_t max_us;
+  int64_t total_us;
+};
+
+int nizam_launch_split_exec(const char *exec, char ***out_argv);
+void nizam_launch_free_argv(char **argv);
+
+int64_t nizam_launch_now_us(void);
+int nizam_launch_spawn(const char *exec, int64_t click_us, int flags);
+void nizam_launch_reap(void);
+void nizam_launch_get_stats(struct nizam_launch_stats *out);
+
+#endif
@@ -0,0 +1,144 @@
+#include "nizam_monitors.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void nizam_monitors_init(struct nizam_monitors *mons) {
+  memset(mons, 0, sizeof(*mons));
+}
+
+void nizam_monitors_free(struct nizam_monitors *mons) {
+  free(mons->items);
+  nizam_monitors_init(mons);
+}
+
+void nizam_monitors_begin(struct nizam_monitors *mons) {
+  mons->count = 0;
+  mons->valid = 1;
+  mons->refreshes++;
+}
+
+struct nizam_monitor *nizam_monitors_add(struct nizam_monitors *mons) {
+  if (mons->count == mons->cap) {
+    size_t next = mons->cap ? mons->cap * 2 : 4;
+    struct nizam_monitor *items = realloc(mons->items, next * sizeof(*items));
+    if (!items) {
+      return NULL;
+    }
+    mons->items = items;
+    mons->cap = next;
+  }
+  struct nizam_monitor *m = &mons->items[mons->count++];
+  memset(m, 0, sizeof(*m));
+  return m;
+}
+
+int nizam_monitors_at(const struct nizam_monitors *mons, int x, int y) {
+  for (size_t i = 0; i < mons->count; ++i) {
+    const struct nizam_monitor *m = &mons->items[i];
+    if (x >= m->x && x < m->x + m->w && y >= m->y && y < m->y + m->h) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+int nizam_monitors_primary(const struct nizam_monitors *mons) {
+  for (size_t i = 0; i < mons->count; ++i) {
+    if (mons->items[i].primary) {
+      return (int)i;
+    }
+  }
+  return mons->count > 0 ? 0 : -1;
+}
+
+static int monitors_find_n(const struct nizam_monitors *mons, const char *name, size_t len) {
+  if (len == 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < mons->count; ++i) {
+    const char *have = mons->items[i].name;
+    if (strlen(have) == len && strncmp(have, name, len) == 0) {
+      return (int)i;
+    }
+  }
+  size_t idx = 0;
+  for (size_t i = 0; i < len; ++i) {
+    if (name[i] < '0' || name[i] > '9') {
+      return -1;
+    }
+    idx = idx * 10 + (size_t)(name[i] - '0');
+    if (idx >= mons->count) {
+      return -1;
+    }
+  }
+  return (int)idx;
+}
+
+int nizam_monitors_find(const struct nizam_monitors *mons, const char *name) {
+  return name ? monitors_find_n(mons, name, strlen(name)) : -1;
+}
+
+int nizam_monitors_crtc_changed(struct nizam_monitors *mons, uint32_t crtc,
+                                int x, int y, int w, int h) {
+  for (size_t i = 0; i < mons->count; ++i) {
+    struct nizam_monitor *m = &mons->items[i];
+    if (m->crtc != crtc) {
+      continue;
+    }
+    if (w <= 0 || h <= 0) {
+      return -1;
+    }
+    if (m->x == x && m->y == y && m->w == w && m->h == h) {
+      return 0;
+    }
+    m->x = x;
+    m->y = y;
+    m->w = w;
+    m->h = h;
+    mons->crtc_updates++;
+    return 1;
+  }
+  return (w > 0 && h > 0) ? -1 : 0;
+}
+
+size_t nizam_monitors_select(const struct nizam_monitors *mons, const char *spec,
+                             int *out, size_t cap) {
+  if (mons->count == 0 || cap == 0) {
+    return 0;
+  }
+  if (!spec || !*spec || strcmp(spec, "primary") == 0) {
+    out[0] = nizam_monitors_primary(mons);
+    return 1;
+  }
+  char *picked = calloc(mons->count, 1);
+  if (!picked) {
+    return 0;
+  }
+  if (strcmp(spec, "all") == 0) {
+    memset(picked, 1, mons->count);
+  } else {
+    const char *s = spec;
+    while (*s) {
+      const char *end = strchr(s, ',');
+      size_t len = end ? (size_t)(end - s) : strlen(s);
+      int idx = (len == 7 && strncmp(s, "primary", 7) == 0) ? nizam_monitors_primary(mons)
+                                                             : monitors_find_n(mons, s, len);
+      if (idx >= 0) {
+        picked[idx] = 1;
+      }
+      if (!end) {
+        break;
+      }
+      s = end + 1;
+    }
+  }
+  size_t n = 0;
+  for (size_t i = 0; i < mons->count && n < cap; ++i) {
+    if (picked[i]) {
+      out[n++] = (int)i;
+    }
+  }
+  free(picked);
+  return n;
+}
@@ -0,0 +1,44 @@
+#ifndef NIZAM_MONITORS_H
+#define NIZAM_MONITORS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NIZAM_MONITOR_NAME_MAX 32
+
+struct nizam_monitor {
+  int x;
+  int y;
+  int w;
+  int h;
+  uint32_t crtc;
+  uint32_t output;
+  int primary;
+  char name[NIZAM_MONITOR_NAME_MAX];
+};
+
+struct nizam_monitors {
+  struct nizam_monitor *items;
+  size_t count;
+  size_t cap;
+  int valid;
+  uint64_t refreshes;
+  uint64_t crtc_updates;
+};
+
+void nizam_monitors_init(struct nizam_monitors *mons);
+void nizam_monitors_free(struct nizam_monitors *mons);
+void nizam_monitors_begin(struct nizam_monitors *mons);
+struct nizam_monitor *nizam_monitors_add(struct nizam_monitors *mons);
+
+int nizam_monitors_at(const struct nizam_monitors *mons, int x, int y);
+int nizam_monitors_primary(const struct nizam_monitors *mons);
+int nizam_monitors_find(const struct nizam_monitors *mons, const char *name);
+
+int nizam_monitors_crtc_changed(struct nizam_monitors *mons, uint32_t crtc,
+                                int x, int y, int w, int h);
+
+size_t nizam_monitors_select(const struct nizam_monitors *mons, const char *spec,
+                             int *out, size_t cap);
+
+#endif
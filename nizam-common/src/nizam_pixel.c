@@ -0,0 +1,511 @@
+#include "nizam_pixel.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define NIZAM_PIXEL_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define NIZAM_PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+struct nizam_pixel_impl {
+  const char *name;
+  void (*rgba)(uint32_t *dst, const uint8_t *src, size_t n);
+  void (*argb_be)(uint32_t *dst, const uint8_t *src, size_t n);
+  void (*premultiply)(uint32_t *dst, const uint32_t *src, size_t n);
+  void (*xrgb)(uint32_t *dst, const uint32_t *src, size_t n);
+  void (*downscale)(uint32_t *dst, int dst_w, int dst_h, int dst_stride,
+                    const uint32_t *src, int src_w, int src_h, int src_stride);
+};
+
+static inline uint32_t div255(uint32_t x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+static inline uint32_t pack_premul(uint32_t a, uint32_t r, uint32_t g, uint32_t b) {
+  if (a != 255) {
+    r = div255(r * a);
+    g = div255(g * a);
+    b = div255(b * a);
+  }
+  return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+static void rgba_scalar(uint32_t *dst, const uint8_t *src, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t *p = src + i * 4;
+    dst[i] = pack_premul(p[3], p[0], p[1], p[2]);
+  }
+}
+
+static void argb_be_scalar(uint32_t *dst, const uint8_t *src, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t *p = src + i * 4;
+    dst[i] = pack_premul(p[0], p[1], p[2], p[3]);
+  }
+}
+
+static void premultiply_scalar(uint32_t *dst, const uint32_t *src, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t v = src[i];
+    dst[i] = pack_premul(v >> 24, (v >> 16) & 0xff, (v >> 8) & 0xff, v & 0xff);
+  }
+}
+
+static void xrgb_scalar(uint32_t *dst, const uint32_t *src, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] = src[i] | 0xff000000u;
+  }
+}
+
+static inline void box_span(int i, int dst_len, int src_len, int *lo, int *hi) {
+  *lo = (int)((int64_t)i * src_len / dst_len);
+  *hi = (int)((int64_t)(i + 1) * src_len / dst_len);
+  if (*hi <= *lo) {
+    *hi = *lo + 1;
+  }
+}
+
+static inline uint32_t box_average(const uint32_t sum[4], uint32_t count) {
+  uint32_t half = count / 2;
+  return ((sum[3] + half) / count) << 24 |
+         ((sum[2] + half) / count) << 16 |
+         ((sum[1] + half) / count) << 8 |
+         ((sum[0] + half) / count);
+}
+
+static void downscale_scalar(uint32_t *dst, int dst_w, int dst_h, int dst_stride,
+                             const uint32_t *src, int src_w, int src_h, int src_stride) {
+  for (int y = 0; y < dst_h; ++y) {
+    int y0, y1;
+    box_span(y, dst_h, src_h, &y0, &y1);
+    for (int x = 0; x < dst_w; ++x) {
+      int x0, x1;
+      box_span(x, dst_w, src_w, &x0, &x1);
+      uint32_t sum[4] = {0, 0, 0, 0};
+      for (int sy = y0; sy < y1; ++sy) {
+        const uint32_t *row = src + (size_t)sy * (size_t)src_stride;
+        for (int sx = x0; sx < x1; ++sx) {
+          uint32_t v = row[sx];
+          sum[0] += v & 0xff;
+          sum[1] += (v >> 8) & 0xff;
+          sum[2] += (v >> 16) & 0xff;
+          sum[3] += v >> 24;
+        }
+      }
+      dst[(size_t)y * (size_t)dst_stride + x] =
+          box_average(sum, (uint32_t)((x1 - x0) * (y1 - y0)));
+    }
+  }
+}
+
+static const struct nizam_pixel_impl impl_scalar = {
+  "scalar",
+  rgba_scalar,
+  argb_be_scalar,
+  premultiply_scalar,
+  xrgb_scalar,
+  downscale_scalar,
+};
+
+#ifdef NIZAM_PIXEL_X86
+static inline __m128i premul16_sse2(__m128i px) {
+  const __m128i rgb_mask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+  const __m128i alpha_one = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+  __m128i alpha = _mm_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3));
+  alpha = _mm_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+  alpha = _mm_or_si128(_mm_and_si128(alpha, rgb_mask), alpha_one);
+  __m128i t = _mm_add_epi16(_mm_mullo_epi16(px, alpha), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void rgba_sse2(uint32_t *dst, const uint8_t *src, size_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 4));
+    __m128i lo = _mm_unpacklo_epi8(v, zero);
+    __m128i hi = _mm_unpackhi_epi8(v, zero);
+    lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+    hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(premul16_sse2(lo), premul16_sse2(hi)));
+  }
+  rgba_scalar(dst + i, src + i * 4, n - i);
+}
+
+static void argb_be_sse2(uint32_t *dst, const uint8_t *src, size_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 4));
+    __m128i lo = _mm_unpacklo_epi8(v, zero);
+    __m128i hi = _mm_unpackhi_epi8(v, zero);
+    lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+    hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(premul16_sse2(lo), premul16_sse2(hi)));
+  }
+  argb_be_scalar(dst + i, src + i * 4, n - i);
+}
+
+static void premultiply_sse2(uint32_t *dst, const uint32_t *src, size_t n) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i lo = premul16_sse2(_mm_unpacklo_epi8(v, zero));
+    __m128i hi = premul16_sse2(_mm_unpackhi_epi8(v, zero));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+  }
+  premultiply_scalar(dst + i, src + i, n - i);
+}
+
+static void xrgb_sse2(uint32_t *dst, const uint32_t *src, size_t n) {
+  const __m128i opaque = _mm_set1_epi32((int)0xff000000u);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(v, opaque));
+  }
+  xrgb_scalar(dst + i, src + i, n - i);
+}
+
+static inline __m128i fold16_sse2(__m128i acc, __m128i acc16) {
+  const __m128i zero = _mm_setzero_si128();
+  return _mm_add_epi32(acc, _mm_add_epi32(_mm_unpacklo_epi16(acc16, zero),
+                                          _mm_unpackhi_epi16(acc16, zero)));
+}
+
+static void downscale_sse2(uint32_t *dst, int dst_w, int dst_h, int dst_stride,
+                           const uint32_t *src, int src_w, int src_h, int src_stride) {
+  const __m128i zero = _mm_setzero_si128();
+  for (int y = 0; y < dst_h; ++y) {
+    int y0, y1;
+    box_span(y, dst_h, src_h, &y0, &y1);
+    for (int x = 0; x < dst_w; ++x) {
+      int x0, x1;
+      box_span(x, dst_w, src_w, &x0, &x1);
+      int len = x1 - x0;
+      __m128i acc = zero;
+      __m128i acc16 = zero;
+      int lane_px = 0;
+      for (int sy = y0; sy < y1; ++sy) {
+        const uint32_t *row = src + (size_t)sy * (size_t)src_stride + x0;
+        int sx = 0;
+        for (; sx + 4 <= len; sx += 4) {
+          if (lane_px > 254) {
+            acc = fold16_sse2(acc, acc16);
+            acc16 = zero;
+            lane_px = 0;
+          }
+          __m128i four = _mm_loadu_si128((const __m128i *)(row + sx));
+          acc16 = _mm_add_epi16(acc16, _mm_add_epi16(_mm_unpacklo_epi8(four, zero),
+                                                     _mm_unpackhi_epi8(four, zero)));
+          lane_px += 2;
+        }
+        if (lane_px > 254) {
+          acc = fold16_sse2(acc, acc16);
+          acc16 = zero;
+          lane_px = 0;
+        }
+        if (sx + 2 <= len) {
+          __m128i two = _mm_loadl_epi64((const __m128i *)(row + sx));
+          acc16 = _mm_add_epi16(acc16, _mm_unpacklo_epi8(two, zero));
+          sx += 2;
+        }
+        if (sx < len) {
+          __m128i one = _mm_cvtsi32_si128((int)row[sx]);
+          acc16 = _mm_add_epi16(acc16, _mm_unpacklo_epi8(one, zero));
+        }
+        lane_px += 2;
+      }
+      acc = fold16_sse2(acc, acc16);
+      uint32_t sum[4];
+      _mm_storeu_si128((__m128i *)sum, acc);
+      dst[(size_t)y * (size_t)dst_stride + x] =
+          box_average(sum, (uint32_t)(len * (y1 - y0)));
+    }
+  }
+}
+
+static const struct nizam_pixel_impl impl_sse2 = {
+  "sse2",
+  rgba_sse2,
+  argb_be_sse2,
+  premultiply_sse2,
+  xrgb_sse2,
+  downscale_sse2,
+};
+
+__attribute__((target("avx2")))
+static inline __m256i premul16_avx2(__m256i px) {
+  const __m256i rgb_mask = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1,
+                                            0, -1, -1, -1, 0, -1, -1, -1);
+  const __m256i alpha_one = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0,
+                                             255, 0, 0, 0, 255, 0, 0, 0);
+  __m256i alpha = _mm256_shufflelo_epi16(px, _MM_SHUFFLE(3, 3, 3, 3));
+  alpha = _mm256_shufflehi_epi16(alpha, _MM_SHUFFLE(3, 3, 3, 3));
+  alpha = _mm256_or_si256(_mm256_and_si256(alpha, rgb_mask), alpha_one);
+  __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(px, alpha), _mm256_set1_epi16(128));
+  return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+__attribute__((target("avx2")))
+static void rgba_avx2(uint32_t *dst, const uint8_t *src, size_t n) {
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+    __m256i lo = _mm256_unpacklo_epi8(v, zero);
+    __m256i hi = _mm256_unpackhi_epi8(v, zero);
+    lo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+    hi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(premul16_avx2(lo), premul16_avx2(hi)));
+  }
+  rgba_sse2(dst + i, src + i * 4, n - i);
+}
+
+__attribute__((target("avx2")))
+static void argb_be_avx2(uint32_t *dst, const uint8_t *src, size_t n) {
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+    __m256i lo = _mm256_unpacklo_epi8(v, zero);
+    __m256i hi = _mm256_unpackhi_epi8(v, zero);
+    lo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+    hi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(premul16_avx2(lo), premul16_avx2(hi)));
+  }
+  argb_be_sse2(dst + i, src + i * 4, n - i);
+}
+
+__attribute__((target("avx2")))
+static void premultiply_avx2(uint32_t *dst, const uint32_t *src, size_t n) {
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i lo = premul16_avx2(_mm256_unpacklo_epi8(v, zero));
+    __m256i hi = premul16_avx2(_mm256_unpackhi_epi8(v, zero));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+  premultiply_sse2(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void xrgb_avx2(uint32_t *dst, const uint32_t *src, size_t n) {
+  const __m256i opaque = _mm256_set1_epi32((int)0xff000000u);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(v, opaque));
+  }
+  xrgb_sse2(dst + i, src + i, n - i);
+}
+
+static const struct nizam_pixel_impl impl_avx2 = {
+  "avx2",
+  rgba_avx2,
+  argb_be_avx2,
+  premultiply_avx2,
+  xrgb_avx2,
+  downscale_sse2,
+};
+#endif
+
+#ifdef NIZAM_PIXEL_NEON
+static inline uint8x8_t mul_div255_neon(uint8x8_t c, uint8x8_t a) {
+  uint16x8_t p = vmull_u8(c, a);
+  return vraddhn_u16(p, vrshrq_n_u16(p, 8));
+}
+
+static void rgba_neon(uint32_t *dst, const uint8_t *src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint8x8x4_t v = vld4_u8(src + i * 4);
+    uint8x8x4_t o;
+    o.val[0] = mul_div255_neon(v.val[2], v.val[3]);
+    o.val[1] = mul_div255_neon(v.val[1], v.val[3]);
+    o.val[2] = mul_div255_neon(v.val[0], v.val[3]);
+    o.val[3] = v.val[3];
+    vst4_u8((uint8_t *)(dst + i), o);
+  }
+  rgba_scalar(dst + i, src + i * 4, n - i);
+}
+
+static void argb_be_neon(uint32_t *dst, const uint8_t *src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint8x8x4_t v = vld4_u8(src + i * 4);
+    uint8x8x4_t o;
+    o.val[0] = mul_div255_neon(v.val[3], v.val[0]);
+    o.val[1] = mul_div255_neon(v.val[2], v.val[0]);
+    o.val[2] = mul_div255_neon(v.val[1], v.val[0]);
+    o.val[3] = v.val[0];
+    vst4_u8((uint8_t *)(dst + i), o);
+  }
+  argb_be_scalar(dst + i, src + i * 4, n - i);
+}
+
+static void premultiply_neon(uint32_t *dst, const uint32_t *src, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint8x8x4_t v = vld4_u8((const uint8_t *)(src + i));
+    uint8x8x4_t o;
+    o.val[0] = mul_div255_neon(v.val[0], v.val[3]);
+    o.val[1] = mul_div255_neon(v.val[1], v.val[3]);
+    o.val[2] = mul_div255_neon(v.val[2], v.val[3]);
+    o.val[3] = v.val[3];
+    vst4_u8((uint8_t *)(dst + i), o);
+  }
+  premultiply_scalar(dst + i, src + i, n - i);
+}
+
+static void xrgb_neon(uint32_t *dst, const uint32_t *src, size_t n) {
+  const uint32x4_t opaque = vdupq_n_u32(0xff000000u);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    vst1q_u32(dst + i, vorrq_u32(vld1q_u32(src + i), opaque));
+  }
+  xrgb_scalar(dst + i, src + i, n - i);
+}
+
+static void downscale_neon(uint32_t *dst, int dst_w, int dst_h, int dst_stride,
+                           const uint32_t *src, int src_w, int src_h, int src_stride) {
+  for (int y = 0; y < dst_h; ++y) {
+    int y0, y1;
+    box_span(y, dst_h, src_h, &y0, &y1);
+    for (int x = 0; x < dst_w; ++x) {
+      int x0, x1;
+      box_span(x, dst_w, src_w, &x0, &x1);
+      int len = x1 - x0;
+      uint32x4_t acc = vdupq_n_u32(0);
+      for (int sy = y0; sy < y1; ++sy) {
+        const uint32_t *row = src + (size_t)sy * (size_t)src_stride + x0;
+        int sx = 0;
+        while (sx + 2 <= len) {
+          int end = sx + 512 < len ? sx + 512 : len;
+          uint16x8_t acc16 = vdupq_n_u16(0);
+          for (; sx + 2 <= end; sx += 2) {
+            acc16 = vaddw_u8(acc16, vld1_u8((const uint8_t *)(row + sx)));
+          }
+          acc = vaddq_u32(acc, vaddl_u16(vget_low_u16(acc16), vget_high_u16(acc16)));
+        }
+        if (sx < len) {
+          uint16x8_t one = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(row[sx])));
+          acc = vaddw_u16(acc, vget_low_u16(one));
+        }
+      }
+      uint32_t sum[4];
+      vst1q_u32(sum, acc);
+      dst[(size_t)y * (size_t)dst_stride + x] =
+          box_average(sum, (uint32_t)(len * (y1 - y0)));
+    }
+  }
+}
+
+static const struct nizam_pixel_impl impl_neon = {
+  "neon",
+  rgba_neon,
+  argb_be_neon,
+  premultiply_neon,
+  xrgb_neon,
+  downscale_neon,
+};
+#endif
+
+static const struct nizam_pixel_impl *const impls[] = {
+  &impl_scalar,
+#ifdef NIZAM_PIXEL_X86
+  &impl_sse2,
+  &impl_avx2,
+#endif
+#ifdef NIZAM_PIXEL_NEON
+  &impl_neon,
+#endif
+};
+
+static const struct nizam_pixel_impl *active_impl;
+
+static int impl_supported(const struct nizam_pixel_impl *impl) {
+#ifdef NIZAM_PIXEL_X86
+  if (impl == &impl_avx2) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+  }
+#endif
+  (void)impl;
+  return 1;
+}
+
+static const struct nizam_pixel_impl *pixel_impl(void) {
+  if (active_impl) {
+    return active_impl;
+  }
+  const char *env = getenv("NIZAM_PIXEL_IMPL");
+  if (env && *env && nizam_pixel_select(env)) {
+    return active_impl;
+  }
+  const struct nizam_pixel_impl *best = &impl_scalar;
+  for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); ++i) {
+    if (impl_supported(impls[i])) {
+      best = impls[i];
+    }
+  }
+  active_impl = best;
+  return active_impl;
+}
+
+int nizam_pixel_select(const char *name) {
+  if (!name) {
+    return 0;
+  }
+  for (size_t i = 0; i < sizeof(impls) / sizeof(impls[0]); ++i) {
+    if (strcmp(impls[i]->name, name) == 0 && impl_supported(impls[i])) {
+      active_impl = impls[i];
+      return 1;
+    }
+  }
+  return 0;
+}
+
+const char *nizam_pixel_impl_name(void) {
+  return pixel_impl()->name;
+}
+
+void nizam_pixel_rgba_to_argb32(uint32_t *dst, const uint8_t *src, size_t n) {
+  pixel_impl()->rgba(dst, src, n);
+}
+
+void nizam_pixel_rgb_to_argb32(uint32_t *dst, const uint8_t *src, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const uint8_t *p = src + i * 3;
+    dst[i] = 0xff000000u | (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+  }
+}
+
+void nizam_pixel_argb_be_to_argb32(uint32_t *dst, const uint8_t *src, size_t n) {
+  pixel_impl()->argb_be(dst, src, n);
+}
+
+void nizam_pixel_premultiply_argb32(uint32_t *dst, const uint32_t *src, size_t n) {
+  pixel_impl()->premultiply(dst, src, n);
+}
+
+void nizam_pixel_xrgb_to_argb32(uint32_t *dst, const uint32_t *src, size_t n) {
+  pixel_impl()->xrgb(dst, src, n);
+}
+
+void nizam_pixel_downscale_box(uint32_t *dst, int dst_w, int dst_h, int dst_stride,
+                               const uint32_t *src, int src_w, int src_h, int src_stride) {
+  if (!dst || !src || dst_w <= 0 || dst_h <= 0 || src_w <= 0 || src_h <= 0) {
+    return;
+  }
+  pixel_impl()->downscale(dst, dst_w, dst_h, dst_stride, src, src_w, src_h, src_stride);
+}
@@ -0,0 +1,18 @@
+#ifndef NIZAM_PIXEL_H
+#define NIZAM_PIXEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+void nizam_pixel_rgba_to_argb32(uint32_t *dst, const uint8_t *src, size_t n);
+void nizam_pixel_rgb_to_argb32(uint32_t *dst, const uint8_t *src, size_t n);
+void nizam_pixel_argb_be_to_argb32(uint32_t *dst, const uint8_t *src, size_t n);
+void nizam_pixel_premultiply_argb32(uint32_t *dst, const uint32_t *src, size_t n);
+void nizam_pixel_xrgb_to_argb32(uint32_t *dst, const uint32_t *src, size_t n);
+void nizam_pixel_downscale_box(uint32_t *dst, int dst_w, int dst_h, int dst_stride,
+                               const uint32_t *src, int src_w, int src_h, int src_stride);
+
+const char *nizam_pixel_impl_name(void);
+int nizam_pixel_select(const char *name);
+
+#endif
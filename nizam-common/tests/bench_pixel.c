@@ -0,0 +1,73 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "nizam_pixel.h"
+
+#define BENCH_W 256
+#define BENCH_H 256
+#define BENCH_ROUNDS 200
+
+static const char *const impl_names[] = {"scalar", "sse2", "avx2", "neon"};
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void report(const char *impl, const char *kernel, double seconds, double pixels) {
+  printf("%-6s %-10s %8.1f MPix/s\n", impl, kernel, pixels / seconds / 1e6);
+}
+
+int main(void) {
+  size_t n = (size_t)BENCH_W * BENCH_H;
+  uint8_t *bytes = malloc(n * 4);
+  uint32_t *words = malloc(n * 4);
+  uint32_t *out = malloc(n * 4);
+  uint32_t small[48 * 48];
+  if (!bytes || !words || !out) {
+    return 1;
+  }
+  for (size_t i = 0; i < n * 4; ++i) {
+    bytes[i] = (uint8_t)(i * 2654435761u >> 24);
+  }
+  for (size_t i = 0; i < n; ++i) {
+    words[i] = (uint32_t)(i * 2654435761u);
+  }
+
+  for (size_t k = 0; k < sizeof(impl_names) / sizeof(impl_names[0]); ++k) {
+    if (!nizam_pixel_select(impl_names[k])) {
+      continue;
+    }
+    double t0 = now_s();
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+      nizam_pixel_rgba_to_argb32(out, bytes, n);
+    }
+    report(impl_names[k], "rgba", now_s() - t0, (double)n * BENCH_ROUNDS);
+
+    t0 = now_s();
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+      nizam_pixel_argb_be_to_argb32(out, bytes, n);
+    }
+    report(impl_names[k], "argb_be", now_s() - t0, (double)n * BENCH_ROUNDS);
+
+    t0 = now_s();
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+      nizam_pixel_premultiply_argb32(out, words, n);
+    }
+    report(impl_names[k], "premul", now_s() - t0, (double)n * BENCH_ROUNDS);
+
+    t0 = now_s();
+    for (int r = 0; r < BENCH_ROUNDS; ++r) {
+      nizam_pixel_downscale_box(small, 48, 48, 48, words, BENCH_W, BENCH_H, BENCH_W);
+    }
+    report(impl_names[k], "downscale", now_s() - t0, (double)n * BENCH_ROUNDS);
+  }
+
+  free(bytes);
+  free(words);
+  free(out);
+  return 0;
+}
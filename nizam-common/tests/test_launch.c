@@ -0,0 +1,43 @@
+#include <assert.h>
+#include <string.h>
+
+#include "nizam_launch.h"
+
+static void expect_argv(const char *exec, const char *const *want, int want_argc) {
+  char **argv = NULL;
+  int argc = nizam_launch_split_exec(exec, &argv);
+  assert(argc == want_argc);
+  for (int i = 0; i < want_argc; ++i) {
+    assert(strcmp(argv[i], want[i]) == 0);
+  }
+  if (want_argc > 0) {
+    assert(argv[want_argc] == NULL);
+  }
+  nizam_launch_free_argv(argv);
+}
+
+int main(void) {
+  const char *plain[] = {"firefox", "--new-window"};
+  expect_argv("firefox --new-window %u", plain, 2);
+
+  const char *quoted[] = {"/opt/My App/app", "a \"b\" $c \\d"};
+  expect_argv("\"/opt/My App/app\" \"a \\\"b\\\" \\$c \\\\d\" %F", quoted, 2);
+
+  const char *percent[] = {"env", "LANG=C", "printf", "100%"};
+  expect_argv("env LANG=C printf 100%% %i %c %k", percent, 4);
+
+  expect_argv("  %U  ", NULL, 0);
+  expect_argv("sh -c 'echo hi'", NULL, -1);
+  expect_argv("FOO=1 app", NULL, -1);
+  expect_argv("app > /tmp/log", NULL, -1);
+  expect_argv("app ~/file", NULL, -1);
+  expect_argv("\"unterminated", NULL, -1);
+
+  int pid = nizam_launch_spawn("true %U", 0, NIZAM_LAUNCH_QUIET);
+  assert(pid > 0);
+  struct nizam_launch_stats stats;
+  nizam_launch_get_stats(&stats);
+  assert(stats.launches == 1 && stats.direct == 1 && stats.failures == 0);
+  assert(stats.last_us >= 0);
+  return 0;
+}
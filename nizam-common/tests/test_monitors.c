@@ -0,0 +1,68 @@
+#include <assert.h>
+#include <string.h>
+
+#include "nizam_monitors.h"
+
+static void add(struct nizam_monitors *mons, const char *name, int x, int y, int w, int h,
+                uint32_t crtc, int primary) {
+  struct nizam_monitor *m = nizam_monitors_add(mons);
+  assert(m);
+  m->x = x;
+  m->y = y;
+  m->w = w;
+  m->h = h;
+  m->crtc = crtc;
+  m->primary = primary;
+  strcpy(m->name, name);
+}
+
+int main(void) {
+  struct nizam_monitors mons;
+  nizam_monitors_init(&mons);
+  int out[8];
+
+  assert(nizam_monitors_primary(&mons) == -1);
+  assert(nizam_monitors_select(&mons, "all", out, 8) == 0);
+
+  nizam_monitors_begin(&mons);
+  add(&mons, "eDP-1", 0, 0, 1920, 1080, 10, 0);
+  add(&mons, "HDMI-1", 1920, 0, 2560, 1440, 11, 1);
+  add(&mons, "DP-2", 4480, 0, 1280, 1024, 12, 0);
+  assert(mons.valid && mons.count == 3 && mons.refreshes == 1);
+
+  assert(nizam_monitors_at(&mons, 0, 0) == 0);
+  assert(nizam_monitors_at(&mons, 1919, 1079) == 0);
+  assert(nizam_monitors_at(&mons, 1920, 0) == 1);
+  assert(nizam_monitors_at(&mons, 4480, 1100) == -1);
+  assert(nizam_monitors_primary(&mons) == 1);
+
+  assert(nizam_monitors_find(&mons, "DP-2") == 2);
+  assert(nizam_monitors_find(&mons, "0") == 0);
+  assert(nizam_monitors_find(&mons, "3") == -1);
+  assert(nizam_monitors_find(&mons, "DP") == -1);
+  assert(nizam_monitors_find(&mons, NULL) == -1);
+
+  assert(nizam_monitors_select(&mons, NULL, out, 8) == 1 && out[0] == 1);
+  assert(nizam_monitors_select(&mons, "", out, 8) == 1 && out[0] == 1);
+  assert(nizam_monitors_select(&mons, "all", out, 8) == 3);
+  assert(out[0] == 0 && out[1] == 1 && out[2] == 2);
+  assert(nizam_monitors_select(&mons, "all", out, 2) == 2);
+  assert(nizam_monitors_select(&mons, "DP-2,primary,HDMI-1,bogus", out, 8) == 2);
+  assert(out[0] == 1 && out[1] == 2);
+  assert(nizam_monitors_select(&mons, "2,,0", out, 8) == 2);
+  assert(out[0] == 0 && out[1] == 2);
+  assert(nizam_monitors_select(&mons, "VGA-1", out, 8) == 0);
+
+  assert(nizam_monitors_crtc_changed(&mons, 11, 1920, 0, 2560, 1440) == 0);
+  assert(nizam_monitors_crtc_changed(&mons, 11, 1920, 0, 1920, 1080) == 1);
+  assert(mons.items[1].w == 1920 && mons.crtc_updates == 1);
+  assert(nizam_monitors_crtc_changed(&mons, 12, 0, 0, 0, 0) == -1);
+  assert(nizam_monitors_crtc_changed(&mons, 99, 0, 0, 0, 0) == 0);
+  assert(nizam_monitors_crtc_changed(&mons, 99, 0, 1080, 800, 600) == -1);
+
+  nizam_monitors_begin(&mons);
+  assert(mons.count == 0 && mons.refreshes == 2);
+  nizam_monitors_free(&mons);
+  assert(mons.items == NULL && mons.count == 0);
+  return 0;
+}
@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nizam_pixel.h"
+
+static const char *const impl_names[] = {"scalar", "sse2", "avx2", "neon"};
+
+static uint32_t rng_state = 0x12345678u;
+
+static uint32_t rng_next(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static void fill_random(void *buf, size_t bytes) {
+  uint8_t *p = buf;
+  for (size_t i = 0; i < bytes; ++i) {
+    uint32_t r = rng_next();
+    p[i] = (r & 0x300) == 0 ? 0 : (r & 0x300) == 0x100 ? 255 : (uint8_t)r;
+  }
+}
+
+struct pixel_outputs {
+  uint32_t rgba[1037];
+  uint32_t argb_be[1037];
+  uint32_t premul[1037];
+  uint32_t premul_inplace[1037];
+  uint32_t xrgb[1037];
+  uint32_t down_a[24 * 24];
+  uint32_t down_b[7 * 5];
+  uint32_t down_c[3];
+};
+
+static uint8_t bytes_in[1037 * 4];
+static uint32_t words_in[1037];
+static uint32_t image[97 * 61];
+static uint32_t white[97 * 61];
+
+static void run_kernels(struct pixel_outputs *out) {
+  size_t n = sizeof(words_in) / sizeof(words_in[0]);
+  nizam_pixel_rgba_to_argb32(out->rgba, bytes_in, n);
+  nizam_pixel_argb_be_to_argb32(out->argb_be, bytes_in, n);
+  nizam_pixel_premultiply_argb32(out->premul, words_in, n);
+  memcpy(out->premul_inplace, words_in, sizeof(words_in));
+  nizam_pixel_premultiply_argb32(out->premul_inplace, out->premul_inplace, n);
+  nizam_pixel_xrgb_to_argb32(out->xrgb, words_in, n);
+  nizam_pixel_downscale_box(out->down_a, 24, 24, 24, image, 96, 60, 97);
+  nizam_pixel_downscale_box(out->down_b, 7, 5, 7, image, 97, 61, 97);
+  nizam_pixel_downscale_box(out->down_c, 1, 1, 1, image, 97, 61, 97);
+  nizam_pixel_downscale_box(out->down_c + 1, 1, 1, 1, image, 95, 61, 97);
+  nizam_pixel_downscale_box(out->down_c + 2, 1, 1, 1, white, 97, 61, 97);
+}
+
+int main(void) {
+  assert(nizam_pixel_select("scalar"));
+  for (uint32_t a = 0; a < 256; ++a) {
+    for (uint32_t c = 0; c < 256; ++c) {
+      uint8_t px[4] = {(uint8_t)c, (uint8_t)c, (uint8_t)c, (uint8_t)a};
+      uint32_t out = 0;
+      nizam_pixel_rgba_to_argb32(&out, px, 1);
+      uint32_t p = (c * a + 127) / 255;
+      assert(out == (a << 24 | p << 16 | p << 8 | p));
+    }
+  }
+
+  uint8_t rgb[6] = {1, 2, 3, 250, 251, 252};
+  uint32_t opaque[2];
+  nizam_pixel_rgb_to_argb32(opaque, rgb, 2);
+  assert(opaque[0] == 0xff010203u && opaque[1] == 0xfffafbfcu);
+
+  uint32_t flat[4 * 4];
+  for (int i = 0; i < 16; ++i) {
+    flat[i] = 0x80402010u;
+  }
+  uint32_t one = 0;
+  nizam_pixel_downscale_box(&one, 1, 1, 1, flat, 4, 4, 4);
+  assert(one == 0x80402010u);
+
+  fill_random(bytes_in, sizeof(bytes_in));
+  fill_random(words_in, sizeof(words_in));
+  fill_random(image, sizeof(image));
+  memset(white, 0xff, sizeof(white));
+
+  struct pixel_outputs *ref = calloc(1, sizeof(*ref));
+  struct pixel_outputs *got = calloc(1, sizeof(*got));
+  assert(ref && got);
+  run_kernels(ref);
+  assert(ref->down_c[2] == 0xffffffffu);
+  assert(memcmp(ref->premul, ref->premul_inplace, sizeof(ref->premul)) == 0);
+
+  for (size_t i = 1; i < sizeof(impl_names) / sizeof(impl_names[0]); ++i) {
+    if (!nizam_pixel_select(impl_names[i])) {
+      continue;
+    }
+    memset(got, 0, sizeof(*got));
+    run_kernels(got);
+    assert(memcmp(ref, got, sizeof(*ref)) == 0);
+    printf("nizam_pixel: %s matches scalar\n", impl_names[i]);
+  }
+
+  free(ref);
+  free(got);
+  return 0;
+}
@@ -5,8 +5,15 @@
 #include "xcb_app.h"
 
 int nizam_dock_icons_init(struct nizam_dock_app *app, const struct nizam_dock_config *cfg);
+void nizam_dock_icons_retain(struct nizam_dock_app *app, const struct nizam_dock_config *cfg);
 void nizam_dock_icons_free(struct nizam_dock_app *app);
 int nizam_dock_sysinfo_init(struct nizam_dock_app *app);
 int nizam_dock_draw(struct nizam_dock_app *app, const struct nizam_dock_config *cfg);
+void nizam_dock_layers_invalidate(struct nizam_dock_app *app);
+void nizam_dock_layers_free(struct nizam_dock_app *app);
+void nizam_dock_damage_rect(struct nizam_dock_app *app, int x, int y, int w, int h);
+void nizam_dock_damage_all(struct nizam_dock_app *app);
+void nizam_dock_damage_launcher(struct nizam_dock_app *app, int idx);
+void nizam_dock_damage_tray(struct nizam_dock_app *app);
 
 #endif
@@ -7,6 +7,7 @@ struct nizam_dock_launcher {
   char *icon;
   char *cmd;
   char *category;
+  char *desktop_id;
 };
 
 struct nizam_dock_config {
@@ -33,5 +34,6 @@ void nizam_dock_config_free(struct nizam_dock_config *cfg);
 
 
 int nizam_dock_config_load_launchers(struct nizam_dock_config *cfg);
+int nizam_dock_config_reload_launchers(struct nizam_dock_config *cfg);
 
 #endif
@@ -1,6 +1,7 @@
 #ifndef NIZAM_DOCK_ICON_SURFACE_CACHE_H
 #define NIZAM_DOCK_ICON_SURFACE_CACHE_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct _cairo_surface cairo_surface_t;
@@ -11,6 +12,7 @@ struct nizam_dock_icon_cache_stats {
   uint64_t misses;
   uint64_t evictions;
   uint64_t alive_surfaces;
+  uint64_t uploads;
   int size;
   int capacity;
   int icon_px;
@@ -20,8 +22,14 @@ struct nizam_dock_icon_cache_stats {
 struct nizam_dock_icon_cache *nizam_dock_icon_cache_new(int capacity, int icon_px, int scale);
 void nizam_dock_icon_cache_free(struct nizam_dock_icon_cache *cache);
 void nizam_dock_icon_cache_clear(struct nizam_dock_icon_cache *cache);
+void nizam_dock_icon_cache_set_target(struct nizam_dock_icon_cache *cache,
+                                      cairo_surface_t *target);
+int nizam_dock_icon_surface_size(cairo_surface_t *surface, int *w, int *h);
 cairo_surface_t *nizam_dock_icon_cache_get(struct nizam_dock_icon_cache *cache,
                                            const char *icon_name_or_path);
+void nizam_dock_icon_cache_retain(struct nizam_dock_icon_cache *cache,
+                                  const char *const *names,
+                                  size_t count);
 void nizam_dock_icon_cache_get_stats(const struct nizam_dock_icon_cache *cache,
                                      struct nizam_dock_icon_cache_stats *out);
 
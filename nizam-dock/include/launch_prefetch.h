@@ -0,0 +1,26 @@
+#ifndef NIZAM_DOCK_LAUNCH_PREFETCH_H
+#define NIZAM_DOCK_LAUNCH_PREFETCH_H
+
+#include <stdint.h>
+
+#define NIZAM_DOCK_PREFETCH_DWELL_MS 100
+
+struct nizam_dock_prefetch;
+
+struct nizam_dock_prefetch_stats {
+  uint64_t requests;
+  uint64_t files;
+  uint64_t bytes;
+  uint64_t launches;
+  uint64_t launches_warm;
+  uint64_t launches_partial;
+};
+
+struct nizam_dock_prefetch *nizam_dock_prefetch_new(void);
+void nizam_dock_prefetch_free(struct nizam_dock_prefetch *prefetch);
+void nizam_dock_prefetch_request(struct nizam_dock_prefetch *prefetch, const char *cmd);
+void nizam_dock_prefetch_note_launch(struct nizam_dock_prefetch *prefetch, const char *cmd);
+void nizam_dock_prefetch_get_stats(struct nizam_dock_prefetch *prefetch,
+                                   struct nizam_dock_prefetch_stats *out);
+
+#endif
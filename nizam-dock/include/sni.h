@@ -12,6 +12,7 @@ int nizam_dock_sni_init(struct nizam_dock_app *app);
 void nizam_dock_sni_cleanup(struct nizam_dock_app *app);
 int nizam_dock_sni_get_fd(const struct nizam_dock_app *app);
 int nizam_dock_sni_process(struct nizam_dock_app *app);
+int nizam_dock_sni_timeout_ms(const struct nizam_dock_app *app);
 size_t nizam_dock_sni_count(const struct nizam_dock_app *app);
 cairo_surface_t *nizam_dock_sni_icon(const struct nizam_dock_app *app, size_t idx);
 const char *nizam_dock_resolve_icon_path(const char *name, char *out, size_t out_size);
@@ -26,8 +27,9 @@ int nizam_dock_sni_item_has_context(const struct nizam_dock_app *app, size_t idx
 int nizam_dock_sni_item_has_xayatana_secondary(const struct nizam_dock_app *app, size_t idx);
 int nizam_dock_sni_item_is_menu(const struct nizam_dock_app *app, size_t idx);
 int nizam_dock_sni_item_has_menu(const struct nizam_dock_app *app, size_t idx);
-int nizam_dock_sni_menu_fetch(struct nizam_dock_app *app, size_t idx,
-                            struct nizam_dock_menu_item **items, size_t *count);
+int nizam_dock_sni_menu_request(struct nizam_dock_app *app, size_t idx);
+int nizam_dock_sni_menu_take(struct nizam_dock_app *app, size_t *idx,
+                             struct nizam_dock_menu_item **items, size_t *count);
 int nizam_dock_sni_menu_event(struct nizam_dock_app *app, size_t idx, int32_t item_id, uint32_t time);
 
 #endif
@@ -0,0 +1,27 @@
+#ifndef NIZAM_DOCK_TEXT_CACHE_H
+#define NIZAM_DOCK_TEXT_CACHE_H
+
+#include <stdint.h>
+
+#define NIZAM_DOCK_TEXT_CACHE_CAP 128
+
+typedef struct _cairo cairo_t;
+struct nizam_dock_text_cache;
+
+struct nizam_dock_text_cache_stats {
+  uint64_t hits;
+  uint64_t misses;
+  int size;
+  int capacity;
+};
+
+struct nizam_dock_text_cache *nizam_dock_text_cache_new(int capacity);
+void nizam_dock_text_cache_free(struct nizam_dock_text_cache *cache);
+void nizam_dock_text_cache_clear(struct nizam_dock_text_cache *cache);
+int nizam_dock_text_draw(struct nizam_dock_text_cache *cache, cairo_t *cr,
+                         const char *family, int bold, double px,
+                         double x, double y, const char *text);
+void nizam_dock_text_cache_get_stats(const struct nizam_dock_text_cache *cache,
+                                     struct nizam_dock_text_cache_stats *out);
+
+#endif
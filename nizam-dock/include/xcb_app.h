@@ -5,9 +5,12 @@
 #include <xcb/xcb.h>
 
 #include "config.h"
+#include "nizam_monitors.h"
 
 struct nizam_dock_sni;
 struct nizam_dock_icon_cache;
+struct nizam_dock_text_cache;
+struct nizam_dock_prefetch;
 
 #define NIZAM_DOCK_INFO_LINES 3
 #define NIZAM_DOCK_INFO_LINE_HEIGHT 14
@@ -15,6 +18,9 @@ struct nizam_dock_icon_cache;
 #define NIZAM_DOCK_INFO_TOP_GAP 10
 #define NIZAM_DOCK_INFO_MAX_WIDTH 220
 #define NIZAM_DOCK_INFO_LINE_MAX 128
+#define NIZAM_DOCK_TRAY_ICON_SIZE 24
+#define NIZAM_DOCK_IPC_CLIENTS 4
+#define NIZAM_DOCK_IPC_TIMEOUT_MS 1000
 
 struct nizam_dock_atoms {
   xcb_atom_t net_wm_window_type;
@@ -51,6 +57,13 @@ struct nizam_dock_menu_item {
   int submenu;
 };
 
+struct nizam_dock_ipc_client {
+  int fd;
+  size_t len;
+  int64_t deadline_ms;
+  char buf[64];
+};
+
 struct nizam_dock_launcher_rect {
   int x;
   int y;
@@ -79,6 +92,8 @@ struct nizam_dock_app {
   int have_root_pixmap;
 
   struct nizam_dock_icon_cache *icon_cache;
+  struct nizam_dock_text_cache *text_cache;
+  struct nizam_dock_prefetch *prefetch;
 
   int panel_x;
   int panel_y;
@@ -88,9 +103,25 @@ struct nizam_dock_app {
   int mon_y;
   int mon_w;
   int mon_h;
+  struct nizam_monitors monitors;
+  uint8_t randr_event_base;
+  int pointer_inside;
+  int have_pointer;
+  int pointer_root_x;
+  int pointer_root_y;
+  uint64_t roundtrips_total;
   int handle_px;
   int buffer_w;
   int buffer_h;
+  xcb_pixmap_t layer_base;
+  int layer_base_w;
+  int layer_base_h;
+  int layer_base_valid;
+  uint64_t layer_base_rebuilds;
+  int damage_x;
+  int damage_y;
+  int damage_w;
+  int damage_h;
   int backbuffer_recreates_total;
   size_t backbuffer_bytes;
   int64_t last_mem_log_ms;
@@ -104,6 +135,7 @@ struct nizam_dock_app {
   uint64_t hover_changes;
   int hovered_launcher_idx;
   int hovered_tray_idx;
+  int64_t prefetch_due_ms;
   int64_t last_debug_log_ms;
   int y_visible;
   int x_visible;
@@ -113,8 +145,20 @@ struct nizam_dock_app {
   int64_t hide_deadline_ms;
   int64_t last_draw_ms;
   int64_t last_toggle_ms;
+  int anim_active;
+  int anim_from_x;
+  int anim_to_x;
+  int64_t anim_start_ms;
+  int64_t anim_duration_ms;
+  int64_t anim_next_frame_ms;
+  uint64_t anim_frames;
   int64_t suppress_hide_until_ms;
   int64_t suppress_raise_until_ms;
+  int tray_relayout;
+  int tray_cart_x;
+  int tray_cart_y;
+  int tray_cart_w;
+  int tray_cart_h;
   int tray_y;
   int tray_size;
   size_t tray_count;
@@ -139,6 +183,13 @@ struct nizam_dock_app {
   int menu_visible;
   int menu_dirty;
   struct nizam_dock_menu_item *menu_items;
+  int menu_pending;
+  int menu_pending_x;
+  int menu_pending_y;
+  int menu_pending_button;
+  uint32_t menu_pending_time;
+  int ipc_fd;
+  struct nizam_dock_ipc_client ipc_clients[NIZAM_DOCK_IPC_CLIENTS];
   char sysinfo_lines[NIZAM_DOCK_INFO_LINES][NIZAM_DOCK_INFO_LINE_MAX];
 
   struct nizam_dock_atoms atoms;
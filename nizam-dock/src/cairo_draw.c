@@ -10,6 +10,7 @@
 #include <unistd.h>
 
 #include "icon_policy.h"
+#include "text_cache.h"
 #include "icon_surface_cache.h"
 #include "sni.h"
 
@@ -20,6 +21,7 @@
 #define NIZAM_DOCK_TRAY_SPACING 3
 #define NIZAM_DOCK_TRAY_PAD 10
 #define NIZAM_DOCK_TRAY_RADIUS 8.0
+#define NIZAM_DOCK_HOVER_PAD 3
 
 
 #define NIZAM_COLOR_BG_PRIMARY   0x2e3436u
@@ -133,14 +135,9 @@ static void read_xversion(char *out, size_t out_size, const struct nizam_dock_ap
 }
 
 static void draw_icon(cairo_t *cr, cairo_surface_t *icon, int x, int y, int size) {
-  if (!icon || cairo_surface_status(icon) != CAIRO_STATUS_SUCCESS) {
-    draw_placeholder(cr, x, y, size);
-    return;
-  }
-
-  int iw = cairo_image_surface_get_width(icon);
-  int ih = cairo_image_surface_get_height(icon);
-  if (iw <= 0 || ih <= 0) {
+  int iw = 0;
+  int ih = 0;
+  if (!nizam_dock_icon_surface_size(icon, &iw, &ih)) {
     draw_placeholder(cr, x, y, size);
     return;
   }
@@ -177,6 +174,14 @@ int nizam_dock_icons_init(struct nizam_dock_app *app, const struct nizam_dock_co
     app->icon_cache = nizam_dock_icon_cache_new(NIZAM_DOCK_ICON_CACHE_CAP,
                                                 NIZAM_DOCK_ICON_PX,
                                                 NIZAM_DOCK_ICON_SCALE);
+    if (app->icon_cache && app->conn && app->window != XCB_NONE) {
+      cairo_surface_t *target = cairo_xcb_surface_create(app->conn, app->window,
+                                                         app->visual_type, 1, 1);
+      if (cairo_surface_status(target) == CAIRO_STATUS_SUCCESS) {
+        nizam_dock_icon_cache_set_target(app->icon_cache, target);
+      }
+      cairo_surface_destroy(target);
+    }
   } else {
     nizam_dock_icon_cache_clear(app->icon_cache);
   }
@@ -184,6 +189,25 @@ int nizam_dock_icons_init(struct nizam_dock_app *app, const struct nizam_dock_co
   return 0;
 }
 
+void nizam_dock_icons_retain(struct nizam_dock_app *app, const struct nizam_dock_config *cfg) {
+  if (!app || !app->icon_cache || !cfg) {
+    return;
+  }
+  const char **names = NULL;
+  if (cfg->launcher_count > 0) {
+    names = calloc(cfg->launcher_count, sizeof(*names));
+    if (!names) {
+      nizam_dock_icon_cache_clear(app->icon_cache);
+      return;
+    }
+  }
+  for (size_t i = 0; i < cfg->launcher_count; ++i) {
+    names[i] = cfg->launchers[i].icon;
+  }
+  nizam_dock_icon_cache_retain(app->icon_cache, names, cfg->launcher_count);
+  free(names);
+}
+
 void nizam_dock_icons_free(struct nizam_dock_app *app) {
   if (!app || !app->icon_cache) {
     return;
@@ -202,8 +226,106 @@ int nizam_dock_sysinfo_init(struct nizam_dock_app *app) {
   return 0;
 }
 
-int nizam_dock_draw(struct nizam_dock_app *app, const struct nizam_dock_config *cfg) {
-  nizam_dock_debug_log("draw start");
+static int rect_intersects(int ax, int ay, int aw, int ah, int bx, int by, int bw, int bh) {
+  return aw > 0 && ah > 0 && bw > 0 && bh > 0 &&
+         ax < bx + bw && bx < ax + aw && ay < by + bh && by < ay + ah;
+}
+
+void nizam_dock_damage_rect(struct nizam_dock_app *app, int x, int y, int w, int h) {
+  if (!app || w <= 0 || h <= 0) {
+    return;
+  }
+  if (app->damage_w <= 0 || app->damage_h <= 0) {
+    app->damage_x = x;
+    app->damage_y = y;
+    app->damage_w = w;
+    app->damage_h = h;
+    return;
+  }
+  int x2 = app->damage_x + app->damage_w;
+  int y2 = app->damage_y + app->damage_h;
+  if (x + w > x2) x2 = x + w;
+  if (y + h > y2) y2 = y + h;
+  if (x < app->damage_x) app->damage_x = x;
+  if (y < app->damage_y) app->damage_y = y;
+  app->damage_w = x2 - app->damage_x;
+  app->damage_h = y2 - app->damage_y;
+}
+
+void nizam_dock_damage_all(struct nizam_dock_app *app) {
+  if (!app) {
+    return;
+  }
+  nizam_dock_damage_rect(app, 0, 0, app->panel_w, app->panel_h);
+}
+
+void nizam_dock_damage_launcher(struct nizam_dock_app *app, int idx) {
+  if (!app || idx < 0 || (size_t)idx >= app->launcher_rect_count) {
+    return;
+  }
+  const struct nizam_dock_launcher_rect *r = &app->launcher_rects[idx];
+  nizam_dock_damage_rect(app, r->x - NIZAM_DOCK_HOVER_PAD, r->y - NIZAM_DOCK_HOVER_PAD,
+                         r->w + NIZAM_DOCK_HOVER_PAD * 2, r->h + NIZAM_DOCK_HOVER_PAD * 2);
+}
+
+void nizam_dock_damage_tray(struct nizam_dock_app *app) {
+  if (!app) {
+    return;
+  }
+  app->tray_relayout = 1;
+  nizam_dock_damage_rect(app, app->tray_cart_x, app->tray_cart_y,
+                         app->tray_cart_w, app->tray_cart_h);
+}
+
+void nizam_dock_layers_invalidate(struct nizam_dock_app *app) {
+  if (!app) {
+    return;
+  }
+  app->layer_base_valid = 0;
+  app->tray_relayout = 1;
+  nizam_dock_damage_all(app);
+}
+
+void nizam_dock_layers_free(struct nizam_dock_app *app) {
+  if (!app || !app->conn) {
+    return;
+  }
+  if (app->layer_base != XCB_NONE) {
+    xcb_free_pixmap(app->conn, app->layer_base);
+    app->layer_base = XCB_NONE;
+  }
+  app->layer_base_w = 0;
+  app->layer_base_h = 0;
+  app->layer_base_valid = 0;
+}
+
+static void update_launcher_rects(struct nizam_dock_app *app, size_t count) {
+  if (app->launcher_rect_count == count) {
+    return;
+  }
+  free(app->launcher_rects);
+  app->launcher_rects = NULL;
+  app->launcher_rect_count = 0;
+  if (count > 0) {
+    app->launcher_rects = calloc(count, sizeof(*app->launcher_rects));
+    if (app->launcher_rects) {
+      app->launcher_rect_count = count;
+    }
+  }
+}
+
+static int build_base_layer(struct nizam_dock_app *app, const struct nizam_dock_config *cfg) {
+  if (app->layer_base == XCB_NONE ||
+      app->layer_base_w != app->panel_w || app->layer_base_h != app->panel_h) {
+    nizam_dock_layers_free(app);
+    app->layer_base = xcb_generate_id(app->conn);
+    xcb_create_pixmap(app->conn, app->screen->root_depth,
+                      app->layer_base, app->window,
+                      app->panel_w, app->panel_h);
+    app->layer_base_w = app->panel_w;
+    app->layer_base_h = app->panel_h;
+  }
+
   if (app->have_root_pixmap) {
     int src_x = app->x_visible;
     if (src_x < 0) {
@@ -215,15 +337,15 @@ int nizam_dock_draw(struct nizam_dock_app *app, const struct nizam_dock_config *
         src_x = 0;
       }
     }
-    xcb_copy_area(app->conn, app->root_pixmap, app->buffer, app->gc,
+    xcb_copy_area(app->conn, app->root_pixmap, app->layer_base, app->gc,
                   src_x, app->panel_y, 0, 0, app->panel_w, app->panel_h);
   }
 
-  cairo_surface_t *surface = cairo_xcb_surface_create(app->conn, app->buffer,
+  cairo_surface_t *surface = cairo_xcb_surface_create(app->conn, app->layer_base,
                                                       app->visual_type,
                                                       app->panel_w, app->panel_h);
   if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
-    nizam_dock_debug_log("draw surface create failed");
+    nizam_dock_debug_log("base layer surface create failed");
     cairo_surface_destroy(surface);
     return -1;
   }
@@ -248,34 +370,20 @@ int nizam_dock_draw(struct nizam_dock_app *app, const struct nizam_dock_config *
   cairo_stroke(cr);
 
   size_t count = cfg->launcher_count;
-  if (app->launcher_rect_count != count) {
-    free(app->launcher_rects);
-    app->launcher_rects = NULL;
-    app->launcher_rect_count = 0;
-    if (count > 0) {
-      app->launcher_rects = calloc(count, sizeof(*app->launcher_rects));
-      if (app->launcher_rects) {
-        app->launcher_rect_count = count;
-      }
-    }
-  }
+  update_launcher_rects(app, count);
 
   int x = cfg->padding;
   int y = cfg->padding;
   int info_y = y;
-  cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-  cairo_set_font_size(cr, 12.0);
   set_source_hex(cr, NIZAM_COLOR_FG_SECONDARY, 1.0);
   for (int i = 0; i < NIZAM_DOCK_INFO_LINES; ++i) {
-    cairo_move_to(cr, x, info_y + NIZAM_DOCK_INFO_LINE_HEIGHT);
-    cairo_show_text(cr, app->sysinfo_lines[i]);
+    nizam_dock_text_draw(app->text_cache, cr, "Sans", 0, 12.0,
+                         x, info_y + NIZAM_DOCK_INFO_LINE_HEIGHT, app->sysinfo_lines[i]);
     info_y += NIZAM_DOCK_INFO_LINE_HEIGHT + NIZAM_DOCK_INFO_LINE_GAP;
   }
   y = info_y + NIZAM_DOCK_INFO_TOP_GAP;
 
   if (count > 0) {
-    cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
-    cairo_set_font_size(cr, 12.0);
     size_t i = 0;
     while (i < count) {
       const char *cat_key = launcher_category_key(&cfg->launchers[i]);
@@ -288,9 +396,8 @@ int nizam_dock_draw(struct nizam_dock_app *app, const struct nizam_dock_config *
       size_t group_count = i - group_start;
 
       set_source_hex(cr, NIZAM_COLOR_FG_PRIMARY, 1.0);
-      cairo_set_font_size(cr, 17.0);
-      cairo_move_to(cr, x, y + NIZAM_DOCK_CATEGORY_LABEL_HEIGHT);
-      cairo_show_text(cr, cat_label);
+      nizam_dock_text_draw(app->text_cache, cr, "Sans", 1, 17.0,
+                           x, y + NIZAM_DOCK_CATEGORY_LABEL_HEIGHT, cat_label);
       y += NIZAM_DOCK_CATEGORY_LABEL_HEIGHT + NIZAM_DOCK_CATEGORY_LABEL_GAP;
 
       int row_x = x;
@@ -316,97 +423,91 @@ int nizam_dock_draw(struct nizam_dock_app *app, const struct nizam_dock_config *
     }
   }
 
+  cairo_destroy(cr);
+  cairo_surface_flush(surface);
+  cairo_surface_destroy(surface);
+  app->layer_base_valid = 1;
+  app->layer_base_rebuilds++;
+  return 0;
+}
+
+static void layout_tray(struct nizam_dock_app *app, const struct nizam_dock_config *cfg) {
   size_t sni_count = nizam_dock_sni_count(app);
   size_t xembed_count = app->xembed_count;
   size_t tray_count = sni_count + xembed_count;
-  int tray_size = 0;
-  int tray_y = 0;
+  int cart_x = 0;
+  int cart_y = 0;
+  int cart_w = 0;
+  int cart_h = 0;
 
+  app->tray_relayout = 0;
   if (tray_count > 0) {
     const int bottom_gap = (cfg->padding > 2) ? cfg->padding : 2;
-    tray_size = 24;
+    int tray_size = NIZAM_DOCK_TRAY_ICON_SIZE;
     int tray_total_w = (int)tray_count * tray_size;
     if (tray_count > 1) {
       tray_total_w += (int)(tray_count - 1) * NIZAM_DOCK_TRAY_SPACING;
     }
-    if (tray_total_w > 0) {
-      int cart_w = tray_total_w + NIZAM_DOCK_TRAY_PAD * 2;
-      int cart_h = tray_size + NIZAM_DOCK_TRAY_PAD * 2;
-      int cart_x = app->panel_w - cfg->padding - cart_w;
-      int cart_y = app->panel_h - bottom_gap - cart_h;
-      if (cart_x < 0) {
-        cart_x = 0;
-      }
-      if (cart_y < 0) {
-        cart_y = 0;
-      }
-      if (cart_x + cart_w > app->panel_w) {
-        cart_w = app->panel_w - cart_x;
-      }
-      if (cart_y + cart_h > app->panel_h) {
-        cart_h = app->panel_h - cart_y;
-      }
+    cart_w = tray_total_w + NIZAM_DOCK_TRAY_PAD * 2;
+    cart_h = tray_size + NIZAM_DOCK_TRAY_PAD * 2;
+    cart_x = app->panel_w - cfg->padding - cart_w;
+    cart_y = app->panel_h - bottom_gap - cart_h;
+    if (cart_x < 0) {
+      cart_x = 0;
+    }
+    if (cart_y < 0) {
+      cart_y = 0;
+    }
+    if (cart_x + cart_w > app->panel_w) {
+      cart_w = app->panel_w - cart_x;
+    }
+    if (cart_y + cart_h > app->panel_h) {
+      cart_h = app->panel_h - cart_y;
+    }
 
-      tray_y = cart_y + NIZAM_DOCK_TRAY_PAD;
+    int tray_y = cart_y + NIZAM_DOCK_TRAY_PAD;
+    if (tray_y < 0) {
+      tray_y = 0;
+    }
+    if (tray_y + tray_size > app->panel_h) {
+      tray_y = app->panel_h - tray_size;
       if (tray_y < 0) {
         tray_y = 0;
       }
-      if (tray_y + tray_size > app->panel_h) {
-        tray_y = app->panel_h - tray_size;
-        if (tray_y < 0) {
-          tray_y = 0;
-        }
-      }
+    }
 
-      app->tray_count = sni_count;
-      app->tray_size = tray_size;
-      app->xembed_size = tray_size;
-      app->tray_y = tray_y;
-      app->xembed_y = tray_y;
-
-      cairo_save(cr);
-      rounded_rect(cr, cart_x + 0.5, cart_y + 0.5,
-                   cart_w - 1.0, cart_h - 1.0, NIZAM_DOCK_TRAY_RADIUS);
-      
-      set_source_hex(cr, NIZAM_COLOR_BG_SECONDARY, 1.0);
-      cairo_fill_preserve(cr);
-      set_source_hex(cr, NIZAM_COLOR_BG_BORDER, 1.0);
-      cairo_set_line_width(cr, 1.0);
-      cairo_stroke(cr);
-      cairo_restore(cr);
-      int total_icons = (int)tray_count;
-      int gap = NIZAM_DOCK_TRAY_SPACING;
-      app->tray_gap = gap;
-      app->xembed_gap = gap;
-      int content_w = total_icons * tray_size + (total_icons - 1) * gap;
-      int start_x = cart_x + (cart_w - content_w) / 2;
+    app->tray_count = sni_count;
+    app->tray_size = tray_size;
+    app->xembed_size = tray_size;
+    app->tray_y = tray_y;
+    app->xembed_y = tray_y;
+
+    int total_icons = (int)tray_count;
+    int gap = NIZAM_DOCK_TRAY_SPACING;
+    app->tray_gap = gap;
+    app->xembed_gap = gap;
+    int content_w = total_icons * tray_size + (total_icons - 1) * gap;
+    int start_x = cart_x + (cart_w - content_w) / 2;
+    if (start_x < 0) {
+      start_x = 0;
+    }
+    if (start_x + content_w > app->panel_w) {
+      start_x = app->panel_w - content_w;
       if (start_x < 0) {
         start_x = 0;
       }
-      if (start_x + content_w > app->panel_w) {
-        start_x = app->panel_w - content_w;
-        if (start_x < 0) {
-          start_x = 0;
-        }
-      }
-      int xembed_w = 0;
-      if (xembed_count > 0) {
-        xembed_w = (int)xembed_count * tray_size +
-                   (int)(xembed_count - 1) * gap;
-      }
-      app->xembed_x = start_x;
-      app->tray_x = start_x + xembed_w;
-      if (xembed_count > 0 && sni_count > 0) {
-        app->tray_x += gap;
-      }
-      int tx = app->tray_x;
-      for (size_t i = 0; i < sni_count; ++i) {
-        draw_icon(cr, nizam_dock_sni_icon(app, i), tx, tray_y, tray_size);
-        tx += tray_size + gap;
-      }
-      nizam_dock_xembed_layout(app, cfg);
-      goto tray_done;
     }
+    int xembed_w = 0;
+    if (xembed_count > 0) {
+      xembed_w = (int)xembed_count * tray_size +
+                 (int)(xembed_count - 1) * gap;
+    }
+    app->xembed_x = start_x;
+    app->tray_x = start_x + xembed_w;
+    if (xembed_count > 0 && sni_count > 0) {
+      app->tray_x += gap;
+    }
+    nizam_dock_xembed_layout(app, cfg);
   } else {
     app->tray_count = 0;
     app->tray_size = 0;
@@ -419,13 +520,136 @@ int nizam_dock_draw(struct nizam_dock_app *app, const struct nizam_dock_config *
     app->xembed_gap = 0;
   }
 
-tray_done:
+  if (cart_x != app->tray_cart_x || cart_y != app->tray_cart_y ||
+      cart_w != app->tray_cart_w || cart_h != app->tray_cart_h) {
+    nizam_dock_damage_rect(app, app->tray_cart_x, app->tray_cart_y,
+                           app->tray_cart_w, app->tray_cart_h);
+    app->tray_cart_x = cart_x;
+    app->tray_cart_y = cart_y;
+    app->tray_cart_w = cart_w;
+    app->tray_cart_h = cart_h;
+    nizam_dock_damage_rect(app, cart_x, cart_y, cart_w, cart_h);
+  }
+}
+
+static void draw_tray(cairo_t *cr, struct nizam_dock_app *app) {
+  if (app->tray_cart_w <= 0 || app->tray_cart_h <= 0) {
+    return;
+  }
+  cairo_save(cr);
+  rounded_rect(cr, app->tray_cart_x + 0.5, app->tray_cart_y + 0.5,
+               app->tray_cart_w - 1.0, app->tray_cart_h - 1.0, NIZAM_DOCK_TRAY_RADIUS);
+  
+  set_source_hex(cr, NIZAM_COLOR_BG_SECONDARY, 1.0);
+  cairo_fill_preserve(cr);
+  set_source_hex(cr, NIZAM_COLOR_BG_BORDER, 1.0);
+  cairo_set_line_width(cr, 1.0);
+  cairo_stroke(cr);
+  cairo_restore(cr);
+
+  int tx = app->tray_x;
+  for (size_t i = 0; i < app->tray_count; ++i) {
+    draw_icon(cr, nizam_dock_sni_icon(app, i), tx, app->tray_y, app->tray_size);
+    tx += app->tray_size + app->tray_gap;
+  }
+}
+
+static void draw_launcher_hover(cairo_t *cr, const struct nizam_dock_app *app) {
+  int idx = app->hovered_launcher_idx;
+  if (idx < 0 || (size_t)idx >= app->launcher_rect_count) {
+    return;
+  }
+  const struct nizam_dock_launcher_rect *r = &app->launcher_rects[idx];
+  int pad = NIZAM_DOCK_HOVER_PAD;
+  cairo_save(cr);
+  rounded_rect(cr, r->x - pad + 0.5, r->y - pad + 0.5,
+               r->w + pad * 2 - 1.0, r->h + pad * 2 - 1.0, 4.0);
+  set_source_hex(cr, NIZAM_COLOR_FG_PRIMARY, 0.08);
+  cairo_fill_preserve(cr);
+  set_source_hex(cr, NIZAM_COLOR_FG_PRIMARY, 0.30);
+  cairo_set_line_width(cr, 1.0);
+  cairo_stroke(cr);
+  cairo_restore(cr);
+}
+
+int nizam_dock_draw(struct nizam_dock_app *app, const struct nizam_dock_config *cfg) {
+  nizam_dock_debug_log("draw start");
+  if (!app->layer_base_valid) {
+    if (build_base_layer(app, cfg) != 0) {
+      return -1;
+    }
+    app->tray_relayout = 1;
+    nizam_dock_damage_all(app);
+  }
+  if (app->tray_relayout) {
+    layout_tray(app, cfg);
+  }
+
+  int dx = app->damage_x;
+  int dy = app->damage_y;
+  int dw = app->damage_w;
+  int dh = app->damage_h;
+  app->damage_w = 0;
+  app->damage_h = 0;
+  if (dx < 0) {
+    dw += dx;
+    dx = 0;
+  }
+  if (dy < 0) {
+    dh += dy;
+    dy = 0;
+  }
+  if (dx + dw > app->panel_w) {
+    dw = app->panel_w - dx;
+  }
+  if (dy + dh > app->panel_h) {
+    dh = app->panel_h - dy;
+  }
+  if (dw <= 0 || dh <= 0) {
+    nizam_dock_debug_log("draw skipped (no damage)");
+    return 0;
+  }
+
+  xcb_copy_area(app->conn, app->layer_base, app->buffer, app->gc,
+                dx, dy, dx, dy, dw, dh);
+
+  int hover_idx = app->hovered_launcher_idx;
+  int want_hover = 0;
+  if (hover_idx >= 0 && (size_t)hover_idx < app->launcher_rect_count) {
+    const struct nizam_dock_launcher_rect *r = &app->launcher_rects[hover_idx];
+    int pad = NIZAM_DOCK_HOVER_PAD;
+    want_hover = rect_intersects(dx, dy, dw, dh,
+                                 r->x - pad, r->y - pad, r->w + pad * 2, r->h + pad * 2);
+  }
+  int want_tray = rect_intersects(dx, dy, dw, dh,
+                                  app->tray_cart_x, app->tray_cart_y,
+                                  app->tray_cart_w, app->tray_cart_h);
+
+  if (want_hover || want_tray) {
+    cairo_surface_t *surface = cairo_xcb_surface_create(app->conn, app->buffer,
+                                                        app->visual_type,
+                                                        app->panel_w, app->panel_h);
+    if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+      nizam_dock_debug_log("draw surface create failed");
+      cairo_surface_destroy(surface);
+      return -1;
+    }
+    cairo_t *cr = cairo_create(surface);
+    cairo_rectangle(cr, dx, dy, dw, dh);
+    cairo_clip(cr);
+    if (want_hover) {
+      draw_launcher_hover(cr, app);
+    }
+    if (want_tray) {
+      draw_tray(cr, app);
+    }
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+    cairo_surface_destroy(surface);
+  }
 
-  cairo_destroy(cr);
-  cairo_surface_flush(surface);
-  cairo_surface_destroy(surface);
   xcb_copy_area(app->conn, app->buffer, app->window, app->gc,
-                0, 0, 0, 0, app->panel_w, app->panel_h);
+                dx, dy, dx, dy, dw, dh);
   xcb_flush(app->conn);
 
   nizam_dock_debug_log("draw done");
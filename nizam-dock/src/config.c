@@ -314,6 +314,7 @@ void nizam_dock_config_free(struct nizam_dock_config *cfg) {
     free(cfg->launchers[i].icon);
     free(cfg->launchers[i].cmd);
     free(cfg->launchers[i].category);
+    free(cfg->launchers[i].desktop_id);
   }
   free(cfg->launchers);
   cfg->launchers = NULL;
@@ -353,6 +354,7 @@ static void config_add_launcher(struct nizam_dock_config *cfg) {
   cfg->launchers[cfg->launcher_count].icon = NULL;
   cfg->launchers[cfg->launcher_count].cmd = NULL;
   cfg->launchers[cfg->launcher_count].category = NULL;
+  cfg->launchers[cfg->launcher_count].desktop_id = NULL;
   cfg->launcher_count += 1;
 }
 
@@ -364,6 +366,7 @@ static void config_clear_launchers(struct nizam_dock_config *cfg) {
     free(cfg->launchers[i].icon);
     free(cfg->launchers[i].cmd);
     free(cfg->launchers[i].category);
+    free(cfg->launchers[i].desktop_id);
   }
   free(cfg->launchers);
   cfg->launchers = NULL;
@@ -531,6 +534,7 @@ static void load_launchers_from_desktop(struct nizam_dock_config *cfg) {
     if (cat_buf[0]) {
       launcher->category = nizam_dock_strdup(cat_buf);
     }
+    launcher->desktop_id = nizam_dock_strdup(name);
 
     free(exec);
     free(icon);
@@ -558,12 +562,13 @@ static void load_launchers_from_nizam_db_where(sqlite3 *db,
         "SELECT "
         "coalesce(user_exec, exec) as exec, "
         "icon, category, "
-        "coalesce(user_categories, categories) as categories "
+        "coalesce(user_categories, categories) as categories, "
+        "filename "
         "FROM desktop_entries "
         "WHERE enabled=1";
   } else {
     base_sql =
-        "SELECT exec, icon, category, categories "
+        "SELECT exec, icon, category, categories, filename "
         "FROM desktop_entries "
         "WHERE enabled=1";
   }
@@ -595,6 +600,7 @@ static void load_launchers_from_nizam_db_where(sqlite3 *db,
     const char *icon = (const char *)sqlite3_column_text(st, 1);
     const char *cat = (const char *)sqlite3_column_text(st, 2);
     const char *cats = (const char *)sqlite3_column_text(st, 3);
+    const char *desktop_id = (const char *)sqlite3_column_text(st, 4);
 
     if (!exec || !*exec) {
       continue;
@@ -624,6 +630,9 @@ static void load_launchers_from_nizam_db_where(sqlite3 *db,
     if (cat_buf[0]) {
       launcher->category = nizam_dock_strdup(cat_buf);
     }
+    if (desktop_id && *desktop_id) {
+      launcher->desktop_id = nizam_dock_strdup(desktop_id);
+    }
   }
 
   sqlite3_finalize(st);
@@ -801,3 +810,57 @@ int nizam_dock_config_load_launchers(struct nizam_dock_config *cfg) {
   }
   return 0;
 }
+
+static int str_eq(const char *a, const char *b) {
+  return strcmp(a ? a : "", b ? b : "") == 0;
+}
+
+static int launcher_same_id(const struct nizam_dock_launcher *a, const struct nizam_dock_launcher *b) {
+  if (a->desktop_id && b->desktop_id) {
+    return strcmp(a->desktop_id, b->desktop_id) == 0;
+  }
+  return !a->desktop_id && !b->desktop_id && str_eq(a->cmd, b->cmd);
+}
+
+int nizam_dock_config_reload_launchers(struct nizam_dock_config *cfg) {
+  if (!cfg) {
+    return -1;
+  }
+
+  struct nizam_dock_config next;
+  nizam_dock_config_init_defaults(&next);
+  (void)nizam_dock_config_load_launchers(&next);
+
+  size_t added = 0;
+  size_t changed = 0;
+  size_t kept = 0;
+  for (size_t i = 0; i < next.launcher_count; ++i) {
+    const struct nizam_dock_launcher *nl = &next.launchers[i];
+    size_t j = 0;
+    while (j < cfg->launcher_count && !launcher_same_id(&cfg->launchers[j], nl)) {
+      j++;
+    }
+    if (j == cfg->launcher_count) {
+      added++;
+      continue;
+    }
+    const struct nizam_dock_launcher *ol = &cfg->launchers[j];
+    if (j != i || !str_eq(ol->cmd, nl->cmd) || !str_eq(ol->icon, nl->icon) ||
+        !str_eq(ol->category, nl->category)) {
+      changed++;
+    }
+    kept++;
+  }
+  size_t removed = cfg->launcher_count > kept ? cfg->launcher_count - kept : 0;
+
+  if (nizam_dock_debug_enabled()) {
+    fprintf(stderr, "nizam-dock: launchers reload added=%zu removed=%zu changed=%zu\n",
+            added, removed, changed);
+  }
+
+  config_clear_launchers(cfg);
+  cfg->enabled = next.enabled;
+  cfg->launchers = next.launchers;
+  cfg->launcher_count = next.launcher_count;
+  return (int)(added + removed + changed);
+}
@@ -7,6 +7,7 @@
 #include <string.h>
 
 #include "icon_policy.h"
+#include "nizam_pixel.h"
 #include "sni.h"
 
 struct icon_key {
@@ -22,8 +23,14 @@ struct icon_entry {
   struct icon_entry *next;
 };
 
+struct icon_size {
+  int w;
+  int h;
+};
+
 struct nizam_dock_icon_cache {
   GHashTable *map;
+  cairo_surface_t *target;
   struct icon_entry *head;
   struct icon_entry *tail;
   int size;
@@ -34,8 +41,11 @@ struct nizam_dock_icon_cache {
   uint64_t misses;
   uint64_t evictions;
   uint64_t alive_surfaces;
+  uint64_t uploads;
 };
 
+static cairo_user_data_key_t icon_size_key;
+
 static guint icon_key_hash(gconstpointer data) {
   const struct icon_key *k = data;
   guint h = g_str_hash(k->name);
@@ -115,6 +125,14 @@ static void icon_entry_destroy(struct nizam_dock_icon_cache *cache, struct icon_
   free(entry);
 }
 
+static void icon_entry_evict(struct nizam_dock_icon_cache *cache, struct icon_entry *entry) {
+  icon_entry_unlink(cache, entry);
+  g_hash_table_remove(cache->map, entry->key);
+  cache->evictions++;
+  cache->size--;
+  icon_entry_destroy(cache, entry);
+}
+
 static cairo_surface_t *surface_from_pixbuf(GdkPixbuf *pixbuf) {
   if (!pixbuf) {
     return NULL;
@@ -132,26 +150,16 @@ static cairo_surface_t *surface_from_pixbuf(GdkPixbuf *pixbuf) {
   }
   for (int y = 0; y < h; ++y) {
     const guchar *row = src + y * stride_src;
-    unsigned char *out = dst + y * stride_dst;
-    for (int x = 0; x < w; ++x) {
-      unsigned char r = row[x * channels + 0];
-      unsigned char g = row[x * channels + 1];
-      unsigned char b = row[x * channels + 2];
-      unsigned char a = has_alpha ? row[x * channels + 3] : 255;
-      unsigned char pr = (unsigned char)((r * a + 127) / 255);
-      unsigned char pg = (unsigned char)((g * a + 127) / 255);
-      unsigned char pb = (unsigned char)((b * a + 127) / 255);
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-      out[x * 4 + 0] = pb;
-      out[x * 4 + 1] = pg;
-      out[x * 4 + 2] = pr;
-      out[x * 4 + 3] = a;
-#else
-      out[x * 4 + 0] = a;
-      out[x * 4 + 1] = pr;
-      out[x * 4 + 2] = pg;
-      out[x * 4 + 3] = pb;
-#endif
+    uint32_t *out = (uint32_t *)(dst + y * stride_dst);
+    if (has_alpha && channels == 4) {
+      nizam_pixel_rgba_to_argb32(out, row, (size_t)w);
+    } else if (!has_alpha && channels == 3) {
+      nizam_pixel_rgb_to_argb32(out, row, (size_t)w);
+    } else {
+      for (int x = 0; x < w; ++x) {
+        const guchar *p = row + x * channels;
+        out[x] = 0xff000000u | (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+      }
     }
   }
 
@@ -203,6 +211,50 @@ static cairo_surface_t *load_icon_surface_fixed(const char *icon_name_or_path,
   return surface;
 }
 
+static cairo_surface_t *icon_upload(cairo_surface_t *target, cairo_surface_t *image) {
+  int w = cairo_image_surface_get_width(image);
+  int h = cairo_image_surface_get_height(image);
+  cairo_surface_t *remote = cairo_surface_create_similar(target, CAIRO_CONTENT_COLOR_ALPHA, w, h);
+  if (cairo_surface_status(remote) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(remote);
+    return NULL;
+  }
+  struct icon_size *size = malloc(sizeof(*size));
+  if (!size) {
+    cairo_surface_destroy(remote);
+    return NULL;
+  }
+  size->w = w;
+  size->h = h;
+  cairo_surface_set_user_data(remote, &icon_size_key, size, free);
+
+  cairo_t *cr = cairo_create(remote);
+  cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface(cr, image, 0, 0);
+  cairo_paint(cr);
+  cairo_destroy(cr);
+  cairo_surface_flush(remote);
+  return remote;
+}
+
+int nizam_dock_icon_surface_size(cairo_surface_t *surface, int *w, int *h) {
+  if (!surface || cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    return 0;
+  }
+  if (cairo_surface_get_type(surface) == CAIRO_SURFACE_TYPE_IMAGE) {
+    *w = cairo_image_surface_get_width(surface);
+    *h = cairo_image_surface_get_height(surface);
+    return *w > 0 && *h > 0;
+  }
+  const struct icon_size *size = cairo_surface_get_user_data(surface, &icon_size_key);
+  if (!size) {
+    return 0;
+  }
+  *w = size->w;
+  *h = size->h;
+  return 1;
+}
+
 struct nizam_dock_icon_cache *nizam_dock_icon_cache_new(int capacity, int icon_px, int scale) {
   struct nizam_dock_icon_cache *cache = calloc(1, sizeof(*cache));
   if (!cache) {
@@ -237,9 +289,24 @@ void nizam_dock_icon_cache_free(struct nizam_dock_icon_cache *cache) {
   }
   nizam_dock_icon_cache_clear(cache);
   g_hash_table_destroy(cache->map);
+  if (cache->target) {
+    cairo_surface_destroy(cache->target);
+  }
   free(cache);
 }
 
+void nizam_dock_icon_cache_set_target(struct nizam_dock_icon_cache *cache,
+                                      cairo_surface_t *target) {
+  if (!cache || cache->target == target) {
+    return;
+  }
+  nizam_dock_icon_cache_clear(cache);
+  if (cache->target) {
+    cairo_surface_destroy(cache->target);
+  }
+  cache->target = target ? cairo_surface_reference(target) : NULL;
+}
+
 cairo_surface_t *nizam_dock_icon_cache_get(struct nizam_dock_icon_cache *cache,
                                            const char *icon_name_or_path) {
   if (!cache || !icon_name_or_path || !*icon_name_or_path) {
@@ -272,14 +339,17 @@ cairo_surface_t *nizam_dock_icon_cache_get(struct nizam_dock_icon_cache *cache,
   if (!surface) {
     return NULL;
   }
+  if (cache->target) {
+    cairo_surface_t *remote = icon_upload(cache->target, surface);
+    if (remote) {
+      cairo_surface_destroy(surface);
+      surface = remote;
+      cache->uploads++;
+    }
+  }
 
   if (cache->size >= cache->capacity && cache->tail) {
-    struct icon_entry *victim = cache->tail;
-    icon_entry_unlink(cache, victim);
-    g_hash_table_remove(cache->map, victim->key);
-    cache->evictions++;
-    cache->size--;
-    icon_entry_destroy(cache, victim);
+    icon_entry_evict(cache, cache->tail);
   }
 
   struct icon_key *key = calloc(1, sizeof(*key));
@@ -308,6 +378,35 @@ cairo_surface_t *nizam_dock_icon_cache_get(struct nizam_dock_icon_cache *cache,
   return entry->surface;
 }
 
+void nizam_dock_icon_cache_retain(struct nizam_dock_icon_cache *cache,
+                                  const char *const *names,
+                                  size_t count) {
+  if (!cache) {
+    return;
+  }
+  GHashTable *keep = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  for (size_t i = 0; i < count; ++i) {
+    if (!names[i] || !*names[i]) {
+      continue;
+    }
+    char norm[256];
+    nizam_dock_icon_normalize(names[i], norm, sizeof(norm));
+    if (norm[0]) {
+      g_hash_table_add(keep, g_strdup(norm));
+    }
+  }
+
+  struct icon_entry *entry = cache->head;
+  while (entry) {
+    struct icon_entry *next = entry->next;
+    if (!g_hash_table_contains(keep, entry->key->name)) {
+      icon_entry_evict(cache, entry);
+    }
+    entry = next;
+  }
+  g_hash_table_destroy(keep);
+}
+
 void nizam_dock_icon_cache_get_stats(const struct nizam_dock_icon_cache *cache,
                                      struct nizam_dock_icon_cache_stats *out) {
   if (!cache || !out) {
@@ -317,6 +416,7 @@ void nizam_dock_icon_cache_get_stats(const struct nizam_dock_icon_cache *cache,
   out->misses = cache->misses;
   out->evictions = cache->evictions;
   out->alive_surfaces = cache->alive_surfaces;
+  out->uploads = cache->uploads;
   out->size = cache->size;
   out->capacity = cache->capacity;
   out->icon_px = cache->icon_px;
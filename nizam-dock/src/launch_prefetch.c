@@ -0,0 +1,536 @@
+#define _GNU_SOURCE
+#include "launch_prefetch.h"
+
+#include <elf.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <limits.h>
+#include <link.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PREFETCH_MAX_FILES 256
+#define PREFETCH_FRESH_MS 60000
+#define PREFETCH_ELF_TABLE_MAX (4 * 1024 * 1024)
+
+struct nizam_dock_prefetch {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int running;
+  int stop;
+  char *pending;
+  char *current;
+  int current_done;
+  uint64_t requests;
+  uint64_t files;
+  uint64_t bytes;
+  uint64_t launches;
+  uint64_t launches_warm;
+  uint64_t launches_partial;
+
+  GHashTable *warmed;
+  GPtrArray *lib_dirs;
+};
+
+struct elf_section {
+  uint32_t type;
+  uint32_t link;
+  uint64_t offset;
+  uint64_t size;
+};
+
+static int nizam_dock_debug_enabled(void) {
+  const char *env = getenv("NIZAM_DOCK_DEBUG");
+  return env && *env && strcmp(env, "0") != 0;
+}
+
+static int64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void prefetch_lower_priority(void) {
+#ifdef SYS_gettid
+  (void)setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif
+#ifdef SYS_ioprio_set
+  (void)syscall(SYS_ioprio_set, 1, 0, 3 << 13);
+#endif
+}
+
+static void lib_dir_add(GPtrArray *dirs, const char *dir, size_t len) {
+  if (len == 0 || dir[0] != '/') {
+    return;
+  }
+  for (guint i = 0; i < dirs->len; ++i) {
+    const char *have = g_ptr_array_index(dirs, i);
+    if (strlen(have) == len && strncmp(have, dir, len) == 0) {
+      return;
+    }
+  }
+  g_ptr_array_add(dirs, g_strndup(dir, len));
+}
+
+static void lib_dir_add_list(GPtrArray *dirs, const char *list, const char *origin) {
+  if (!list) {
+    return;
+  }
+  while (*list) {
+    const char *end = strchr(list, ':');
+    size_t len = end ? (size_t)(end - list) : strlen(list);
+    if (origin && len >= 7 && strncmp(list, "$ORIGIN", 7) == 0) {
+      char *dir = g_strdup_printf("%s%.*s", origin, (int)(len - 7), list + 7);
+      lib_dir_add(dirs, dir, strlen(dir));
+      g_free(dir);
+    } else if (!memchr(list, '$', len)) {
+      lib_dir_add(dirs, list, len);
+    }
+    if (!end) {
+      break;
+    }
+    list = end + 1;
+  }
+}
+
+static int collect_loaded_dir(struct dl_phdr_info *info, size_t size, void *data) {
+  (void)size;
+  const char *name = info->dlpi_name;
+  const char *slash = name ? strrchr(name, '/') : NULL;
+  if (slash && slash != name) {
+    lib_dir_add(data, name, (size_t)(slash - name));
+  }
+  return 0;
+}
+
+static void prefetch_init_lib_dirs(struct nizam_dock_prefetch *prefetch) {
+  prefetch->lib_dirs = g_ptr_array_new_with_free_func(g_free);
+  lib_dir_add_list(prefetch->lib_dirs, getenv("LD_LIBRARY_PATH"), NULL);
+  dl_iterate_phdr(collect_loaded_dir, prefetch->lib_dirs);
+  lib_dir_add_list(prefetch->lib_dirs, "/lib64:/usr/lib64:/lib:/usr/lib:/usr/local/lib", NULL);
+}
+
+static const char *next_token(const char *s, char *out, size_t out_size) {
+  while (*s == ' ' || *s == '\t') {
+    s++;
+  }
+  if (!*s) {
+    return NULL;
+  }
+  size_t n = 0;
+  char quote = 0;
+  for (; *s; ++s) {
+    if (quote) {
+      if (*s == quote) {
+        quote = 0;
+        continue;
+      }
+      if (*s == '\\' && quote == '"' && s[1]) {
+        s++;
+      }
+    } else if (*s == '"' || *s == '\'') {
+      quote = *s;
+      continue;
+    } else if (*s == ' ' || *s == '\t') {
+      break;
+    } else if (*s == '\\' && s[1]) {
+      s++;
+    }
+    if (n + 1 < out_size) {
+      out[n++] = *s;
+    }
+  }
+  out[n] = '\0';
+  return s;
+}
+
+static int prefetch_exec_path(const char *cmd, char *out, size_t out_size) {
+  char word[PATH_MAX];
+  const char *s = cmd;
+  while ((s = next_token(s, word, sizeof(word))) != NULL) {
+    const char *eq = strchr(word, '=');
+    const char *base = strrchr(word, '/');
+    if (strcmp(base ? base + 1 : word, "env") == 0 || (eq && !memchr(word, '/', (size_t)(eq - word)))) {
+      continue;
+    }
+    break;
+  }
+  if (!s || !word[0]) {
+    return 0;
+  }
+  if (strchr(word, '/')) {
+    snprintf(out, out_size, "%s", word);
+    return access(out, X_OK) == 0;
+  }
+  const char *path = getenv("PATH");
+  if (!path || !*path) {
+    path = "/usr/local/bin:/usr/bin:/bin";
+  }
+  while (*path) {
+    const char *end = strchr(path, ':');
+    size_t len = end ? (size_t)(end - path) : strlen(path);
+    if (len > 0) {
+      snprintf(out, out_size, "%.*s/%s", (int)len, path, word);
+      if (access(out, X_OK) == 0) {
+        return 1;
+      }
+    }
+    if (!end) {
+      break;
+    }
+    path = end + 1;
+  }
+  return 0;
+}
+
+static void *read_table(int fd, uint64_t offset, uint64_t size) {
+  if (size == 0 || size > PREFETCH_ELF_TABLE_MAX) {
+    return NULL;
+  }
+  void *buf = malloc((size_t)size);
+  if (!buf) {
+    return NULL;
+  }
+  if (pread(fd, buf, (size_t)size, (off_t)offset) != (ssize_t)size) {
+    free(buf);
+    return NULL;
+  }
+  return buf;
+}
+
+static int elf_sections(int fd, struct elf_section **out, size_t *out_count, int *is64) {
+  unsigned char ident[EI_NIDENT];
+  if (pread(fd, ident, sizeof(ident), 0) != (ssize_t)sizeof(ident) ||
+      memcmp(ident, ELFMAG, SELFMAG) != 0) {
+    return 0;
+  }
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if (ident[EI_DATA] != ELFDATA2LSB) {
+    return 0;
+  }
+#else
+  if (ident[EI_DATA] != ELFDATA2MSB) {
+    return 0;
+  }
+#endif
+  *is64 = ident[EI_CLASS] == ELFCLASS64;
+  uint64_t shoff;
+  size_t shnum;
+  size_t shentsize;
+  if (*is64) {
+    Elf64_Ehdr eh;
+    if (pread(fd, &eh, sizeof(eh), 0) != (ssize_t)sizeof(eh)) {
+      return 0;
+    }
+    shoff = eh.e_shoff;
+    shnum = eh.e_shnum;
+    shentsize = eh.e_shentsize;
+    if (shentsize != sizeof(Elf64_Shdr)) {
+      return 0;
+    }
+  } else if (ident[EI_CLASS] == ELFCLASS32) {
+    Elf32_Ehdr eh;
+    if (pread(fd, &eh, sizeof(eh), 0) != (ssize_t)sizeof(eh)) {
+      return 0;
+    }
+    shoff = eh.e_shoff;
+    shnum = eh.e_shnum;
+    shentsize = eh.e_shentsize;
+    if (shentsize != sizeof(Elf32_Shdr)) {
+      return 0;
+    }
+  } else {
+    return 0;
+  }
+  unsigned char *raw = read_table(fd, shoff, (uint64_t)shnum * shentsize);
+  if (!raw) {
+    return 0;
+  }
+  struct elf_section *sections = calloc(shnum, sizeof(*sections));
+  if (!sections) {
+    free(raw);
+    return 0;
+  }
+  for (size_t i = 0; i < shnum; ++i) {
+    if (*is64) {
+      const Elf64_Shdr *sh = (const Elf64_Shdr *)(raw + i * shentsize);
+      sections[i] = (struct elf_section){sh->sh_type, sh->sh_link, sh->sh_offset, sh->sh_size};
+    } else {
+      const Elf32_Shdr *sh = (const Elf32_Shdr *)(raw + i * shentsize);
+      sections[i] = (struct elf_section){sh->sh_type, sh->sh_link, sh->sh_offset, sh->sh_size};
+    }
+  }
+  free(raw);
+  *out = sections;
+  *out_count = shnum;
+  return 1;
+}
+
+static void elf_dynamic_deps(int fd, const char *origin, GPtrArray *needed, GPtrArray *dirs) {
+  struct elf_section *sections = NULL;
+  size_t count = 0;
+  int is64 = 0;
+  if (!elf_sections(fd, &sections, &count, &is64)) {
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (sections[i].type != SHT_DYNAMIC || sections[i].link >= count) {
+      continue;
+    }
+    const struct elf_section *strsec = &sections[sections[i].link];
+    char *dyn = read_table(fd, sections[i].offset, sections[i].size);
+    char *strtab = read_table(fd, strsec->offset, strsec->size);
+    size_t entsize = is64 ? sizeof(Elf64_Dyn) : sizeof(Elf32_Dyn);
+    size_t entries = dyn && strtab ? (size_t)(sections[i].size / entsize) : 0;
+    for (size_t e = 0; e < entries; ++e) {
+      int64_t tag;
+      uint64_t val;
+      if (is64) {
+        const Elf64_Dyn *d = (const Elf64_Dyn *)(dyn + e * entsize);
+        tag = d->d_tag;
+        val = d->d_un.d_val;
+      } else {
+        const Elf32_Dyn *d = (const Elf32_Dyn *)(dyn + e * entsize);
+        tag = d->d_tag;
+        val = d->d_un.d_val;
+      }
+      if (tag == DT_NULL) {
+        break;
+      }
+      if (val >= strsec->size || !memchr(strtab + val, '\0', (size_t)(strsec->size - val))) {
+        continue;
+      }
+      if (tag == DT_NEEDED) {
+        g_ptr_array_add(needed, g_strdup(strtab + val));
+      } else if (tag == DT_RUNPATH || tag == DT_RPATH) {
+        lib_dir_add_list(dirs, strtab + val, origin);
+      }
+    }
+    free(dyn);
+    free(strtab);
+    break;
+  }
+  free(sections);
+}
+
+static uint64_t prefetch_file(struct nizam_dock_prefetch *prefetch, const char *path,
+                              GPtrArray *queue, GHashTable *seen, int64_t now) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return 0;
+  }
+  uint64_t bytes = 0;
+  struct stat st;
+  gpointer last = g_hash_table_lookup(prefetch->warmed, path);
+  if (fstat(fd, &st) == 0 && st.st_size > 0 &&
+      (!last || now - (int64_t)GPOINTER_TO_SIZE(last) > PREFETCH_FRESH_MS)) {
+    if (readahead(fd, 0, (size_t)st.st_size) == 0) {
+      bytes = (uint64_t)st.st_size;
+      g_hash_table_replace(prefetch->warmed, g_strdup(path), GSIZE_TO_POINTER((gsize)now));
+    }
+  }
+
+  char line[256];
+  ssize_t got = pread(fd, line, sizeof(line) - 1, 0);
+  if (got > 2 && line[0] == '#' && line[1] == '!') {
+    line[got] = '\0';
+    line[strcspn(line, "\n")] = '\0';
+    char interp[PATH_MAX];
+    if (queue->len < PREFETCH_MAX_FILES && prefetch_exec_path(line + 2, interp, sizeof(interp)) &&
+        !g_hash_table_contains(seen, interp)) {
+      g_hash_table_add(seen, g_strdup(interp));
+      g_ptr_array_add(queue, g_strdup(interp));
+    }
+    close(fd);
+    return bytes;
+  }
+
+  char *origin = g_path_get_dirname(path);
+  GPtrArray *needed = g_ptr_array_new_with_free_func(g_free);
+  GPtrArray *dirs = g_ptr_array_new_with_free_func(g_free);
+  elf_dynamic_deps(fd, origin, needed, dirs);
+  close(fd);
+  for (guint i = 0; i < dirs->len; ++i) {
+    const char *dir = g_ptr_array_index(dirs, i);
+    lib_dir_add(prefetch->lib_dirs, dir, strlen(dir));
+  }
+  for (guint i = 0; i < needed->len && queue->len < PREFETCH_MAX_FILES; ++i) {
+    const char *name = g_ptr_array_index(needed, i);
+    if (g_hash_table_contains(seen, name)) {
+      continue;
+    }
+    g_hash_table_add(seen, g_strdup(name));
+    char lib[PATH_MAX];
+    if (strchr(name, '/')) {
+      g_ptr_array_add(queue, g_strdup(name));
+      continue;
+    }
+    for (guint d = 0; d < prefetch->lib_dirs->len; ++d) {
+      snprintf(lib, sizeof(lib), "%s/%s", (const char *)g_ptr_array_index(prefetch->lib_dirs, d), name);
+      if (access(lib, R_OK) == 0) {
+        g_ptr_array_add(queue, g_strdup(lib));
+        break;
+      }
+    }
+  }
+  g_ptr_array_free(needed, TRUE);
+  g_ptr_array_free(dirs, TRUE);
+  g_free(origin);
+  return bytes;
+}
+
+static void prefetch_command(struct nizam_dock_prefetch *prefetch, const char *cmd,
+                             uint64_t *out_files, uint64_t *out_bytes) {
+  char exe[PATH_MAX];
+  if (!prefetch_exec_path(cmd, exe, sizeof(exe))) {
+    return;
+  }
+  int64_t start = now_ms();
+  GPtrArray *queue = g_ptr_array_new_with_free_func(g_free);
+  GHashTable *seen = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  g_ptr_array_add(queue, g_strdup(exe));
+  for (guint i = 0; i < queue->len; ++i) {
+    uint64_t bytes = prefetch_file(prefetch, g_ptr_array_index(queue, i), queue, seen, start);
+    if (bytes > 0) {
+      (*out_files)++;
+      *out_bytes += bytes;
+    }
+  }
+  if (nizam_dock_debug_enabled()) {
+    fprintf(stderr, "nizam-dock: prefetch %s objects=%u files=%llu bytes=%llu ms=%lld\n",
+            exe, queue->len, (unsigned long long)*out_files,
+            (unsigned long long)*out_bytes, (long long)(now_ms() - start));
+  }
+  g_hash_table_destroy(seen);
+  g_ptr_array_free(queue, TRUE);
+}
+
+static void *prefetch_thread(void *data) {
+  struct nizam_dock_prefetch *prefetch = data;
+  prefetch_lower_priority();
+  prefetch_init_lib_dirs(prefetch);
+  pthread_mutex_lock(&prefetch->lock);
+  for (;;) {
+    while (!prefetch->stop && !prefetch->pending) {
+      pthread_cond_wait(&prefetch->cond, &prefetch->lock);
+    }
+    if (prefetch->stop) {
+      break;
+    }
+    char *cmd = prefetch->pending;
+    prefetch->pending = NULL;
+    free(prefetch->current);
+    prefetch->current = strdup(cmd);
+    prefetch->current_done = 0;
+    pthread_mutex_unlock(&prefetch->lock);
+
+    uint64_t files = 0;
+    uint64_t bytes = 0;
+    prefetch_command(prefetch, cmd, &files, &bytes);
+    free(cmd);
+
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->files += files;
+    prefetch->bytes += bytes;
+    prefetch->current_done = 1;
+  }
+  pthread_mutex_unlock(&prefetch->lock);
+  return NULL;
+}
+
+struct nizam_dock_prefetch *nizam_dock_prefetch_new(void) {
+  struct nizam_dock_prefetch *prefetch = calloc(1, sizeof(*prefetch));
+  if (!prefetch) {
+    return NULL;
+  }
+  pthread_mutex_init(&prefetch->lock, NULL);
+  pthread_cond_init(&prefetch->cond, NULL);
+  prefetch->warmed = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  return prefetch;
+}
+
+void nizam_dock_prefetch_free(struct nizam_dock_prefetch *prefetch) {
+  if (!prefetch) {
+    return;
+  }
+  pthread_mutex_lock(&prefetch->lock);
+  prefetch->stop = 1;
+  pthread_cond_signal(&prefetch->cond);
+  pthread_mutex_unlock(&prefetch->lock);
+  if (prefetch->running) {
+    pthread_join(prefetch->thread, NULL);
+  }
+  pthread_cond_destroy(&prefetch->cond);
+  pthread_mutex_destroy(&prefetch->lock);
+  free(prefetch->pending);
+  free(prefetch->current);
+  g_hash_table_destroy(prefetch->warmed);
+  if (prefetch->lib_dirs) {
+    g_ptr_array_free(prefetch->lib_dirs, TRUE);
+  }
+  free(prefetch);
+}
+
+void nizam_dock_prefetch_request(struct nizam_dock_prefetch *prefetch, const char *cmd) {
+  if (!prefetch || !cmd || !*cmd) {
+    return;
+  }
+  pthread_mutex_lock(&prefetch->lock);
+  if (!prefetch->running) {
+    if (pthread_create(&prefetch->thread, NULL, prefetch_thread, prefetch) != 0) {
+      pthread_mutex_unlock(&prefetch->lock);
+      return;
+    }
+    prefetch->running = 1;
+  }
+  int running = prefetch->current && !prefetch->current_done && !prefetch->pending &&
+                strcmp(prefetch->current, cmd) == 0;
+  if (!running) {
+    free(prefetch->pending);
+    prefetch->pending = strdup(cmd);
+    prefetch->requests++;
+    pthread_cond_signal(&prefetch->cond);
+  }
+  pthread_mutex_unlock(&prefetch->lock);
+}
+
+void nizam_dock_prefetch_note_launch(struct nizam_dock_prefetch *prefetch, const char *cmd) {
+  if (!prefetch || !cmd) {
+    return;
+  }
+  pthread_mutex_lock(&prefetch->lock);
+  prefetch->launches++;
+  if (prefetch->current && strcmp(prefetch->current, cmd) == 0) {
+    if (prefetch->current_done) {
+      prefetch->launches_warm++;
+    } else {
+      prefetch->launches_partial++;
+    }
+  } else if (prefetch->pending && strcmp(prefetch->pending, cmd) == 0) {
+    prefetch->launches_partial++;
+  }
+  pthread_mutex_unlock(&prefetch->lock);
+}
+
+void nizam_dock_prefetch_get_stats(struct nizam_dock_prefetch *prefetch,
+                                   struct nizam_dock_prefetch_stats *out) {
+  if (!prefetch || !out) {
+    return;
+  }
+  pthread_mutex_lock(&prefetch->lock);
+  out->requests = prefetch->requests;
+  out->files = prefetch->files;
+  out->bytes = prefetch->bytes;
+  out->launches = prefetch->launches;
+  out->launches_warm = prefetch->launches_warm;
+  out->launches_partial = prefetch->launches_partial;
+  pthread_mutex_unlock(&prefetch->lock);
+}
@@ -6,7 +6,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
-#include <pthread.h>
+#include <poll.h>
 #include <stddef.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -87,31 +87,38 @@ static int is_peer_nizam_dock(int fd) {
   return strcmp(comm, "nizam-dock") == 0;
 }
 
-static int dock_ipc_try_send_reload(void) {
-  char path[256];
-  build_dock_ipc_socket_path(path, sizeof(path));
+static int dock_ipc_fill_addr(struct sockaddr_un *addr, socklen_t *addr_len,
+                              char *path, size_t path_size) {
+  build_dock_ipc_socket_path(path, path_size);
   if (!path[0]) {
     return 0;
   }
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
 
-  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
-  if (fd < 0) {
+  size_t path_len = strnlen(path, path_size);
+  if (path_len == 0 || path_len >= sizeof(addr->sun_path)) {
     return 0;
   }
-  socket_set_cloexec(fd);
+  memcpy(addr->sun_path, path, path_len + 1);
+  *addr_len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + path_len + 1);
+  return 1;
+}
 
+static int dock_ipc_try_send(const char *cmd, int print_reply) {
+  char path[256];
   struct sockaddr_un addr;
-  memset(&addr, 0, sizeof(addr));
-  addr.sun_family = AF_UNIX;
+  socklen_t addr_len = 0;
+  if (!dock_ipc_fill_addr(&addr, &addr_len, path, sizeof(path))) {
+    return 0;
+  }
 
-  size_t path_len = strnlen(path, sizeof(path));
-  if (path_len == 0 || path_len >= sizeof(addr.sun_path)) {
-    close(fd);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
     return 0;
   }
-  memcpy(addr.sun_path, path, path_len + 1);
+  socket_set_cloexec(fd);
 
-  socklen_t addr_len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + path_len + 1);
   if (connect(fd, (struct sockaddr *)&addr, addr_len) != 0) {
     close(fd);
     return 0;
@@ -122,85 +129,89 @@ static int dock_ipc_try_send_reload(void) {
     return 0;
   }
 
-  const char *msg = "reload\n";
-  (void)write(fd, msg, strlen(msg));
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%s\n", cmd);
+  (void)send(fd, msg, strlen(msg), MSG_NOSIGNAL);
+  shutdown(fd, SHUT_WR);
+  if (!print_reply) {
+    close(fd);
+    return 1;
+  }
+
+  char buf[512];
+  for (;;) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    int pr = poll(&pfd, 1, NIZAM_DOCK_IPC_TIMEOUT_MS);
+    if (pr < 0 && errno == EINTR) {
+      continue;
+    }
+    if (pr <= 0) {
+      fprintf(stderr, "nizam-dock: no reply from running dock\n");
+      break;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    fwrite(buf, 1, (size_t)n, stdout);
+  }
   close(fd);
   return 1;
 }
 
-static void *dock_ipc_thread_main(void *arg) {
-  (void)arg;
-
+static int dock_ipc_listen(void) {
   char path[256];
-  build_dock_ipc_socket_path(path, sizeof(path));
-  if (!path[0]) {
-    return NULL;
+  struct sockaddr_un addr;
+  socklen_t addr_len = 0;
+  if (!dock_ipc_fill_addr(&addr, &addr_len, path, sizeof(path))) {
+    return -1;
   }
 
-  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
   if (fd < 0) {
-    return NULL;
+    return -1;
   }
   socket_set_cloexec(fd);
 
-  struct sockaddr_un addr;
-  memset(&addr, 0, sizeof(addr));
-  addr.sun_family = AF_UNIX;
-
-  size_t path_len = strnlen(path, sizeof(path));
-  if (path_len == 0 || path_len >= sizeof(addr.sun_path)) {
-    close(fd);
-    return NULL;
-  }
-  memcpy(addr.sun_path, path, path_len + 1);
-
   
   unlink(path);
 
-  socklen_t addr_len = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + path_len + 1);
   if (bind(fd, (struct sockaddr *)&addr, addr_len) != 0) {
     close(fd);
-    return NULL;
+    return -1;
   }
 
   if (listen(fd, 4) != 0) {
     close(fd);
-    return NULL;
+    unlink(path);
+    return -1;
   }
+  return fd;
+}
 
-  for (;;) {
-    int cfd = accept(fd, NULL, NULL);
-    if (cfd < 0) {
-      if (errno == EINTR) {
-        continue;
-      }
-      
-      continue;
-    }
-    socket_set_cloexec(cfd);
-
-    char buf[64];
-    ssize_t n = read(cfd, buf, sizeof(buf) - 1);
-    if (n > 0) {
-      buf[n] = '\0';
-      if (strncmp(buf, "reload", 6) == 0) {
-        nizam_dock_request_config_reload();
-      }
-    }
-    close(cfd);
+static void dock_ipc_close(int fd) {
+  if (fd < 0) {
+    return;
+  }
+  close(fd);
+  char path[256];
+  build_dock_ipc_socket_path(path, sizeof(path));
+  if (path[0]) {
+    unlink(path);
   }
-
-  
-  
-  
-  
 }
 
-static void dock_ipc_start(void) {
-  pthread_t thr;
-  if (pthread_create(&thr, NULL, dock_ipc_thread_main, NULL) == 0) {
-    pthread_detach(thr);
+static int dock_ipc_is_command(const char *arg) {
+  static const char *cmds[] = {"reload", "stats", "show", "hide"};
+  for (size_t i = 0; i < sizeof(cmds) / sizeof(cmds[0]); ++i) {
+    if (strcmp(arg, cmds[i]) == 0) {
+      return 1;
+    }
   }
+  return 0;
 }
 
 static int nizam_dock_debug_enabled(void) {
@@ -218,18 +229,25 @@ static void debug_dump_cfg(const struct nizam_dock_config *cfg) {
 }
 
 int main(int argc, char **argv) {
-  
-  
-  if (dock_ipc_try_send_reload()) {
+  if (argc > 1) {
+    if (!dock_ipc_is_command(argv[1])) {
+      fprintf(stderr, "usage: nizam-dock [reload|stats|show|hide]\n");
+      return 2;
+    }
+    if (!dock_ipc_try_send(argv[1], 1)) {
+      fprintf(stderr, "nizam-dock: no running dock\n");
+      return 1;
+    }
     return 0;
   }
 
-  dock_ipc_start();
-
   
   
-  (void)argc;
-  (void)argv;
+  if (dock_ipc_try_send("reload", 0)) {
+    return 0;
+  }
+
+  int ipc_fd = dock_ipc_listen();
 
   struct nizam_dock_config cfg;
   nizam_dock_config_init_defaults(&cfg);
@@ -242,6 +260,7 @@ int main(int argc, char **argv) {
     if (nizam_dock_debug_enabled()) {
       fprintf(stderr, "nizam-dock: disabled via config, exiting\n");
     }
+    dock_ipc_close(ipc_fd);
     nizam_dock_config_free(&cfg);
     return 0;
   }
@@ -249,9 +268,11 @@ int main(int argc, char **argv) {
   struct nizam_dock_app app;
   if (nizam_dock_xcb_init(&app, &cfg) != 0) {
     fprintf(stderr, "nizam-dock: failed to init XCB\n");
+    dock_ipc_close(ipc_fd);
     nizam_dock_config_free(&cfg);
     return 1;
   }
+  app.ipc_fd = ipc_fd;
   if (nizam_dock_debug_enabled()) {
     fprintf(stderr, "nizam-dock: xcb init ok\n");
   }
@@ -285,6 +306,7 @@ int main(int argc, char **argv) {
   nizam_dock_icons_free(&app);
   nizam_dock_sni_cleanup(&app);
   nizam_dock_xcb_cleanup(&app);
+  dock_ipc_close(ipc_fd);
   nizam_dock_config_free(&cfg);
   return 0;
 }
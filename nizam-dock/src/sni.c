@@ -4,21 +4,103 @@
 #include <dbus/dbus.h>
 #include <dirent.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#ifdef NIZAM_HAVE_LIBRSVG
+#include <librsvg/rsvg.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
-#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "nizam_pixel.h"
 #include "xcb_app.h"
 
 #define SNI_WATCHER_BUS "org.kde.StatusNotifierWatcher"
 #define SNI_WATCHER_PATH "/StatusNotifierWatcher"
 #define SNI_WATCHER_IFACE "org.kde.StatusNotifierWatcher"
 #define SNI_ITEM_IFACE "org.kde.StatusNotifierItem"
+#define SNI_KDE_ITEM_PATH "/org/kde/StatusNotifierItem"
+#define SNI_AYATANA_ITEM_BASE "/org/ayatana/NotificationItem"
+
+#define SNI_CAPS_CACHE_SIZE 32
+#define SNI_SURFACE_CACHE_SIZE 32
+#define SNI_ICON_RECHECK_MS 5000
+
+enum sni_item_state {
+  SNI_ITEM_IDLE = 0,
+  SNI_ITEM_PROBE_PATH,
+  SNI_ITEM_PROBE_KDE,
+  SNI_ITEM_PROBE_AYATANA,
+  SNI_ITEM_PROBE_AYATANA_CHILD,
+  SNI_ITEM_INTROSPECT
+};
+
+enum sni_prop {
+  SNI_PROP_MENU,
+  SNI_PROP_ITEM_IS_MENU,
+  SNI_PROP_ICON_THEME_PATH,
+  SNI_PROP_ICON_PIXMAP,
+  SNI_PROP_ICON_NAME,
+  SNI_PROP_ATTENTION_ICON_PIXMAP,
+  SNI_PROP_ATTENTION_ICON_NAME,
+  SNI_PROP_OVERLAY_ICON_PIXMAP,
+  SNI_PROP_OVERLAY_ICON_NAME,
+  SNI_PROP_COUNT
+};
+
+static const char *const sni_prop_names[SNI_PROP_COUNT] = {
+  "Menu",
+  "ItemIsMenu",
+  "IconThemePath",
+  "IconPixmap",
+  "IconName",
+  "AttentionIconPixmap",
+  "AttentionIconName",
+  "OverlayIconPixmap",
+  "OverlayIconName"
+};
+
+struct sni_props {
+  DBusMessageIter value[SNI_PROP_COUNT];
+  int have[SNI_PROP_COUNT];
+};
+
+struct sni_icon_step {
+  enum sni_prop prop;
+  int pixmap;
+  const char *label;
+};
+
+static const struct sni_icon_step sni_icon_steps[] = {
+  {SNI_PROP_ICON_PIXMAP, 1, "pixmap"},
+  {SNI_PROP_ICON_NAME, 0, "name"},
+  {SNI_PROP_ATTENTION_ICON_PIXMAP, 1, "attention pixmap"},
+  {SNI_PROP_ATTENTION_ICON_NAME, 0, "attention name"},
+  {SNI_PROP_OVERLAY_ICON_PIXMAP, 1, "overlay pixmap"},
+  {SNI_PROP_OVERLAY_ICON_NAME, 0, "overlay name"}
+};
+
+struct sni_caps {
+  char service[128];
+  char path[256];
+  int has_activate;
+  int has_secondary;
+  int has_context;
+  int has_xayatana_secondary;
+};
+
+struct sni_surface_entry {
+  char path[512];
+  struct timespec mtime;
+  int size;
+  cairo_surface_t *surface;
+  uint64_t last_used;
+};
 
 struct nizam_dock_sni_item {
+  uint32_t id;
   char service[128];
   char owner[128];
   char path[256];
@@ -33,6 +115,20 @@ struct nizam_dock_sni_item {
   int has_xayatana_secondary;
   int item_is_menu;
   int introspected;
+  enum sni_item_state state;
+  DBusPendingCall *pending;
+  int refresh_queued;
+  char probe_path[256];
+};
+
+struct sni_call {
+  struct nizam_dock_app *app;
+  uint32_t item_id;
+};
+
+struct sni_timeout {
+  DBusTimeout *timeout;
+  int64_t deadline_ms;
 };
 
 struct nizam_dock_sni {
@@ -42,6 +138,22 @@ struct nizam_dock_sni {
   size_t count;
   size_t cap;
   int dirty;
+  uint32_t next_id;
+  struct sni_timeout *timeouts;
+  size_t timeout_count;
+  size_t timeout_cap;
+  uint32_t menu_item_id;
+  DBusPendingCall *menu_pending;
+  int menu_result;
+  struct nizam_dock_menu_item *menu_items;
+  size_t menu_count;
+  int refresh_pending;
+  struct sni_caps caps_cache[SNI_CAPS_CACHE_SIZE];
+  size_t caps_next;
+  struct sni_surface_entry surface_cache[SNI_SURFACE_CACHE_SIZE];
+  uint64_t surface_clock;
+  uint64_t surface_hits;
+  uint64_t surface_misses;
 };
 
 static const char *sni_best_icon_path_in_dir(const char *base,
@@ -85,18 +197,50 @@ static void nizam_dock_debug_log3(const char *prefix, const char *value, const c
   }
 }
 
+static void sni_method_notify(DBusPendingCall *pending, void *data) {
+  const char *method = data;
+  DBusMessage *reply = dbus_pending_call_steal_reply(pending);
+  if (!reply) {
+    return;
+  }
+  if (dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR &&
+      nizam_dock_debug_enabled()) {
+    const char *name = dbus_message_get_error_name(reply);
+    fprintf(stderr, "nizam-dock: sni method %s failed: %s\n",
+            method, name ? name : "unknown");
+  }
+  dbus_message_unref(reply);
+}
+
+static int sni_send_method(struct nizam_dock_sni *sni, DBusMessage *msg, const char *method) {
+  if (!sni || !msg) {
+    return 0;
+  }
+  DBusPendingCall *pending = NULL;
+  int ok = dbus_connection_send_with_reply(sni->conn, msg, &pending, 500) && pending != NULL;
+  dbus_message_unref(msg);
+  if (!ok) {
+    if (nizam_dock_debug_enabled()) {
+      fprintf(stderr, "nizam-dock: sni method %s not sent\n", method);
+    }
+    return 0;
+  }
+  dbus_pending_call_set_notify(pending, sni_method_notify, (void *)method, NULL);
+  dbus_pending_call_unref(pending);
+  dbus_connection_flush(sni->conn);
+  return 1;
+}
+
 static int sni_call_method(struct nizam_dock_sni *sni,
                            struct nizam_dock_sni_item *item,
-                           const char *iface,
                            const char *method,
-                           const char *path,
                            int x,
                            int y) {
-  if (!sni || !item || !iface || !method || !path) {
+  if (!sni || !item || !method) {
     return 0;
   }
   DBusMessage *msg = dbus_message_new_method_call(
-      item->service, path, iface, method);
+      item->service, item->path, SNI_ITEM_IFACE, method);
   if (!msg) {
     return 0;
   }
@@ -106,25 +250,7 @@ static int sni_call_method(struct nizam_dock_sni *sni,
                            DBUS_TYPE_INT32, &xi,
                            DBUS_TYPE_INT32, &yi,
                            DBUS_TYPE_INVALID);
-  DBusError err;
-  dbus_error_init(&err);
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(
-      sni->conn, msg, 500, &err);
-  dbus_message_unref(msg);
-  if (!reply) {
-    if (nizam_dock_debug_enabled()) {
-      fprintf(stderr, "nizam-dock: sni method %s failed (%s %s): %s\n",
-              method, iface, path, err.message ? err.message : "unknown");
-    }
-    dbus_error_free(&err);
-    return 0;
-  }
-  dbus_message_unref(reply);
-  dbus_connection_flush(sni->conn);
-  if (strcmp(item->path, path) != 0) {
-    snprintf(item->path, sizeof(item->path), "%s", path);
-  }
-  return 1;
+  return sni_send_method(sni, msg, method);
 }
 
 static int sni_normalize_icon_name(const char *name, char *out, size_t out_size) {
@@ -183,7 +309,18 @@ static void sni_item_clear_icon(struct nizam_dock_sni_item *item) {
   item->icon_h = 0;
 }
 
+static void sni_item_cancel(struct nizam_dock_sni_item *item) {
+  if (item->pending) {
+    dbus_pending_call_cancel(item->pending);
+    dbus_pending_call_unref(item->pending);
+    item->pending = NULL;
+  }
+  item->state = SNI_ITEM_IDLE;
+  item->refresh_queued = 0;
+}
+
 static void sni_item_clear_full(struct nizam_dock_sni_item *item) {
+  sni_item_cancel(item);
   sni_item_clear_icon(item);
   item->menu_path[0] = '\0';
   item->has_activate = 0;
@@ -200,6 +337,18 @@ static void sni_set_dirty(struct nizam_dock_sni *sni) {
   }
 }
 
+static struct nizam_dock_sni_item *sni_find_by_id(struct nizam_dock_sni *sni, uint32_t id) {
+  if (!sni || id == 0) {
+    return NULL;
+  }
+  for (size_t i = 0; i < sni->count; ++i) {
+    if (sni->items[i].id == id) {
+      return &sni->items[i];
+    }
+  }
+  return NULL;
+}
+
 static struct nizam_dock_sni_item *sni_find_by_owner(struct nizam_dock_sni *sni, const char *owner) {
   if (!sni || !owner) {
     return NULL;
@@ -253,12 +402,79 @@ static int sni_ensure_capacity(struct nizam_dock_sni *sni) {
   return 1;
 }
 
-static int sni_is_dir(const char *path) {
-  struct stat st;
-  if (stat(path, &st) != 0) {
-    return 0;
+static int64_t sni_now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void sni_timeout_arm(struct sni_timeout *t) {
+  if (!dbus_timeout_get_enabled(t->timeout)) {
+    t->deadline_ms = 0;
+    return;
+  }
+  int interval = dbus_timeout_get_interval(t->timeout);
+  t->deadline_ms = sni_now_ms() + (interval > 0 ? interval : 1);
+}
+
+static struct sni_timeout *sni_timeout_find(struct nizam_dock_sni *sni, DBusTimeout *timeout) {
+  for (size_t i = 0; i < sni->timeout_count; ++i) {
+    if (sni->timeouts[i].timeout == timeout) {
+      return &sni->timeouts[i];
+    }
+  }
+  return NULL;
+}
+
+static dbus_bool_t sni_timeout_add(DBusTimeout *timeout, void *data) {
+  struct nizam_dock_sni *sni = data;
+  if (sni->timeout_count == sni->timeout_cap) {
+    size_t next = sni->timeout_cap == 0 ? 8 : sni->timeout_cap * 2;
+    struct sni_timeout *timeouts = realloc(sni->timeouts, next * sizeof(*timeouts));
+    if (!timeouts) {
+      return FALSE;
+    }
+    sni->timeouts = timeouts;
+    sni->timeout_cap = next;
+  }
+  struct sni_timeout *t = &sni->timeouts[sni->timeout_count++];
+  t->timeout = timeout;
+  sni_timeout_arm(t);
+  return TRUE;
+}
+
+static void sni_timeout_remove(DBusTimeout *timeout, void *data) {
+  struct nizam_dock_sni *sni = data;
+  struct sni_timeout *t = sni_timeout_find(sni, timeout);
+  if (t) {
+    *t = sni->timeouts[--sni->timeout_count];
+  }
+}
+
+static void sni_timeout_toggled(DBusTimeout *timeout, void *data) {
+  struct sni_timeout *t = sni_timeout_find(data, timeout);
+  if (t) {
+    sni_timeout_arm(t);
+  }
+}
+
+static void sni_timeouts_handle(struct nizam_dock_sni *sni) {
+  for (;;) {
+    int64_t now = sni_now_ms();
+    struct sni_timeout *due = NULL;
+    for (size_t i = 0; i < sni->timeout_count; ++i) {
+      if (sni->timeouts[i].deadline_ms && now >= sni->timeouts[i].deadline_ms) {
+        due = &sni->timeouts[i];
+        break;
+      }
+    }
+    if (!due) {
+      return;
+    }
+    DBusTimeout *timeout = due->timeout;
+    sni_timeout_arm(due);
+    dbus_timeout_handle(timeout);
   }
-  return S_ISDIR(st.st_mode);
 }
 
 static int sni_try_icon_file(const char *path) {
@@ -271,36 +487,182 @@ static int sni_try_icon_file(const char *path) {
   return 1;
 }
 
-static int sni_run_rsvg_convert(const char *input, const char *output, int size) {
-  char wbuf[16];
-  char hbuf[16];
-  snprintf(wbuf, sizeof(wbuf), "%d", size);
-  snprintf(hbuf, sizeof(hbuf), "%d", size);
-  pid_t pid = fork();
-  if (pid == 0) {
-    execlp("rsvg-convert", "rsvg-convert", "-w", wbuf, "-h", hbuf,
-           "-o", output, input, (char *)NULL);
-    _exit(127);
+struct sni_dir_index {
+  int exists;
+  struct timespec mtime;
+  GHashTable *files;
+  GPtrArray *names;
+};
+
+static GHashTable *sni_dir_indexes;
+static GHashTable *sni_icon_lookups;
+static int64_t sni_icon_checked_ms;
+static uint64_t sni_icon_hits;
+static uint64_t sni_icon_misses;
+
+static void sni_dir_index_free(gpointer data) {
+  struct sni_dir_index *index = data;
+  if (!index) {
+    return;
   }
-  if (pid < 0) {
-    return 0;
+  g_ptr_array_free(index->names, TRUE);
+  g_hash_table_destroy(index->files);
+  g_free(index);
+}
+
+static void sni_icon_cache_reset(void) {
+  if (sni_icon_lookups) {
+    g_hash_table_destroy(sni_icon_lookups);
+    sni_icon_lookups = NULL;
   }
-  int status = 0;
-  if (waitpid(pid, &status, 0) < 0) {
-    return 0;
+  if (sni_dir_indexes) {
+    g_hash_table_destroy(sni_dir_indexes);
+    sni_dir_indexes = NULL;
   }
-  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
 }
 
-static cairo_surface_t *sni_load_icon_surface(const char *path, unsigned char **out_data) {
+static struct sni_dir_index *sni_dir_index_get(const char *path) {
+  if (!sni_dir_indexes) {
+    sni_dir_indexes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, sni_dir_index_free);
+  }
+  struct sni_dir_index *index = g_hash_table_lookup(sni_dir_indexes, path);
+  if (index) {
+    return index;
+  }
+  index = g_new0(struct sni_dir_index, 1);
+  index->files = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  index->names = g_ptr_array_new();
+  struct stat st;
+  if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+    index->exists = 1;
+    index->mtime = st.st_mtim;
+    DIR *dir = opendir(path);
+    if (dir) {
+      struct dirent *ent;
+      while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') {
+          continue;
+        }
+        char *file = g_strdup(ent->d_name);
+        g_hash_table_add(index->files, file);
+        g_ptr_array_add(index->names, file);
+      }
+      closedir(dir);
+    }
+  }
+  g_hash_table_insert(sni_dir_indexes, g_strdup(path), index);
+  return index;
+}
+
+static void sni_icon_cache_validate(void) {
+  int64_t now = sni_now_ms();
+  if (sni_icon_checked_ms && now - sni_icon_checked_ms < SNI_ICON_RECHECK_MS) {
+    return;
+  }
+  sni_icon_checked_ms = now;
+  if (!sni_dir_indexes) {
+    return;
+  }
+  int changed = 0;
+  GHashTableIter iter;
+  gpointer key;
+  gpointer value;
+  g_hash_table_iter_init(&iter, sni_dir_indexes);
+  while (!changed && g_hash_table_iter_next(&iter, &key, &value)) {
+    struct sni_dir_index *index = value;
+    struct stat st;
+    int exists = stat(key, &st) == 0 && S_ISDIR(st.st_mode);
+    if (exists != index->exists ||
+        (exists && (st.st_mtim.tv_sec != index->mtime.tv_sec ||
+                    st.st_mtim.tv_nsec != index->mtime.tv_nsec))) {
+      nizam_dock_debug_log2("sni icon dir changed: ", key);
+      changed = 1;
+    }
+  }
+  if (changed) {
+    sni_icon_cache_reset();
+  }
+}
+
+static const char *sni_icon_candidate(const char *dir,
+                                      const char *file,
+                                      char *out,
+                                      size_t out_size) {
+  struct sni_dir_index *index = sni_dir_index_get(dir);
+  if (!g_hash_table_contains(index->files, file)) {
+    return NULL;
+  }
+  snprintf(out, out_size, "%s/%s", dir, file);
+  return out;
+}
+
+#ifdef NIZAM_HAVE_LIBRSVG
+static cairo_surface_t *sni_render_svg(const char *path, int size) {
+  GError *gerr = NULL;
+  RsvgHandle *handle = rsvg_handle_new_from_file(path, &gerr);
+  if (!handle) {
+    if (gerr) {
+      nizam_dock_debug_log2("sni svg load detail: ", gerr->message);
+      g_error_free(gerr);
+    }
+    return NULL;
+  }
+  cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+  if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(surface);
+    g_object_unref(handle);
+    return NULL;
+  }
+  cairo_t *cr = cairo_create(surface);
+  int ok = 0;
+#if LIBRSVG_CHECK_VERSION(2, 52, 0)
+  RsvgRectangle viewport = {0.0, 0.0, (double)size, (double)size};
+  ok = rsvg_handle_render_document(handle, cr, &viewport, &gerr);
+  if (gerr) {
+    g_error_free(gerr);
+  }
+#else
+  RsvgDimensionData dim;
+  rsvg_handle_get_dimensions(handle, &dim);
+  double iw = dim.width > 0 ? (double)dim.width : (double)size;
+  double ih = dim.height > 0 ? (double)dim.height : (double)size;
+  double scale = (double)size / (iw > ih ? iw : ih);
+  cairo_translate(cr, (size - iw * scale) / 2.0, (size - ih * scale) / 2.0);
+  cairo_scale(cr, scale, scale);
+  ok = rsvg_handle_render_cairo(handle, cr);
+#endif
+  cairo_destroy(cr);
+  g_object_unref(handle);
+  if (!ok) {
+    cairo_surface_destroy(surface);
+    return NULL;
+  }
+  cairo_surface_flush(surface);
+  return surface;
+}
+#endif
+
+static cairo_surface_t *sni_load_icon_surface(const char *path, int size,
+                                              unsigned char **out_data) {
   if (!path || !*path) {
     return NULL;
   }
   if (out_data) {
     *out_data = NULL;
   }
+  int is_svg = sni_has_suffix(path, ".svg") || sni_has_suffix(path, ".svgz");
+#ifdef NIZAM_HAVE_LIBRSVG
+  if (is_svg) {
+    cairo_surface_t *svg = sni_render_svg(path, size);
+    if (svg) {
+      return svg;
+    }
+  }
+#endif
   GError *gerr = NULL;
-  GdkPixbuf *pixbuf = gdk_pixbuf_new_from_file(path, &gerr);
+  GdkPixbuf *pixbuf = is_svg
+                        ? gdk_pixbuf_new_from_file_at_scale(path, size, size, TRUE, &gerr)
+                        : gdk_pixbuf_new_from_file(path, &gerr);
   if (pixbuf) {
     int w = gdk_pixbuf_get_width(pixbuf);
     int h = gdk_pixbuf_get_height(pixbuf);
@@ -316,26 +678,14 @@ static cairo_surface_t *sni_load_icon_surface(const char *path, unsigned char **
     }
     for (int y = 0; y < h; ++y) {
       const guchar *row = src + y * stride_src;
-      unsigned char *out = dst + y * stride_dst;
-      for (int x = 0; x < w; ++x) {
-        unsigned char r = row[x * channels + 0];
-        unsigned char g = row[x * channels + 1];
-        unsigned char b = row[x * channels + 2];
-        unsigned char a = has_alpha ? row[x * channels + 3] : 255;
-        unsigned char pr = (unsigned char)((r * a + 127) / 255);
-        unsigned char pg = (unsigned char)((g * a + 127) / 255);
-        unsigned char pb = (unsigned char)((b * a + 127) / 255);
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-        out[x * 4 + 0] = pb;
-        out[x * 4 + 1] = pg;
-        out[x * 4 + 2] = pr;
-        out[x * 4 + 3] = a;
-#else
-        out[x * 4 + 0] = a;
-        out[x * 4 + 1] = pr;
-        out[x * 4 + 2] = pg;
-        out[x * 4 + 3] = pb;
-#endif
+      uint32_t *out = (uint32_t *)(dst + y * stride_dst);
+      if (has_alpha && channels == 4) {
+        nizam_pixel_rgba_to_argb32(out, row, (size_t)w);
+      } else {
+        for (int x = 0; x < w; ++x) {
+          const guchar *p = row + x * channels;
+          out[x] = 0xff000000u | (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+        }
       }
     }
     g_object_unref(pixbuf);
@@ -358,42 +708,10 @@ static cairo_surface_t *sni_load_icon_surface(const char *path, unsigned char **
     }
     g_error_free(gerr);
   }
-  if (sni_has_suffix(path, ".svg") || sni_has_suffix(path, ".svgz")) {
-    char tmp[] = "/tmp/nizam-dock-svg-XXXXXX";
-    int fd = mkstemp(tmp);
-    if (fd < 0) {
-      return NULL;
-    }
-    close(fd);
-    char out[512];
-    snprintf(out, sizeof(out), "%s.png", tmp);
-    unlink(tmp);
-    if (!sni_run_rsvg_convert(path, out, 64)) {
-      unlink(out);
-      return NULL;
-    }
-    cairo_surface_t *surface = cairo_image_surface_create_from_png(out);
-    unlink(out);
-    if (cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS) {
-      return surface;
-    }
-    cairo_surface_destroy(surface);
-    return NULL;
-  }
   return NULL;
 }
 
-static const char *sni_best_icon_path(const char *name, char *out, size_t out_size) {
-  if (!name || !*name) {
-    return NULL;
-  }
-  if (strchr(name, '/')) {
-    if (sni_try_icon_file(name)) {
-      snprintf(out, out_size, "%s", name);
-      return out;
-    }
-    return NULL;
-  }
+static const char *sni_search_icon_path(const char *name, char *out, size_t out_size) {
   const char *suffixes[] = {".png", ".svg", ".svgz", ".xpm"};
   for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); ++i) {
     snprintf(out, out_size, "%s%s", name, suffixes[i]);
@@ -402,8 +720,7 @@ static const char *sni_best_icon_path(const char *name, char *out, size_t out_si
       return out;
     }
   }
-  snprintf(out, out_size, "/usr/share/pixmaps/%s", name);
-  if (sni_try_icon_file(out)) {
+  if (sni_icon_candidate("/usr/share/pixmaps", name, out, out_size)) {
     nizam_dock_debug_log2("sni icon path: ", out);
     return out;
   }
@@ -445,39 +762,29 @@ static const char *sni_best_icon_path(const char *name, char *out, size_t out_si
     snprintf(icons_root, sizeof(icons_root), "%s/icons", dirs[i]);
     snprintf(pix_root, sizeof(pix_root), "%s/pixmaps", dirs[i]);
 
-    if (sni_is_dir(icons_root)) {
-      DIR *dir = opendir(icons_root);
-      if (dir) {
-        struct dirent *ent;
-        while ((ent = readdir(dir)) != NULL) {
-          if (ent->d_name[0] == '.') {
-            continue;
-          }
-          char theme_path[512];
-          snprintf(theme_path, sizeof(theme_path), "%s/%s", icons_root, ent->d_name);
-          if (!sni_is_dir(theme_path)) {
-            continue;
-          }
-          if (sni_best_icon_path_in_dir(theme_path, name, out, out_size)) {
-            nizam_dock_debug_log2("sni icon path: ", out);
-            closedir(dir);
-            free(dirs_copy);
-            return out;
-          }
-        }
-        closedir(dir);
+    GPtrArray *themes = sni_dir_index_get(icons_root)->names;
+    for (guint t = 0; t < themes->len; ++t) {
+      char theme_path[512];
+      snprintf(theme_path, sizeof(theme_path), "%s/%s", icons_root,
+               (const char *)g_ptr_array_index(themes, t));
+      if (!sni_dir_index_get(theme_path)->exists) {
+        continue;
+      }
+      if (sni_best_icon_path_in_dir(theme_path, name, out, out_size)) {
+        nizam_dock_debug_log2("sni icon path: ", out);
+        free(dirs_copy);
+        return out;
       }
     }
 
-    if (sni_is_dir(pix_root)) {
-      const char *pix_exts[] = {".png", ".svg", ".xpm"};
-      for (size_t e = 0; e < sizeof(pix_exts) / sizeof(pix_exts[0]); ++e) {
-        snprintf(out, out_size, "%s/%s%s", pix_root, name, pix_exts[e]);
-        if (sni_try_icon_file(out)) {
-          nizam_dock_debug_log2("sni icon path: ", out);
-          free(dirs_copy);
-          return out;
-        }
+    const char *pix_exts[] = {".png", ".svg", ".xpm"};
+    for (size_t e = 0; e < sizeof(pix_exts) / sizeof(pix_exts[0]); ++e) {
+      char file[320];
+      snprintf(file, sizeof(file), "%s%s", name, pix_exts[e]);
+      if (sni_icon_candidate(pix_root, file, out, out_size)) {
+        nizam_dock_debug_log2("sni icon path: ", out);
+        free(dirs_copy);
+        return out;
       }
     }
   }
@@ -485,18 +792,59 @@ static const char *sni_best_icon_path(const char *name, char *out, size_t out_si
   free(dirs_copy);
   const char *fallback_exts[] = {".png", ".svg", ".xpm"};
   for (size_t e = 0; e < sizeof(fallback_exts) / sizeof(fallback_exts[0]); ++e) {
-    snprintf(out, out_size, "/usr/share/pixmaps/%s%s", name, fallback_exts[e]);
-    if (sni_try_icon_file(out)) {
+    char file[320];
+    snprintf(file, sizeof(file), "%s%s", name, fallback_exts[e]);
+    if (sni_icon_candidate("/usr/share/pixmaps", file, out, out_size)) {
       nizam_dock_debug_log2("sni icon path: ", out);
       return out;
     }
   }
-  snprintf(out, out_size, "/usr/share/pixmaps/%s", name);
-  if (sni_try_icon_file(out)) {
-    nizam_dock_debug_log2("sni icon path: ", out);
+  return NULL;
+}
+
+static const char *sni_icon_lookup(const char *theme_path,
+                                   const char *name,
+                                   char *out,
+                                   size_t out_size) {
+  sni_icon_cache_validate();
+  if (!sni_icon_lookups) {
+    sni_icon_lookups = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+  }
+  char *key = theme_path ? g_strconcat(theme_path, "\n", name, NULL) : g_strdup(name);
+  const char *cached = g_hash_table_lookup(sni_icon_lookups, key);
+  if (cached) {
+    g_free(key);
+    sni_icon_hits++;
+    if (!*cached) {
+      return NULL;
+    }
+    snprintf(out, out_size, "%s", cached);
     return out;
   }
-  return NULL;
+  sni_icon_misses++;
+  const char *found = theme_path ? sni_best_icon_path_in_dir(theme_path, name, out, out_size)
+                                 : sni_search_icon_path(name, out, out_size);
+  g_hash_table_insert(sni_icon_lookups, key, g_strdup(found ? out : ""));
+  if (nizam_dock_debug_enabled()) {
+    fprintf(stderr, "nizam-dock: sni icon resolved %s -> %s (hits=%llu misses=%llu)\n",
+            name, found ? out : "(none)", (unsigned long long)sni_icon_hits,
+            (unsigned long long)sni_icon_misses);
+  }
+  return found;
+}
+
+static const char *sni_best_icon_path(const char *name, char *out, size_t out_size) {
+  if (!name || !*name) {
+    return NULL;
+  }
+  if (strchr(name, '/')) {
+    if (sni_try_icon_file(name)) {
+      snprintf(out, out_size, "%s", name);
+      return out;
+    }
+    return NULL;
+  }
+  return sni_icon_lookup(NULL, name, out, out_size);
 }
 
 static cairo_user_data_key_t nizam_dock_icon_data_key;
@@ -507,7 +855,7 @@ const char *nizam_dock_resolve_icon_path(const char *name, char *out, size_t out
 
 cairo_surface_t *nizam_dock_load_icon_surface(const char *path) {
   unsigned char *data = NULL;
-  cairo_surface_t *surface = sni_load_icon_surface(path, &data);
+  cairo_surface_t *surface = sni_load_icon_surface(path, 64, &data);
   if (!surface) {
     return NULL;
   }
@@ -517,6 +865,67 @@ cairo_surface_t *nizam_dock_load_icon_surface(const char *path) {
   return surface;
 }
 
+static cairo_surface_t *sni_surface_cache_load(struct nizam_dock_sni *sni,
+                                               const char *path,
+                                               int size) {
+  struct stat st;
+  if (!sni || !path || stat(path, &st) != 0) {
+    return NULL;
+  }
+  struct sni_surface_entry *slot = NULL;
+  for (size_t i = 0; i < SNI_SURFACE_CACHE_SIZE; ++i) {
+    struct sni_surface_entry *entry = &sni->surface_cache[i];
+    if (entry->surface && entry->size == size && strcmp(entry->path, path) == 0) {
+      if (entry->mtime.tv_sec == st.st_mtim.tv_sec &&
+          entry->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        entry->last_used = ++sni->surface_clock;
+        sni->surface_hits++;
+        return cairo_surface_reference(entry->surface);
+      }
+      slot = entry;
+      break;
+    }
+    if (!slot || !entry->surface ||
+        (slot->surface && entry->last_used < slot->last_used)) {
+      slot = entry;
+    }
+  }
+
+  unsigned char *data = NULL;
+  cairo_surface_t *surface = sni_load_icon_surface(path, size, &data);
+  if (!surface) {
+    return NULL;
+  }
+  if (data) {
+    cairo_surface_set_user_data(surface, &nizam_dock_icon_data_key, data, free);
+  }
+  sni->surface_misses++;
+  if (nizam_dock_debug_enabled()) {
+    fprintf(stderr, "nizam-dock: sni icon decoded %s at %dpx (hits=%llu misses=%llu)\n",
+            path, size, (unsigned long long)sni->surface_hits,
+            (unsigned long long)sni->surface_misses);
+  }
+  if (slot->surface) {
+    cairo_surface_destroy(slot->surface);
+  }
+  snprintf(slot->path, sizeof(slot->path), "%s", path);
+  slot->mtime = st.st_mtim;
+  slot->size = size;
+  slot->surface = cairo_surface_reference(surface);
+  slot->last_used = ++sni->surface_clock;
+  return surface;
+}
+
+static void sni_surface_cache_clear(struct nizam_dock_sni *sni) {
+  for (size_t i = 0; i < SNI_SURFACE_CACHE_SIZE; ++i) {
+    struct sni_surface_entry *entry = &sni->surface_cache[i];
+    if (entry->surface) {
+      cairo_surface_destroy(entry->surface);
+    }
+    memset(entry, 0, sizeof(*entry));
+  }
+}
+
 static const char *sni_best_icon_path_in_dir(const char *base,
                                              const char *name,
                                              char *out,
@@ -524,32 +933,34 @@ static const char *sni_best_icon_path_in_dir(const char *base,
   if (!base || !*base || !name || !*name) {
     return NULL;
   }
-  char hicolor[512];
-  snprintf(hicolor, sizeof(hicolor), "%s/hicolor", base);
-  if (sni_is_dir(hicolor)) {
-    if (sni_best_icon_path_in_dir(hicolor, name, out, out_size)) {
+  char dir[512];
+  char file[320];
+  snprintf(dir, sizeof(dir), "%s/hicolor", base);
+  if (sni_dir_index_get(dir)->exists) {
+    if (sni_best_icon_path_in_dir(dir, name, out, out_size)) {
       return out;
     }
   }
   const char *base_exts[] = {".png", ".svg", ".svgz", ".xpm"};
   for (size_t e = 0; e < sizeof(base_exts) / sizeof(base_exts[0]); ++e) {
-    snprintf(out, out_size, "%s/%s%s", base, name, base_exts[e]);
-    if (access(out, R_OK) == 0) {
+    snprintf(file, sizeof(file), "%s%s", name, base_exts[e]);
+    if (sni_icon_candidate(base, file, out, out_size)) {
       return out;
     }
   }
-  snprintf(out, out_size, "%s/%s@2x.png", base, name);
-  if (access(out, R_OK) == 0) {
+  snprintf(file, sizeof(file), "%s@2x.png", name);
+  if (sni_icon_candidate(base, file, out, out_size)) {
     return out;
   }
   const char *scalable_exts[] = {".svg", ".svgz", ".png"};
   for (size_t e = 0; e < sizeof(scalable_exts) / sizeof(scalable_exts[0]); ++e) {
-    snprintf(out, out_size, "%s/scalable/status/%s%s", base, name, scalable_exts[e]);
-    if (access(out, R_OK) == 0) {
+    snprintf(file, sizeof(file), "%s%s", name, scalable_exts[e]);
+    snprintf(dir, sizeof(dir), "%s/scalable/status", base);
+    if (sni_icon_candidate(dir, file, out, out_size)) {
       return out;
     }
-    snprintf(out, out_size, "%s/scalable/apps/%s%s", base, name, scalable_exts[e]);
-    if (access(out, R_OK) == 0) {
+    snprintf(dir, sizeof(dir), "%s/scalable/apps", base);
+    if (sni_icon_candidate(dir, file, out, out_size)) {
       return out;
     }
   }
@@ -564,23 +975,23 @@ static const char *sni_best_icon_path_in_dir(const char *base,
   const char *groups[] = {"status", "apps"};
   for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
     for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); ++g) {
+      snprintf(dir, sizeof(dir), "%s/%s/%s", base, sizes[s], groups[g]);
+      if (!sni_dir_index_get(dir)->exists) {
+        continue;
+      }
       const char *size_exts[] = {".png", ".svg", ".svgz", ".xpm", ".icon"};
       for (size_t e = 0; e < sizeof(size_exts) / sizeof(size_exts[0]); ++e) {
-        snprintf(out, out_size, "%s/%s/%s/%s%s", base, sizes[s], groups[g], name, size_exts[e]);
-        if (access(out, R_OK) == 0) {
+        snprintf(file, sizeof(file), "%s%s", name, size_exts[e]);
+        if (sni_icon_candidate(dir, file, out, out_size)) {
           return out;
         }
       }
-      snprintf(out, out_size, "%s/%s/%s/%s-symbolic.png", base, sizes[s], groups[g], name);
-      if (access(out, R_OK) == 0) {
+      snprintf(file, sizeof(file), "%s-symbolic.png", name);
+      if (sni_icon_candidate(dir, file, out, out_size)) {
         return out;
       }
     }
   }
-  snprintf(out, out_size, "%s/%s.png", base, name);
-  if (access(out, R_OK) == 0) {
-    return out;
-  }
   return NULL;
 }
 
@@ -599,47 +1010,63 @@ static int sni_set_icon_surface(struct nizam_dock_sni_item *item,
   return 1;
 }
 
-static int sni_fetch_icon_pixmap_prop(DBusConnection *conn,
-                                      struct nizam_dock_sni_item *item,
-                                      const char *prop) {
-  if (!prop || !*prop) {
-    return 0;
-  }
-  DBusMessage *msg = dbus_message_new_method_call(
-      item->service, item->path,
-      "org.freedesktop.DBus.Properties", "Get");
-  if (!msg) {
-    return 0;
+static int sni_reply_ok(DBusMessage *reply) {
+  return reply && dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN;
+}
+
+static const char *sni_variant_string(DBusMessageIter *variant) {
+  int vtype = dbus_message_iter_get_arg_type(variant);
+  if (vtype != DBUS_TYPE_STRING && vtype != DBUS_TYPE_OBJECT_PATH) {
+    return NULL;
   }
-  const char *iface = SNI_ITEM_IFACE;
-  dbus_message_append_args(msg,
-                           DBUS_TYPE_STRING, &iface,
-                           DBUS_TYPE_STRING, &prop,
-                           DBUS_TYPE_INVALID);
-  DBusError err;
-  dbus_error_init(&err);
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(conn, msg, 500, &err);
-  dbus_message_unref(msg);
-  if (!reply) {
-    dbus_error_free(&err);
+  const char *value = NULL;
+  dbus_message_iter_get_basic(variant, &value);
+  return value;
+}
+
+static int sni_props_parse(DBusMessage *reply, struct sni_props *props) {
+  memset(props, 0, sizeof(*props));
+  if (!sni_reply_ok(reply)) {
     return 0;
   }
-
   DBusMessageIter iter;
   dbus_message_iter_init(reply, &iter);
-  if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_VARIANT) {
-    dbus_message_unref(reply);
+  if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY) {
     return 0;
   }
-  DBusMessageIter variant;
-  dbus_message_iter_recurse(&iter, &variant);
-  if (dbus_message_iter_get_arg_type(&variant) != DBUS_TYPE_ARRAY) {
-    dbus_message_unref(reply);
+  DBusMessageIter array;
+  dbus_message_iter_recurse(&iter, &array);
+  while (dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_DICT_ENTRY) {
+    DBusMessageIter entry;
+    dbus_message_iter_recurse(&array, &entry);
+    const char *key = NULL;
+    dbus_message_iter_get_basic(&entry, &key);
+    dbus_message_iter_next(&entry);
+    if (key && dbus_message_iter_get_arg_type(&entry) == DBUS_TYPE_VARIANT) {
+      for (int i = 0; i < SNI_PROP_COUNT; ++i) {
+        if (strcmp(key, sni_prop_names[i]) == 0) {
+          dbus_message_iter_recurse(&entry, &props->value[i]);
+          props->have[i] = 1;
+          break;
+        }
+      }
+    }
+    dbus_message_iter_next(&array);
+  }
+  return 1;
+}
+
+static const char *sni_props_string(struct sni_props *props, enum sni_prop prop) {
+  return props->have[prop] ? sni_variant_string(&props->value[prop]) : NULL;
+}
+
+static int sni_set_icon_pixmap(struct nizam_dock_sni_item *item, DBusMessageIter *variant) {
+  if (dbus_message_iter_get_arg_type(variant) != DBUS_TYPE_ARRAY) {
     return 0;
   }
 
   DBusMessageIter array;
-  dbus_message_iter_recurse(&variant, &array);
+  dbus_message_iter_recurse(variant, &array);
   int best_w = 0;
   int best_h = 0;
   unsigned char *best_data = NULL;
@@ -676,7 +1103,6 @@ static int sni_fetch_icon_pixmap_prop(DBusConnection *conn,
     dbus_message_iter_next(&array);
   }
 
-  dbus_message_unref(reply);
   if (!best_data || best_w <= 0 || best_h <= 0) {
     free(best_data);
     return 0;
@@ -724,44 +1150,12 @@ static int sni_fetch_icon_pixmap_prop(DBusConnection *conn,
   }
   size_t row_bytes = (size_t)best_w * 4;
   for (int y = 0; y < best_h; ++y) {
-    unsigned char *dst = buf + (size_t)y * (size_t)stride;
-    unsigned char *src = best_data + (size_t)y * row_bytes;
-    for (int x = 0; x < best_w; ++x) {
-      unsigned char a = 0;
-      unsigned char r = 0;
-      unsigned char g = 0;
-      unsigned char b = 0;
-      if (alpha_is_byte3) {
-        
-        r = src[x * 4 + 0];
-        g = src[x * 4 + 1];
-        b = src[x * 4 + 2];
-        a = src[x * 4 + 3];
-      } else {
-        
-        a = src[x * 4 + 0];
-        r = src[x * 4 + 1];
-        g = src[x * 4 + 2];
-        b = src[x * 4 + 3];
-      }
-
-      
-      if (a != 255) {
-        r = (unsigned char)(((unsigned)r * (unsigned)a + 127u) / 255u);
-        g = (unsigned char)(((unsigned)g * (unsigned)a + 127u) / 255u);
-        b = (unsigned char)(((unsigned)b * (unsigned)a + 127u) / 255u);
-      }
-#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
-      dst[x * 4 + 0] = b;
-      dst[x * 4 + 1] = g;
-      dst[x * 4 + 2] = r;
-      dst[x * 4 + 3] = a;
-#else
-      dst[x * 4 + 0] = a;
-      dst[x * 4 + 1] = r;
-      dst[x * 4 + 2] = g;
-      dst[x * 4 + 3] = b;
-#endif
+    uint32_t *dst = (uint32_t *)(buf + (size_t)y * (size_t)stride);
+    const unsigned char *src = best_data + (size_t)y * row_bytes;
+    if (alpha_is_byte3) {
+      nizam_pixel_rgba_to_argb32(dst, src, (size_t)best_w);
+    } else {
+      nizam_pixel_argb_be_to_argb32(dst, src, (size_t)best_w);
     }
   }
   free(best_data);
@@ -776,107 +1170,35 @@ static int sni_fetch_icon_pixmap_prop(DBusConnection *conn,
   return sni_set_icon_surface(item, surface, buf, best_w, best_h);
 }
 
-static int sni_fetch_icon_pixmap(DBusConnection *conn,
-                                 struct nizam_dock_sni_item *item) {
-  return sni_fetch_icon_pixmap_prop(conn, item, "IconPixmap");
-}
-
-static int sni_fetch_icon_name_prop(DBusConnection *conn,
-                                    struct nizam_dock_sni_item *item,
-                                    const char *prop) {
-  if (!prop || !*prop) {
+static int sni_set_icon_by_name(struct nizam_dock_sni *sni,
+                                struct nizam_dock_sni_item *item,
+                                const char *raw_name,
+                                const char *theme_path) {
+  if (!item || !raw_name || !*raw_name) {
     return 0;
   }
-  DBusMessage *msg = dbus_message_new_method_call(
-      item->service, item->path,
-      "org.freedesktop.DBus.Properties", "Get");
-  if (!msg) {
+  nizam_dock_debug_log2("sni icon name: ", raw_name);
+  char name[256];
+  if (!sni_normalize_icon_name(raw_name, name, sizeof(name))) {
     return 0;
   }
-  const char *iface = SNI_ITEM_IFACE;
-  dbus_message_append_args(msg,
-                           DBUS_TYPE_STRING, &iface,
-                           DBUS_TYPE_STRING, &prop,
-                           DBUS_TYPE_INVALID);
-  DBusError err;
-  dbus_error_init(&err);
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(conn, msg, 500, &err);
-  dbus_message_unref(msg);
-  if (!reply) {
-    dbus_error_free(&err);
-    return 0;
-  }
-
-  DBusMessageIter iter;
-  dbus_message_iter_init(reply, &iter);
-  if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_VARIANT) {
-    dbus_message_unref(reply);
-    return 0;
-  }
-  DBusMessageIter variant;
-  dbus_message_iter_recurse(&iter, &variant);
-  const char *name = NULL;
-  if (dbus_message_iter_get_arg_type(&variant) == DBUS_TYPE_STRING) {
-    dbus_message_iter_get_basic(&variant, &name);
-  }
-  dbus_message_unref(reply);
-  if (!name || !*name) {
-    return 0;
-  }
-  nizam_dock_debug_log2("sni icon name: ", name);
-
-  char normalized[256];
-  if (!sni_normalize_icon_name(name, normalized, sizeof(normalized))) {
-    return 0;
-  }
-  if (strcmp(name, normalized) != 0) {
-    nizam_dock_debug_log2("sni icon name normalized: ", normalized);
+  if (strcmp(raw_name, name) != 0) {
+    nizam_dock_debug_log2("sni icon name normalized: ", name);
   }
-
   char path[512];
-  DBusMessage *path_msg = dbus_message_new_method_call(
-      item->service, item->path,
-      "org.freedesktop.DBus.Properties", "Get");
-  if (path_msg) {
-    const char *path_prop = "IconThemePath";
-    dbus_message_append_args(path_msg,
-                             DBUS_TYPE_STRING, &iface,
-                             DBUS_TYPE_STRING, &path_prop,
-                             DBUS_TYPE_INVALID);
-    DBusError err2;
-    dbus_error_init(&err2);
-    DBusMessage *path_reply = dbus_connection_send_with_reply_and_block(conn, path_msg, 200, &err2);
-    dbus_message_unref(path_msg);
-    if (path_reply) {
-      DBusMessageIter it;
-      dbus_message_iter_init(path_reply, &it);
-      if (dbus_message_iter_get_arg_type(&it) == DBUS_TYPE_VARIANT) {
-        DBusMessageIter var;
-        dbus_message_iter_recurse(&it, &var);
-        const char *theme_path = NULL;
-        if (dbus_message_iter_get_arg_type(&var) == DBUS_TYPE_STRING) {
-          dbus_message_iter_get_basic(&var, &theme_path);
-        }
-        if (theme_path && *theme_path) {
-          nizam_dock_debug_log2("sni icon theme path: ", theme_path);
-          if (sni_best_icon_path_in_dir(theme_path, normalized, path, sizeof(path))) {
-            unsigned char *data = NULL;
-            cairo_surface_t *surface = sni_load_icon_surface(path, &data);
-            if (surface) {
-              dbus_message_unref(path_reply);
-              return sni_set_icon_surface(item, surface, data, 0, 0);
-            }
-          }
-        }
+  if (theme_path && *theme_path) {
+    nizam_dock_debug_log2("sni icon theme path: ", theme_path);
+    if (sni_icon_lookup(theme_path, name, path, sizeof(path))) {
+      cairo_surface_t *surface = sni_surface_cache_load(sni, path, NIZAM_DOCK_TRAY_ICON_SIZE);
+      if (surface) {
+        return sni_set_icon_surface(item, surface, NULL, 0, 0);
       }
-      dbus_message_unref(path_reply);
     }
-    dbus_error_free(&err2);
   }
 
-  if (!sni_best_icon_path(normalized, path, sizeof(path))) {
+  if (!sni_best_icon_path(name, path, sizeof(path))) {
     char lower[256];
-    if (sni_lowercase(normalized, lower, sizeof(lower))) {
+    if (sni_lowercase(name, lower, sizeof(lower))) {
       nizam_dock_debug_log2("sni icon name lowercase: ", lower);
       if (!sni_best_icon_path(lower, path, sizeof(path))) {
         return 0;
@@ -885,275 +1207,48 @@ static int sni_fetch_icon_name_prop(DBusConnection *conn,
       return 0;
     }
   }
-  unsigned char *data = NULL;
-  cairo_surface_t *surface = sni_load_icon_surface(path, &data);
+  cairo_surface_t *surface = sni_surface_cache_load(sni, path, NIZAM_DOCK_TRAY_ICON_SIZE);
   if (!surface) {
     return 0;
   }
-  return sni_set_icon_surface(item, surface, data, 0, 0);
-}
-
-static int sni_fetch_icon_name(DBusConnection *conn,
-                               struct nizam_dock_sni_item *item) {
-  return sni_fetch_icon_name_prop(conn, item, "IconName");
+  return sni_set_icon_surface(item, surface, NULL, 0, 0);
 }
 
-static void sni_fetch_menu_path(DBusConnection *conn, struct nizam_dock_sni_item *item) {
-  if (!conn || !item) {
-    return;
-  }
-  char prev[256];
-  snprintf(prev, sizeof(prev), "%s", item->menu_path);
-  {
-    DBusMessage *msg = dbus_message_new_method_call(
-        item->service, item->path,
-        "org.freedesktop.DBus.Properties", "Get");
-    if (msg) {
-      const char *iface = SNI_ITEM_IFACE;
-      const char *prop = "Menu";
-      dbus_message_append_args(msg,
-                               DBUS_TYPE_STRING, &iface,
-                               DBUS_TYPE_STRING, &prop,
-                               DBUS_TYPE_INVALID);
-      DBusMessage *reply = dbus_connection_send_with_reply_and_block(conn, msg, 500, NULL);
-      dbus_message_unref(msg);
-      if (reply) {
-        DBusMessageIter iter;
-        dbus_message_iter_init(reply, &iter);
-        if (dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_VARIANT) {
-          DBusMessageIter var;
-          dbus_message_iter_recurse(&iter, &var);
-          int vtype = dbus_message_iter_get_arg_type(&var);
-          const char *path = NULL;
-          if (vtype == DBUS_TYPE_OBJECT_PATH || vtype == DBUS_TYPE_STRING) {
-            dbus_message_iter_get_basic(&var, &path);
-          }
-          if (nizam_dock_debug_enabled()) {
-            fprintf(stderr, "nizam-dock: sni prop Menu (Get) type=%c value=%s\n",
-                    vtype ? vtype : '?', path ? path : "(null)");
-          }
-          if (path && *path && strcmp(path, "/") != 0) {
-            snprintf(item->menu_path, sizeof(item->menu_path), "%s", path);
-          }
-        }
-        dbus_message_unref(reply);
-      }
-    }
-  }
-
-  if (!item->menu_path[0]) {
-    DBusMessage *msg = dbus_message_new_method_call(
-        item->service, item->path,
-        "org.freedesktop.DBus.Properties", "GetAll");
-    if (!msg) {
-      return;
-    }
-    const char *iface = SNI_ITEM_IFACE;
-    dbus_message_append_args(msg, DBUS_TYPE_STRING, &iface, DBUS_TYPE_INVALID);
-    DBusMessage *reply = dbus_connection_send_with_reply_and_block(conn, msg, 500, NULL);
-    dbus_message_unref(msg);
-    if (!reply) {
-      return;
-    }
-    DBusMessageIter iter;
-    dbus_message_iter_init(reply, &iter);
-    if (dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_ARRAY) {
-      DBusMessageIter array;
-      dbus_message_iter_recurse(&iter, &array);
-      while (dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_DICT_ENTRY) {
-        DBusMessageIter entry;
-        dbus_message_iter_recurse(&array, &entry);
-        const char *key = NULL;
-        dbus_message_iter_get_basic(&entry, &key);
-        dbus_message_iter_next(&entry);
-        if (key && strcmp(key, "Menu") == 0 &&
-            dbus_message_iter_get_arg_type(&entry) == DBUS_TYPE_VARIANT) {
-          DBusMessageIter var;
-          dbus_message_iter_recurse(&entry, &var);
-          int vtype = dbus_message_iter_get_arg_type(&var);
-          const char *path = NULL;
-          if (vtype == DBUS_TYPE_OBJECT_PATH || vtype == DBUS_TYPE_STRING) {
-            dbus_message_iter_get_basic(&var, &path);
-          }
-          if (nizam_dock_debug_enabled()) {
-            fprintf(stderr, "nizam-dock: sni prop Menu (GetAll) type=%c value=%s\n",
-                    vtype ? vtype : '?', path ? path : "(null)");
-          }
-          if (path && *path && strcmp(path, "/") != 0) {
-            snprintf(item->menu_path, sizeof(item->menu_path), "%s", path);
-            break;
-          }
-        }
-        dbus_message_iter_next(&array);
-      }
-    }
-    dbus_message_unref(reply);
-  }
-
-  if (!item->menu_path[0] && prev[0]) {
-    snprintf(item->menu_path, sizeof(item->menu_path), "%s", prev);
-  }
-  if (item->menu_path[0] && nizam_dock_debug_enabled()) {
-    fprintf(stderr, "nizam-dock: sni menu path: %s\n", item->menu_path);
-  }
-}
-
-static int sni_path_has_sni(DBusConnection *conn, const char *service, const char *path) {
-  if (!conn || !service || !path) {
-    return 0;
-  }
-  DBusMessage *msg = dbus_message_new_method_call(
-      service, path, "org.freedesktop.DBus.Properties", "GetAll");
-  if (!msg) {
-    return 0;
-  }
-  const char *iface = SNI_ITEM_IFACE;
-  dbus_message_append_args(msg, DBUS_TYPE_STRING, &iface, DBUS_TYPE_INVALID);
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(conn, msg, 500, NULL);
-  dbus_message_unref(msg);
-  if (!reply) {
-    return 0;
-  }
-  int ok = dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN;
-  if (nizam_dock_debug_enabled()) {
-    fprintf(stderr, "nizam-dock: sni path check %s -> %s\n",
-            path, ok ? "yes" : "no");
-  }
-  dbus_message_unref(reply);
-  return ok;
-}
-
-static int sni_introspect_first_child(DBusConnection *conn,
-                                      const char *service,
-                                      const char *base_path,
-                                      char *out,
-                                      size_t out_size) {
-  if (!conn || !service || !base_path || !out || out_size == 0) {
-    return 0;
-  }
-  DBusMessage *msg = dbus_message_new_method_call(
-      service, base_path,
-      "org.freedesktop.DBus.Introspectable", "Introspect");
-  if (!msg) {
-    return 0;
-  }
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(conn, msg, 500, NULL);
-  dbus_message_unref(msg);
-  if (!reply) {
+static int sni_first_child_from_xml(DBusMessage *reply, char *out, size_t out_size) {
+  if (!sni_reply_ok(reply) || !out || out_size == 0) {
     return 0;
   }
   const char *xml = NULL;
-  int ok = 0;
-  if (dbus_message_get_args(reply, NULL, DBUS_TYPE_STRING, &xml, DBUS_TYPE_INVALID) && xml) {
-    const char *needle = "node name=\"";
-    const char *pos = strstr(xml, needle);
-    if (pos) {
-      pos += strlen(needle);
-      const char *end = strchr(pos, '"');
-      if (end && end > pos) {
-        size_t len = (size_t)(end - pos);
-        if (len >= out_size) {
-          len = out_size - 1;
-        }
-        memcpy(out, pos, len);
-        out[len] = '\0';
-        ok = 1;
-      }
-    }
-  }
-  dbus_message_unref(reply);
-  return ok;
-}
-
-static void sni_discover_item_path(DBusConnection *conn, struct nizam_dock_sni_item *item) {
-  if (!conn || !item) {
-    return;
-  }
-  if (nizam_dock_debug_enabled()) {
-    fprintf(stderr, "nizam-dock: sni discover path (service=%s) start=%s\n",
-            item->service, item->path);
-  }
-  if (sni_path_has_sni(conn, item->service, item->path)) {
-    return;
-  }
-  const char *kde_path = "/org/kde/StatusNotifierItem";
-  if (sni_path_has_sni(conn, item->service, kde_path)) {
-    snprintf(item->path, sizeof(item->path), "%s", kde_path);
-    if (nizam_dock_debug_enabled()) {
-      fprintf(stderr, "nizam-dock: sni item path: %s\n", item->path);
-    }
-    return;
-  }
-  const char *ayatana_base = "/org/ayatana/NotificationItem";
-  char child[128];
-  if (sni_introspect_first_child(conn, item->service, ayatana_base, child, sizeof(child))) {
-    char path[192];
-    snprintf(path, sizeof(path), "%s/%s", ayatana_base, child);
-    if (sni_path_has_sni(conn, item->service, path)) {
-      snprintf(item->path, sizeof(item->path), "%s", path);
-      if (nizam_dock_debug_enabled()) {
-        fprintf(stderr, "nizam-dock: sni item path: %s\n", item->path);
-      }
-      return;
-    }
-  }
-}
-
-static void sni_fetch_item_is_menu(DBusConnection *conn, struct nizam_dock_sni_item *item) {
-  if (!conn || !item) {
-    return;
-  }
-  DBusMessage *msg = dbus_message_new_method_call(
-      item->service, item->path,
-      "org.freedesktop.DBus.Properties", "Get");
-  if (!msg) {
-    return;
-  }
-  const char *iface = SNI_ITEM_IFACE;
-  const char *prop = "ItemIsMenu";
-  dbus_message_append_args(msg,
-                           DBUS_TYPE_STRING, &iface,
-                           DBUS_TYPE_STRING, &prop,
-                           DBUS_TYPE_INVALID);
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(conn, msg, 500, NULL);
-  dbus_message_unref(msg);
-  if (!reply) {
-    return;
-  }
-  DBusMessageIter iter;
-  dbus_message_iter_init(reply, &iter);
-  if (dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_VARIANT) {
-    dbus_message_unref(reply);
-    return;
-  }
-  DBusMessageIter variant;
-  dbus_message_iter_recurse(&iter, &variant);
-  if (dbus_message_iter_get_arg_type(&variant) == DBUS_TYPE_BOOLEAN) {
-    dbus_bool_t val = 0;
-    dbus_message_iter_get_basic(&variant, &val);
-    item->item_is_menu = val ? 1 : 0;
+  if (!dbus_message_get_args(reply, NULL, DBUS_TYPE_STRING, &xml, DBUS_TYPE_INVALID) || !xml) {
+    return 0;
   }
-  dbus_message_unref(reply);
-}
-
-static void sni_introspect_item(DBusConnection *conn, struct nizam_dock_sni_item *item) {
-  if (!conn || !item || item->introspected) {
-    return;
+  const char *needle = "node name=\"";
+  const char *pos = strstr(xml, needle);
+  if (!pos) {
+    return 0;
   }
-  item->introspected = 1;
-  DBusMessage *msg = dbus_message_new_method_call(
-      item->service, item->path,
-      "org.freedesktop.DBus.Introspectable", "Introspect");
-  if (!msg) {
-    return;
+  pos += strlen(needle);
+  const char *end = strchr(pos, '"');
+  if (!end || end == pos) {
+    return 0;
   }
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(conn, msg, 500, NULL);
-  dbus_message_unref(msg);
-  if (!reply) {
-    return;
+  size_t len = (size_t)(end - pos);
+  if (len >= out_size) {
+    len = out_size - 1;
   }
+  memcpy(out, pos, len);
+  out[len] = '\0';
+  return 1;
+}
+
+static void sni_caps_from_xml(struct nizam_dock_sni_item *item, DBusMessage *reply) {
   const char *xml = NULL;
-  if (dbus_message_get_args(reply, NULL, DBUS_TYPE_STRING, &xml, DBUS_TYPE_INVALID) && xml) {
+  if (sni_reply_ok(reply) &&
+      dbus_message_get_args(reply, NULL, DBUS_TYPE_STRING, &xml, DBUS_TYPE_INVALID) && xml) {
+    item->has_activate = 0;
+    item->has_secondary = 0;
+    item->has_context = 0;
+    item->has_xayatana_secondary = 0;
     if (strstr(xml, "name=\"Activate\"")) {
       item->has_activate = 1;
     }
@@ -1174,77 +1269,245 @@ static void sni_introspect_item(DBusConnection *conn, struct nizam_dock_sni_item
             item->has_activate, item->has_secondary, item->has_xayatana_secondary,
             item->has_context, item->item_is_menu);
   }
-  dbus_message_unref(reply);
 }
 
-static int sni_refresh_item(DBusConnection *conn, struct nizam_dock_sni_item *item) {
-  if (!conn || !item) {
+static const struct sni_caps *sni_caps_lookup(const struct nizam_dock_sni *sni,
+                                              const struct nizam_dock_sni_item *item) {
+  for (size_t i = 0; i < SNI_CAPS_CACHE_SIZE; ++i) {
+    const struct sni_caps *caps = &sni->caps_cache[i];
+    if (caps->service[0] && strcmp(caps->service, item->service) == 0 &&
+        strcmp(caps->path, item->path) == 0) {
+      return caps;
+    }
+  }
+  return NULL;
+}
+
+static void sni_caps_store(struct nizam_dock_sni *sni, const struct nizam_dock_sni_item *item) {
+  struct sni_caps *caps = (struct sni_caps *)sni_caps_lookup(sni, item);
+  if (!caps) {
+    caps = &sni->caps_cache[sni->caps_next];
+    sni->caps_next = (sni->caps_next + 1) % SNI_CAPS_CACHE_SIZE;
+  }
+  snprintf(caps->service, sizeof(caps->service), "%s", item->service);
+  snprintf(caps->path, sizeof(caps->path), "%s", item->path);
+  caps->has_activate = item->has_activate;
+  caps->has_secondary = item->has_secondary;
+  caps->has_context = item->has_context;
+  caps->has_xayatana_secondary = item->has_xayatana_secondary;
+}
+
+static DBusMessage *sni_new_get_all(const char *service, const char *path) {
+  DBusMessage *msg = dbus_message_new_method_call(
+      service, path, "org.freedesktop.DBus.Properties", "GetAll");
+  if (!msg) {
+    return NULL;
+  }
+  const char *iface = SNI_ITEM_IFACE;
+  dbus_message_append_args(msg, DBUS_TYPE_STRING, &iface, DBUS_TYPE_INVALID);
+  return msg;
+}
+
+static DBusMessage *sni_new_introspect(const char *service, const char *path) {
+  return dbus_message_new_method_call(
+      service, path, "org.freedesktop.DBus.Introspectable", "Introspect");
+}
+
+static void sni_item_notify(DBusPendingCall *pending, void *data);
+
+static int sni_item_send(struct nizam_dock_app *app,
+                         struct nizam_dock_sni_item *item,
+                         DBusMessage *msg,
+                         int timeout_ms) {
+  if (!msg) {
     return 0;
   }
-  sni_discover_item_path(conn, item);
-  sni_fetch_menu_path(conn, item);
-  sni_fetch_item_is_menu(conn, item);
-  sni_introspect_item(conn, item);
-  if (sni_fetch_icon_pixmap(conn, item)) {
-    nizam_dock_debug_log("sni icon: pixmap");
-    return 1;
+  DBusPendingCall *pending = NULL;
+  int ok = dbus_connection_send_with_reply(app->sni->conn, msg, &pending, timeout_ms) &&
+           pending != NULL;
+  dbus_message_unref(msg);
+  if (!ok) {
+    return 0;
   }
-  if (sni_fetch_icon_name(conn, item)) {
-    nizam_dock_debug_log("sni icon: name");
-    return 1;
+  struct sni_call *call = malloc(sizeof(*call));
+  if (!call || !dbus_pending_call_set_notify(pending, sni_item_notify, call, free)) {
+    free(call);
+    dbus_pending_call_cancel(pending);
+    dbus_pending_call_unref(pending);
+    return 0;
   }
-  if (sni_fetch_icon_pixmap_prop(conn, item, "AttentionIconPixmap")) {
-    nizam_dock_debug_log("sni icon: attention pixmap");
-    return 1;
+  call->app = app;
+  call->item_id = item->id;
+  item->pending = pending;
+  dbus_connection_flush(app->sni->conn);
+  return 1;
+}
+
+static int sni_item_request(struct nizam_dock_app *app, struct nizam_dock_sni_item *item) {
+  DBusMessage *msg = NULL;
+  switch (item->state) {
+  case SNI_ITEM_PROBE_PATH:
+    snprintf(item->probe_path, sizeof(item->probe_path), "%s", item->path);
+    msg = sni_new_get_all(item->service, item->probe_path);
+    break;
+  case SNI_ITEM_PROBE_KDE:
+    snprintf(item->probe_path, sizeof(item->probe_path), "%s", SNI_KDE_ITEM_PATH);
+    msg = sni_new_get_all(item->service, item->probe_path);
+    break;
+  case SNI_ITEM_PROBE_AYATANA:
+    msg = sni_new_introspect(item->service, SNI_AYATANA_ITEM_BASE);
+    break;
+  case SNI_ITEM_PROBE_AYATANA_CHILD:
+    msg = sni_new_get_all(item->service, item->probe_path);
+    break;
+  case SNI_ITEM_INTROSPECT:
+    msg = sni_new_introspect(item->service, item->path);
+    break;
+  default:
+    return 0;
+  }
+  return sni_item_send(app, item, msg, 500);
+}
+
+static void sni_item_apply_props(struct nizam_dock_sni *sni,
+                                 struct nizam_dock_sni_item *item,
+                                 struct sni_props *props) {
+  const char *menu = sni_props_string(props, SNI_PROP_MENU);
+  if (nizam_dock_debug_enabled()) {
+    fprintf(stderr, "nizam-dock: sni prop Menu (GetAll) value=%s\n", menu ? menu : "(null)");
   }
-  if (sni_fetch_icon_name_prop(conn, item, "AttentionIconName")) {
-    nizam_dock_debug_log("sni icon: attention name");
-    return 1;
+  if (menu && *menu && strcmp(menu, "/") != 0) {
+    snprintf(item->menu_path, sizeof(item->menu_path), "%s", menu);
   }
-  if (sni_fetch_icon_pixmap_prop(conn, item, "OverlayIconPixmap")) {
-    nizam_dock_debug_log("sni icon: overlay pixmap");
-    return 1;
+  if (props->have[SNI_PROP_ITEM_IS_MENU] &&
+      dbus_message_iter_get_arg_type(&props->value[SNI_PROP_ITEM_IS_MENU]) == DBUS_TYPE_BOOLEAN) {
+    dbus_bool_t val = 0;
+    dbus_message_iter_get_basic(&props->value[SNI_PROP_ITEM_IS_MENU], &val);
+    item->item_is_menu = val ? 1 : 0;
   }
-  if (sni_fetch_icon_name_prop(conn, item, "OverlayIconName")) {
-    nizam_dock_debug_log("sni icon: overlay name");
-    return 1;
+
+  const char *theme_path = sni_props_string(props, SNI_PROP_ICON_THEME_PATH);
+  for (size_t i = 0; i < sizeof(sni_icon_steps) / sizeof(sni_icon_steps[0]); ++i) {
+    const struct sni_icon_step *step = &sni_icon_steps[i];
+    if (!props->have[step->prop]) {
+      continue;
+    }
+    int ok = step->pixmap
+               ? sni_set_icon_pixmap(item, &props->value[step->prop])
+               : sni_set_icon_by_name(sni, item, sni_props_string(props, step->prop), theme_path);
+    if (ok) {
+      nizam_dock_debug_log2("sni icon: ", step->label);
+      sni_set_dirty(sni);
+      return;
+    }
   }
   nizam_dock_debug_log("sni icon: missing");
-  return 0;
 }
 
-static const char *sni_get_owner(DBusConnection *conn, const char *service, char *out, size_t out_size) {
-  if (!service || !*service) {
-    return NULL;
+static enum sni_item_state sni_item_after_props(struct nizam_dock_sni *sni,
+                                                struct nizam_dock_sni_item *item) {
+  if (item->introspected) {
+    return SNI_ITEM_IDLE;
   }
-  if (service[0] == ':') {
-    snprintf(out, out_size, "%s", service);
-    return out;
+  const struct sni_caps *caps = sni_caps_lookup(sni, item);
+  if (!caps) {
+    return SNI_ITEM_INTROSPECT;
   }
-  DBusMessage *msg = dbus_message_new_method_call(
-      "org.freedesktop.DBus", "/org/freedesktop/DBus",
-      "org.freedesktop.DBus", "GetNameOwner");
-  if (!msg) {
-    return NULL;
+  item->introspected = 1;
+  item->has_activate = caps->has_activate;
+  item->has_secondary = caps->has_secondary;
+  item->has_context = caps->has_context;
+  item->has_xayatana_secondary = caps->has_xayatana_secondary;
+  return SNI_ITEM_IDLE;
+}
+
+static enum sni_item_state sni_item_apply(struct nizam_dock_sni *sni,
+                                          struct nizam_dock_sni_item *item,
+                                          DBusMessage *reply) {
+  switch (item->state) {
+  case SNI_ITEM_PROBE_PATH:
+  case SNI_ITEM_PROBE_KDE:
+  case SNI_ITEM_PROBE_AYATANA_CHILD: {
+    struct sni_props props;
+    int ok = sni_props_parse(reply, &props);
+    if (nizam_dock_debug_enabled()) {
+      fprintf(stderr, "nizam-dock: sni path check %s -> %s\n",
+              item->probe_path, ok ? "yes" : "no");
+    }
+    if (ok) {
+      if (strcmp(item->path, item->probe_path) != 0) {
+        snprintf(item->path, sizeof(item->path), "%s", item->probe_path);
+        item->introspected = 0;
+        nizam_dock_debug_log2("sni item path: ", item->path);
+      }
+      sni_item_apply_props(sni, item, &props);
+      return sni_item_after_props(sni, item);
+    }
+    if (item->state == SNI_ITEM_PROBE_PATH) {
+      return SNI_ITEM_PROBE_KDE;
+    }
+    if (item->state == SNI_ITEM_PROBE_KDE) {
+      return SNI_ITEM_PROBE_AYATANA;
+    }
+    return SNI_ITEM_IDLE;
   }
-  dbus_message_append_args(msg, DBUS_TYPE_STRING, &service, DBUS_TYPE_INVALID);
-  DBusError err;
-  dbus_error_init(&err);
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(conn, msg, 500, &err);
-  dbus_message_unref(msg);
-  if (!reply) {
-    dbus_error_free(&err);
-    return NULL;
+  case SNI_ITEM_PROBE_AYATANA: {
+    char child[128];
+    if (sni_first_child_from_xml(reply, child, sizeof(child))) {
+      snprintf(item->probe_path, sizeof(item->probe_path), "%s/%s",
+               SNI_AYATANA_ITEM_BASE, child);
+      return SNI_ITEM_PROBE_AYATANA_CHILD;
+    }
+    return SNI_ITEM_IDLE;
+  }
+  case SNI_ITEM_INTROSPECT:
+    item->introspected = 1;
+    sni_caps_from_xml(item, reply);
+    if (sni_reply_ok(reply)) {
+      sni_caps_store(sni, item);
+    }
+    return SNI_ITEM_IDLE;
+  default:
+    return SNI_ITEM_IDLE;
+  }
+}
+
+static void sni_item_pump(struct nizam_dock_app *app, struct nizam_dock_sni_item *item) {
+  while (item->state != SNI_ITEM_IDLE) {
+    if (sni_item_request(app, item)) {
+      return;
+    }
+    item->state = sni_item_apply(app->sni, item, NULL);
+  }
+}
+
+static void sni_item_refresh(struct nizam_dock_app *app, struct nizam_dock_sni_item *item) {
+  if (item->state != SNI_ITEM_IDLE) {
+    item->refresh_queued = 1;
+    return;
+  }
+  item->refresh_queued = 0;
+  item->state = SNI_ITEM_PROBE_PATH;
+  sni_item_pump(app, item);
+}
+
+static void sni_item_notify(DBusPendingCall *pending, void *data) {
+  struct sni_call *call = data;
+  struct nizam_dock_sni *sni = call->app->sni;
+  DBusMessage *reply = dbus_pending_call_steal_reply(pending);
+  struct nizam_dock_sni_item *item = sni_find_by_id(sni, call->item_id);
+  if (item && item->pending == pending) {
+    dbus_pending_call_unref(item->pending);
+    item->pending = NULL;
+    item->state = sni_item_apply(sni, item, reply);
+    sni_item_pump(call->app, item);
+    if (item->state == SNI_ITEM_IDLE && item->refresh_queued) {
+      sni->refresh_pending = 1;
+    }
   }
-  const char *owner = NULL;
-  if (!dbus_message_get_args(reply, &err, DBUS_TYPE_STRING, &owner, DBUS_TYPE_INVALID)) {
+  if (reply) {
     dbus_message_unref(reply);
-    dbus_error_free(&err);
-    return NULL;
   }
-  snprintf(out, out_size, "%s", owner);
-  dbus_message_unref(reply);
-  return out;
 }
 
 static void sni_emit_item_registered(DBusConnection *conn, const char *service) {
@@ -1413,11 +1676,6 @@ static DBusHandlerResult sni_message_handler(DBusConnection *conn,
       snprintf(service, sizeof(service), "%s", sender);
     }
 
-    char owner[128] = "";
-    if (!sni_get_owner(conn, service, owner, sizeof(owner))) {
-      snprintf(owner, sizeof(owner), "%s", sender);
-    }
-
     struct nizam_dock_sni_item *item = sni_find_by_service(sni, service);
     if (!item) {
       if (!sni_ensure_capacity(sni)) {
@@ -1425,18 +1683,14 @@ static DBusHandlerResult sni_message_handler(DBusConnection *conn,
       }
       item = &sni->items[sni->count++];
       memset(item, 0, sizeof(*item));
+      item->id = ++sni->next_id;
       snprintf(item->service, sizeof(item->service), "%s", service);
-    }
-    snprintf(item->owner, sizeof(item->owner), "%s", owner);
-    snprintf(item->path, sizeof(item->path), "%s", path);
-    if (sni_refresh_item(conn, item)) {
-      sni_set_dirty(sni);
     } else {
-      if (nizam_dock_debug_enabled()) {
-        fprintf(stderr, "nizam-dock: sni icon missing for %s (%s)\n",
-                item->service, item->path);
-      }
+      sni_item_cancel(item);
     }
+    snprintf(item->owner, sizeof(item->owner), "%s", sender);
+    snprintf(item->path, sizeof(item->path), "%s", path);
+    sni_item_refresh(app, item);
     sni_emit_item_registered(conn, item->service);
 
     DBusMessage *reply = dbus_message_new_method_return(msg);
@@ -1517,8 +1771,9 @@ static DBusHandlerResult sni_signal_filter(DBusConnection *conn,
       dbus_message_is_signal(msg, SNI_ITEM_IFACE, "NewStatus")) {
     const char *sender = dbus_message_get_sender(msg);
     struct nizam_dock_sni_item *item = sni_find_by_owner(sni, sender);
-    if (item && sni_refresh_item(conn, item)) {
-      sni_set_dirty(sni);
+    if (item) {
+      item->refresh_queued = 1;
+      sni->refresh_pending = 1;
     }
     return DBUS_HANDLER_RESULT_HANDLED;
   }
@@ -1526,6 +1781,19 @@ static DBusHandlerResult sni_signal_filter(DBusConnection *conn,
   return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 }
 
+static void sni_menu_reset(struct nizam_dock_sni *sni) {
+  if (sni->menu_pending) {
+    dbus_pending_call_cancel(sni->menu_pending);
+    dbus_pending_call_unref(sni->menu_pending);
+    sni->menu_pending = NULL;
+  }
+  free(sni->menu_items);
+  sni->menu_items = NULL;
+  sni->menu_count = 0;
+  sni->menu_result = 0;
+  sni->menu_item_id = 0;
+}
+
 int nizam_dock_sni_init(struct nizam_dock_app *app) {
   if (!app) {
     return -1;
@@ -1569,10 +1837,18 @@ int nizam_dock_sni_init(struct nizam_dock_app *app) {
     fprintf(stderr, "nizam-dock: sni unix fd=%d\n", sni->fd);
   }
 
+  if (!dbus_connection_set_timeout_functions(conn, sni_timeout_add, sni_timeout_remove,
+                                            sni_timeout_toggled, sni, NULL)) {
+    free(sni);
+    return -1;
+  }
+
   static const DBusObjectPathVTable vtable = {
     .message_function = sni_message_handler
   };
   if (!dbus_connection_register_object_path(conn, SNI_WATCHER_PATH, &vtable, app)) {
+    dbus_connection_set_timeout_functions(conn, NULL, NULL, NULL, NULL, NULL);
+    free(sni->timeouts);
     free(sni);
     return -1;
   }
@@ -1605,9 +1881,14 @@ void nizam_dock_sni_cleanup(struct nizam_dock_app *app) {
     return;
   }
   struct nizam_dock_sni *sni = app->sni;
+  sni_menu_reset(sni);
   for (size_t i = 0; i < sni->count; ++i) {
     sni_item_clear_full(&sni->items[i]);
   }
+  sni_surface_cache_clear(sni);
+  sni_icon_cache_reset();
+  dbus_connection_set_timeout_functions(sni->conn, NULL, NULL, NULL, NULL, NULL);
+  free(sni->timeouts);
   free(sni->items);
   sni->items = NULL;
   sni->count = 0;
@@ -1629,12 +1910,47 @@ int nizam_dock_sni_process(struct nizam_dock_app *app) {
   }
   struct nizam_dock_sni *sni = app->sni;
   sni->dirty = 0;
+  sni_timeouts_handle(sni);
   dbus_connection_read_write_dispatch(sni->conn, 0);
   while (dbus_connection_dispatch(sni->conn) == DBUS_DISPATCH_DATA_REMAINS) {
   }
+  if (sni->refresh_pending) {
+    sni->refresh_pending = 0;
+    for (size_t i = 0; i < sni->count; ++i) {
+      struct nizam_dock_sni_item *item = &sni->items[i];
+      if (item->refresh_queued && item->state == SNI_ITEM_IDLE) {
+        sni_item_refresh(app, item);
+      }
+    }
+  }
   return sni->dirty;
 }
 
+int nizam_dock_sni_timeout_ms(const struct nizam_dock_app *app) {
+  if (!app || !app->sni) {
+    return -1;
+  }
+  const struct nizam_dock_sni *sni = app->sni;
+  int64_t next = 0;
+  for (size_t i = 0; i < sni->timeout_count; ++i) {
+    int64_t deadline = sni->timeouts[i].deadline_ms;
+    if (deadline && (next == 0 || deadline < next)) {
+      next = deadline;
+    }
+  }
+  if (next == 0) {
+    return -1;
+  }
+  int64_t ms_left = next - sni_now_ms();
+  if (ms_left < 0) {
+    ms_left = 0;
+  }
+  if (ms_left > INT32_MAX) {
+    ms_left = INT32_MAX;
+  }
+  return (int)ms_left;
+}
+
 size_t nizam_dock_sni_count(const struct nizam_dock_app *app) {
   if (!app || !app->sni) {
     return 0;
@@ -1654,7 +1970,7 @@ int nizam_dock_sni_activate(struct nizam_dock_app *app, size_t idx, int x, int y
     return 0;
   }
   struct nizam_dock_sni_item *item = &app->sni->items[idx];
-  return sni_call_method(app->sni, item, SNI_ITEM_IFACE, "Activate", item->path, x, y);
+  return sni_call_method(app->sni, item, "Activate", x, y);
 }
 
 int nizam_dock_sni_secondary_activate(struct nizam_dock_app *app, size_t idx, int x, int y) {
@@ -1662,11 +1978,7 @@ int nizam_dock_sni_secondary_activate(struct nizam_dock_app *app, size_t idx, in
     return 0;
   }
   struct nizam_dock_sni_item *item = &app->sni->items[idx];
-  int ok = sni_call_method(app->sni, item, SNI_ITEM_IFACE, "SecondaryActivate", item->path, x, y);
-  if (nizam_dock_debug_enabled()) {
-    fprintf(stderr, "nizam-dock: sni SecondaryActivate %s\n", ok ? "ok" : "failed");
-  }
-  return ok;
+  return sni_call_method(app->sni, item, "SecondaryActivate", x, y);
 }
 
 int nizam_dock_sni_xayatana_secondary(struct nizam_dock_app *app, size_t idx, uint32_t time) {
@@ -1680,22 +1992,7 @@ int nizam_dock_sni_xayatana_secondary(struct nizam_dock_app *app, size_t idx, ui
     return 0;
   }
   dbus_message_append_args(msg, DBUS_TYPE_UINT32, &time, DBUS_TYPE_INVALID);
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(
-      app->sni->conn, msg, 500, NULL);
-  dbus_message_unref(msg);
-  if (!reply) {
-    if (nizam_dock_debug_enabled()) {
-      fprintf(stderr, "nizam-dock: sni method XAyatanaSecondaryActivate failed (%s %s)\n",
-              item->service, item->path);
-    }
-    return 0;
-  }
-  dbus_message_unref(reply);
-  dbus_connection_flush(app->sni->conn);
-  if (nizam_dock_debug_enabled()) {
-    fprintf(stderr, "nizam-dock: sni XAyatanaSecondaryActivate ok\n");
-  }
-  return 1;
+  return sni_send_method(app->sni, msg, "XAyatanaSecondaryActivate");
 }
 
 int nizam_dock_sni_scroll(struct nizam_dock_app *app, size_t idx, int delta, const char *orientation) {
@@ -1712,19 +2009,7 @@ int nizam_dock_sni_scroll(struct nizam_dock_app *app, size_t idx, int delta, con
                            DBUS_TYPE_INT32, &delta,
                            DBUS_TYPE_STRING, &orientation,
                            DBUS_TYPE_INVALID);
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(
-      app->sni->conn, msg, 500, NULL);
-  dbus_message_unref(msg);
-  if (!reply) {
-    if (nizam_dock_debug_enabled()) {
-      fprintf(stderr, "nizam-dock: sni method Scroll failed (%s %s)\n",
-              item->service, item->path);
-    }
-    return 0;
-  }
-  dbus_message_unref(reply);
-  dbus_connection_flush(app->sni->conn);
-  return 1;
+  return sni_send_method(app->sni, msg, "Scroll");
 }
 
 int nizam_dock_sni_context_menu(struct nizam_dock_app *app, size_t idx, int x, int y) {
@@ -1732,7 +2017,7 @@ int nizam_dock_sni_context_menu(struct nizam_dock_app *app, size_t idx, int x, i
     return 0;
   }
   struct nizam_dock_sni_item *item = &app->sni->items[idx];
-  return sni_call_method(app->sni, item, SNI_ITEM_IFACE, "ContextMenu", item->path, x, y);
+  return sni_call_method(app->sni, item, "ContextMenu", x, y);
 }
 
 int nizam_dock_sni_item_has_activate(const struct nizam_dock_app *app, size_t idx) {
@@ -1897,46 +2182,12 @@ static void menu_parse_node(DBusMessageIter *node,
   }
 }
 
-int nizam_dock_sni_menu_fetch(struct nizam_dock_app *app, size_t idx,
-                         struct nizam_dock_menu_item **items, size_t *count) {
-  if (!app || !app->sni || idx >= app->sni->count || !items || !count) {
-    return 0;
-  }
-  struct nizam_dock_sni_item *item = &app->sni->items[idx];
-  if (!item->menu_path[0]) {
-    sni_fetch_menu_path(app->sni->conn, item);
-  }
-  if (!item->menu_path[0]) {
-    if (nizam_dock_debug_enabled()) {
-      fprintf(stderr, "nizam-dock: sni menu missing (Menu path empty) service=%s path=%s\n",
-              item->service, item->path);
-    }
-    return 0;
-  }
-  if (nizam_dock_debug_enabled()) {
-    fprintf(stderr, "nizam-dock: sni menu fetch dest=%s path=%s iface=com.canonical.dbusmenu\n",
-            item->service, item->menu_path);
-  }
-  {
-    DBusMessage *abt = dbus_message_new_method_call(
-        item->service, item->menu_path,
-        "com.canonical.dbusmenu", "AboutToShow");
-    if (abt) {
-      int32_t root_id = 0;
-      dbus_message_append_args(abt, DBUS_TYPE_INT32, &root_id, DBUS_TYPE_INVALID);
-      DBusMessage *abt_reply = dbus_connection_send_with_reply_and_block(
-          app->sni->conn, abt, 500, NULL);
-      dbus_message_unref(abt);
-      if (abt_reply) {
-        dbus_message_unref(abt_reply);
-      }
-    }
-  }
+static DBusMessage *sni_new_menu_layout(const struct nizam_dock_sni_item *item) {
   DBusMessage *msg = dbus_message_new_method_call(
       item->service, item->menu_path,
       "com.canonical.dbusmenu", "GetLayout");
   if (!msg) {
-    return 0;
+    return NULL;
   }
   int32_t parent = 0;
   int32_t depth = -1;
@@ -1962,18 +2213,18 @@ int nizam_dock_sni_menu_fetch(struct nizam_dock_app *app, size_t idx,
   dbus_message_iter_append_basic(&props, DBUS_TYPE_STRING, &prop_children_display);
   dbus_message_iter_close_container(&iter, &props);
 
-  DBusError err;
-  dbus_error_init(&err);
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(
-      app->sni->conn, msg, 500, &err);
-  dbus_message_unref(msg);
-  if (!reply) {
+  return msg;
+}
+
+static int sni_menu_parse_layout(DBusMessage *reply,
+                                 struct nizam_dock_menu_item **items,
+                                 size_t *count) {
+  if (!sni_reply_ok(reply)) {
     if (nizam_dock_debug_enabled()) {
-      fprintf(stderr, "nizam-dock: sni menu GetLayout failed (%s %s): %s\n",
-              item->service, item->menu_path,
-              err.message ? err.message : "unknown");
+      const char *name = reply ? dbus_message_get_error_name(reply) : NULL;
+      fprintf(stderr, "nizam-dock: sni menu GetLayout failed: %s\n",
+              name ? name : "no reply");
     }
-    dbus_error_free(&err);
     return 0;
   }
   DBusMessageIter riter;
@@ -1983,7 +2234,6 @@ int nizam_dock_sni_menu_fetch(struct nizam_dock_app *app, size_t idx,
       fprintf(stderr, "nizam-dock: sni menu layout bad type=%c\n",
               dbus_message_iter_get_arg_type(&riter));
     }
-    dbus_message_unref(reply);
     return 0;
   }
   if (nizam_dock_debug_enabled()) {
@@ -1997,7 +2247,6 @@ int nizam_dock_sni_menu_fetch(struct nizam_dock_app *app, size_t idx,
       fprintf(stderr, "nizam-dock: sni menu layout missing struct type=%c\n",
               dbus_message_iter_get_arg_type(&riter));
     }
-    dbus_message_unref(reply);
     return 0;
   }
   DBusMessageIter layout;
@@ -2008,7 +2257,6 @@ int nizam_dock_sni_menu_fetch(struct nizam_dock_app *app, size_t idx,
       fprintf(stderr, "nizam-dock: sni menu layout root props type=%c\n",
               dbus_message_iter_get_arg_type(&layout));
     }
-    dbus_message_unref(reply);
     return 0;
   }
   dbus_message_iter_next(&layout); 
@@ -2017,7 +2265,6 @@ int nizam_dock_sni_menu_fetch(struct nizam_dock_app *app, size_t idx,
       fprintf(stderr, "nizam-dock: sni menu layout children type=%c\n",
               dbus_message_iter_get_arg_type(&layout));
     }
-    dbus_message_unref(reply);
     return 0;
   }
   DBusMessageIter children;
@@ -2043,7 +2290,6 @@ int nizam_dock_sni_menu_fetch(struct nizam_dock_app *app, size_t idx,
     menu_parse_node(&child, 0, &out, &out_count, &out_cap);
     dbus_message_iter_next(&children);
   }
-  dbus_message_unref(reply);
   if (!out || out_count == 0) {
     if (nizam_dock_debug_enabled()) {
       fprintf(stderr, "nizam-dock: sni menu layout empty\n");
@@ -2065,6 +2311,133 @@ int nizam_dock_sni_menu_fetch(struct nizam_dock_app *app, size_t idx,
   return 1;
 }
 
+static int sni_menu_send(struct nizam_dock_app *app,
+                         DBusMessage *msg,
+                         DBusPendingCallNotifyFunction notify) {
+  if (!msg) {
+    return 0;
+  }
+  struct nizam_dock_sni *sni = app->sni;
+  DBusPendingCall *pending = NULL;
+  int ok = dbus_connection_send_with_reply(sni->conn, msg, &pending, 500) && pending != NULL;
+  dbus_message_unref(msg);
+  if (!ok) {
+    return 0;
+  }
+  if (!dbus_pending_call_set_notify(pending, notify, app, NULL)) {
+    dbus_pending_call_cancel(pending);
+    dbus_pending_call_unref(pending);
+    return 0;
+  }
+  sni->menu_pending = pending;
+  dbus_connection_flush(sni->conn);
+  return 1;
+}
+
+static void sni_menu_layout_notify(DBusPendingCall *pending, void *data) {
+  struct nizam_dock_app *app = data;
+  struct nizam_dock_sni *sni = app->sni;
+  DBusMessage *reply = dbus_pending_call_steal_reply(pending);
+  if (sni && sni->menu_pending == pending) {
+    dbus_pending_call_unref(sni->menu_pending);
+    sni->menu_pending = NULL;
+    struct nizam_dock_menu_item *items = NULL;
+    size_t count = 0;
+    if (sni_menu_parse_layout(reply, &items, &count)) {
+      sni->menu_items = items;
+      sni->menu_count = count;
+      sni->menu_result = 1;
+    } else {
+      sni->menu_result = -1;
+    }
+  }
+  if (reply) {
+    dbus_message_unref(reply);
+  }
+}
+
+static void sni_menu_about_notify(DBusPendingCall *pending, void *data) {
+  struct nizam_dock_app *app = data;
+  struct nizam_dock_sni *sni = app->sni;
+  DBusMessage *reply = dbus_pending_call_steal_reply(pending);
+  if (reply) {
+    dbus_message_unref(reply);
+  }
+  if (!sni || sni->menu_pending != pending) {
+    return;
+  }
+  dbus_pending_call_unref(sni->menu_pending);
+  sni->menu_pending = NULL;
+  struct nizam_dock_sni_item *item = sni_find_by_id(sni, sni->menu_item_id);
+  if (!item || !sni_menu_send(app, sni_new_menu_layout(item), sni_menu_layout_notify)) {
+    sni->menu_result = -1;
+  }
+}
+
+int nizam_dock_sni_menu_request(struct nizam_dock_app *app, size_t idx) {
+  if (!app || !app->sni || idx >= app->sni->count) {
+    return 0;
+  }
+  struct nizam_dock_sni *sni = app->sni;
+  struct nizam_dock_sni_item *item = &sni->items[idx];
+  if (!item->menu_path[0]) {
+    if (nizam_dock_debug_enabled()) {
+      fprintf(stderr, "nizam-dock: sni menu missing (Menu path empty) service=%s path=%s\n",
+              item->service, item->path);
+    }
+    return 0;
+  }
+  if (nizam_dock_debug_enabled()) {
+    fprintf(stderr, "nizam-dock: sni menu fetch dest=%s path=%s iface=com.canonical.dbusmenu\n",
+            item->service, item->menu_path);
+  }
+  sni_menu_reset(sni);
+  sni->menu_item_id = item->id;
+  DBusMessage *abt = dbus_message_new_method_call(
+      item->service, item->menu_path,
+      "com.canonical.dbusmenu", "AboutToShow");
+  if (abt) {
+    int32_t root_id = 0;
+    dbus_message_append_args(abt, DBUS_TYPE_INT32, &root_id, DBUS_TYPE_INVALID);
+    if (sni_menu_send(app, abt, sni_menu_about_notify)) {
+      return 1;
+    }
+  }
+  if (sni_menu_send(app, sni_new_menu_layout(item), sni_menu_layout_notify)) {
+    return 1;
+  }
+  sni->menu_item_id = 0;
+  return 0;
+}
+
+int nizam_dock_sni_menu_take(struct nizam_dock_app *app, size_t *idx,
+                             struct nizam_dock_menu_item **items, size_t *count) {
+  if (!app || !app->sni || !idx || !items || !count || app->sni->menu_result == 0) {
+    return 0;
+  }
+  struct nizam_dock_sni *sni = app->sni;
+  int result = sni->menu_result;
+  *idx = sni->count;
+  for (size_t i = 0; i < sni->count; ++i) {
+    if (sni->items[i].id == sni->menu_item_id) {
+      *idx = i;
+      break;
+    }
+  }
+  *items = NULL;
+  *count = 0;
+  if (result > 0 && *idx < sni->count) {
+    *items = sni->menu_items;
+    *count = sni->menu_count;
+    sni->menu_items = NULL;
+    sni->menu_count = 0;
+  } else {
+    result = -1;
+  }
+  sni_menu_reset(sni);
+  return result;
+}
+
 int nizam_dock_sni_menu_event(struct nizam_dock_app *app, size_t idx, int32_t item_id, uint32_t time) {
   if (!app || !app->sni || idx >= app->sni->count) {
     return 0;
@@ -2090,13 +2463,5 @@ int nizam_dock_sni_menu_event(struct nizam_dock_app *app, size_t idx, int32_t it
   dbus_message_iter_append_basic(&var, DBUS_TYPE_STRING, &empty);
   dbus_message_iter_close_container(&iter, &var);
   dbus_message_iter_append_basic(&iter, DBUS_TYPE_UINT32, &time);
-  DBusMessage *reply = dbus_connection_send_with_reply_and_block(
-      app->sni->conn, msg, 500, NULL);
-  dbus_message_unref(msg);
-  if (!reply) {
-    return 0;
-  }
-  dbus_message_unref(reply);
-  dbus_connection_flush(app->sni->conn);
-  return 1;
+  return sni_send_method(app->sni, msg, "Event");
 }
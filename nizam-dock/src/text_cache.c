@@ -0,0 +1,163 @@
+#include "text_cache.h"
+
+#include <cairo/cairo.h>
+#include <glib.h>
+#include <pango/pangocairo.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct text_entry {
+  cairo_surface_t *mask;
+  int origin_x;
+  int origin_y;
+  int baseline;
+  int advance;
+};
+
+struct nizam_dock_text_cache {
+  GHashTable *map;
+  PangoContext *context;
+  PangoLayout *layout;
+  int capacity;
+  uint64_t hits;
+  uint64_t misses;
+};
+
+static void text_entry_free(gpointer data) {
+  struct text_entry *entry = data;
+  if (!entry) {
+    return;
+  }
+  if (entry->mask) {
+    cairo_surface_destroy(entry->mask);
+  }
+  free(entry);
+}
+
+struct nizam_dock_text_cache *nizam_dock_text_cache_new(int capacity) {
+  struct nizam_dock_text_cache *cache = calloc(1, sizeof(*cache));
+  if (!cache) {
+    return NULL;
+  }
+  cache->capacity = capacity;
+  cache->map = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, text_entry_free);
+  cache->context = pango_font_map_create_context(pango_cairo_font_map_get_default());
+  cairo_font_options_t *options = cairo_font_options_create();
+  cairo_font_options_set_antialias(options, CAIRO_ANTIALIAS_GRAY);
+  pango_cairo_context_set_font_options(cache->context, options);
+  cairo_font_options_destroy(options);
+  cache->layout = pango_layout_new(cache->context);
+  pango_layout_set_single_paragraph_mode(cache->layout, TRUE);
+  return cache;
+}
+
+void nizam_dock_text_cache_clear(struct nizam_dock_text_cache *cache) {
+  if (!cache) {
+    return;
+  }
+  g_hash_table_remove_all(cache->map);
+}
+
+void nizam_dock_text_cache_free(struct nizam_dock_text_cache *cache) {
+  if (!cache) {
+    return;
+  }
+  g_hash_table_destroy(cache->map);
+  g_object_unref(cache->layout);
+  g_object_unref(cache->context);
+  free(cache);
+}
+
+static struct text_entry *text_entry_render(struct nizam_dock_text_cache *cache,
+                                            const char *family, int bold, double px,
+                                            const char *text) {
+  PangoFontDescription *desc = pango_font_description_new();
+  pango_font_description_set_family(desc, family);
+  pango_font_description_set_weight(desc, bold ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
+  pango_font_description_set_absolute_size(desc, px * PANGO_SCALE);
+  pango_layout_set_font_description(cache->layout, desc);
+  pango_font_description_free(desc);
+  pango_layout_set_text(cache->layout, text, -1);
+
+  PangoRectangle ink;
+  PangoRectangle logical;
+  pango_layout_get_pixel_extents(cache->layout, &ink, &logical);
+  int x0 = ink.x < logical.x ? ink.x : logical.x;
+  int y0 = ink.y < logical.y ? ink.y : logical.y;
+  int x1 = ink.x + ink.width > logical.x + logical.width ? ink.x + ink.width
+                                                         : logical.x + logical.width;
+  int y1 = ink.y + ink.height > logical.y + logical.height ? ink.y + ink.height
+                                                           : logical.y + logical.height;
+
+  struct text_entry *entry = calloc(1, sizeof(*entry));
+  if (!entry) {
+    return NULL;
+  }
+  entry->origin_x = x0;
+  entry->origin_y = y0;
+  entry->baseline = PANGO_PIXELS(pango_layout_get_baseline(cache->layout));
+  entry->advance = logical.width;
+  if (x1 <= x0 || y1 <= y0) {
+    return entry;
+  }
+
+  entry->mask = cairo_image_surface_create(CAIRO_FORMAT_A8, x1 - x0, y1 - y0);
+  if (cairo_surface_status(entry->mask) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(entry->mask);
+    entry->mask = NULL;
+    return entry;
+  }
+  cairo_t *cr = cairo_create(entry->mask);
+  cairo_move_to(cr, -x0, -y0);
+  pango_cairo_show_layout(cr, cache->layout);
+  cairo_destroy(cr);
+  cairo_surface_flush(entry->mask);
+  return entry;
+}
+
+int nizam_dock_text_draw(struct nizam_dock_text_cache *cache, cairo_t *cr,
+                         const char *family, int bold, double px,
+                         double x, double y, const char *text) {
+  if (!cache || !cr || !text || !*text) {
+    return 0;
+  }
+  if (!family || !*family) {
+    family = "Sans";
+  }
+
+  char *key = g_strdup_printf("%s\x1f%d\x1f%.2f\x1f%s", family, bold ? 1 : 0, px, text);
+  struct text_entry *entry = g_hash_table_lookup(cache->map, key);
+  if (entry) {
+    cache->hits++;
+    g_free(key);
+  } else {
+    cache->misses++;
+    entry = text_entry_render(cache, family, bold, px, text);
+    if (!entry) {
+      g_free(key);
+      return 0;
+    }
+    if ((int)g_hash_table_size(cache->map) >= cache->capacity) {
+      g_hash_table_remove_all(cache->map);
+    }
+    g_hash_table_insert(cache->map, key, entry);
+  }
+
+  if (entry->mask) {
+    cairo_mask_surface(cr, entry->mask,
+                       x + entry->origin_x,
+                       y - entry->baseline + entry->origin_y);
+  }
+  return entry->advance;
+}
+
+void nizam_dock_text_cache_get_stats(const struct nizam_dock_text_cache *cache,
+                                     struct nizam_dock_text_cache_stats *out) {
+  if (!cache || !out) {
+    return;
+  }
+  out->hits = cache->hits;
+  out->misses = cache->misses;
+  out->size = (int)g_hash_table_size(cache->map);
+  out->capacity = cache->capacity;
+}
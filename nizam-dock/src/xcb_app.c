@@ -2,12 +2,14 @@
 #include "xcb_app.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <time.h>
@@ -21,11 +23,17 @@
 #include "cairo_draw.h"
 #include "icon_surface_cache.h"
 #include "icon_policy.h"
+#include "launch_prefetch.h"
+#include "nizam_launch.h"
 #include "sni.h"
+#include "text_cache.h"
 
 #define SYSTEM_TRAY_REQUEST_DOCK 0
 #define XEMBED_EMBEDDED_NOTIFY 0
 
+#define NIZAM_DOCK_SLIDE_MS 160
+#define NIZAM_DOCK_SLIDE_FRAME_MS 16
+
 
 #define NIZAM_DOCK_TRAY_BG_PIXEL 0x353a3du
 
@@ -63,11 +71,15 @@ static void xembed_update_background(struct nizam_dock_app *app);
 static void menu_hide(struct nizam_dock_app *app);
 static void menu_draw(struct nizam_dock_app *app);
 static int menu_show(struct nizam_dock_app *app, const struct nizam_dock_config *cfg,
-                     size_t tray_idx, int anchor_x, int anchor_y);
-static void tray_icon_root_anchor(const struct nizam_dock_app *app, int idx,
+                     size_t tray_idx, int anchor_x, int anchor_y,
+                     struct nizam_dock_menu_item *items, size_t count);
+static int menu_request(struct nizam_dock_app *app, size_t tray_idx,
+                        int anchor_x, int anchor_y, int button, uint32_t time);
+static void tray_menu_fallback(struct nizam_dock_app *app, size_t tray_idx,
+                               int anchor_x, int anchor_y, int button, uint32_t time);
+static void tray_icon_root_anchor(struct nizam_dock_app *app, int idx,
                                   int ex, int ey, int rx, int ry,
                                   int *out_x, int *out_y);
-static void launch_cmd(const char *cmd);
 
 enum redraw_reason {
   REDRAW_REASON_MOTION = 1,
@@ -106,6 +118,7 @@ static int query_pointer_root_xy(struct nizam_dock_app *app, int *out_x, int *ou
   }
   xcb_query_pointer_cookie_t c = xcb_query_pointer(app->conn, app->screen->root);
   xcb_query_pointer_reply_t *r = xcb_query_pointer_reply(app->conn, c, NULL);
+  app->roundtrips_total++;
   if (!r) {
     return 0;
   }
@@ -129,108 +142,164 @@ static void dock_set_default_monitor(struct nizam_dock_app *app) {
   app->mon_h = (int)app->screen->height_in_pixels;
 }
 
-static void dock_pick_monitor_for_pointer(struct nizam_dock_app *app) {
-  dock_set_default_monitor(app);
-  if (!app || !app->conn || !app->screen) {
-    return;
-  }
+static void dock_monitors_refresh(struct nizam_dock_app *app) {
+  nizam_monitors_begin(&app->monitors);
 
-  int px = 0;
-  int py = 0;
-  int have_ptr = query_pointer_root_xy(app, &px, &py);
+  xcb_randr_get_output_primary_cookie_t pc = xcb_randr_get_output_primary(app->conn, app->screen->root);
+  xcb_randr_get_screen_resources_current_cookie_t rc =
+      xcb_randr_get_screen_resources_current(app->conn, app->screen->root);
 
   xcb_randr_output_t primary = XCB_NONE;
-  {
-    xcb_randr_get_output_primary_cookie_t pc = xcb_randr_get_output_primary(app->conn, app->screen->root);
-    xcb_randr_get_output_primary_reply_t *pr = xcb_randr_get_output_primary_reply(app->conn, pc, NULL);
-    if (pr) {
-      primary = pr->output;
-      free(pr);
-    }
+  xcb_randr_get_output_primary_reply_t *pr = xcb_randr_get_output_primary_reply(app->conn, pc, NULL);
+  if (pr) {
+    primary = pr->output;
+    free(pr);
   }
-
-  xcb_randr_get_screen_resources_current_cookie_t rc =
-      xcb_randr_get_screen_resources_current(app->conn, app->screen->root);
   xcb_randr_get_screen_resources_current_reply_t *res =
       xcb_randr_get_screen_resources_current_reply(app->conn, rc, NULL);
+  app->roundtrips_total++;
   if (!res) {
     return;
   }
 
-  int picked = 0;
-  int primary_x = 0, primary_y = 0, primary_w = 0, primary_h = 0;
-  int have_primary_geom = 0;
-
   int nout = xcb_randr_get_screen_resources_current_outputs_length(res);
   xcb_randr_output_t *outs = xcb_randr_get_screen_resources_current_outputs(res);
+  if (nout <= 0) {
+    free(res);
+    return;
+  }
+  xcb_randr_get_output_info_cookie_t *oc = calloc((size_t)nout, sizeof(*oc));
+  xcb_randr_get_crtc_info_cookie_t *cc = calloc((size_t)nout, sizeof(*cc));
+  xcb_randr_crtc_t *crtcs = calloc((size_t)nout, sizeof(*crtcs));
+  char (*names)[NIZAM_MONITOR_NAME_MAX] = calloc((size_t)nout, sizeof(*names));
+  if (!oc || !cc || !crtcs || !names) {
+    free(oc);
+    free(cc);
+    free(crtcs);
+    free(names);
+    free(res);
+    return;
+  }
+
+  for (int i = 0; i < nout; ++i) {
+    oc[i] = xcb_randr_get_output_info(app->conn, outs[i], XCB_CURRENT_TIME);
+  }
   for (int i = 0; i < nout; ++i) {
-    xcb_randr_output_t out = outs[i];
-    xcb_randr_get_output_info_cookie_t oc =
-        xcb_randr_get_output_info(app->conn, out, XCB_CURRENT_TIME);
     xcb_randr_get_output_info_reply_t *oi =
-        xcb_randr_get_output_info_reply(app->conn, oc, NULL);
+        xcb_randr_get_output_info_reply(app->conn, oc[i], NULL);
     if (!oi) {
       continue;
     }
-    if (oi->connection != XCB_RANDR_CONNECTION_CONNECTED || oi->crtc == XCB_NONE) {
-      free(oi);
+    if (oi->connection == XCB_RANDR_CONNECTION_CONNECTED && oi->crtc != XCB_NONE) {
+      cc[i] = xcb_randr_get_crtc_info(app->conn, oi->crtc, XCB_CURRENT_TIME);
+      crtcs[i] = oi->crtc;
+      int len = xcb_randr_get_output_info_name_length(oi);
+      if (len >= NIZAM_MONITOR_NAME_MAX) {
+        len = NIZAM_MONITOR_NAME_MAX - 1;
+      }
+      memcpy(names[i], xcb_randr_get_output_info_name(oi), (size_t)len);
+    }
+    free(oi);
+  }
+  app->roundtrips_total++;
+
+  int any_crtc = 0;
+  for (int i = 0; i < nout; ++i) {
+    if (crtcs[i] == XCB_NONE) {
       continue;
     }
-    xcb_randr_get_crtc_info_cookie_t cc =
-        xcb_randr_get_crtc_info(app->conn, oi->crtc, XCB_CURRENT_TIME);
+    any_crtc = 1;
     xcb_randr_get_crtc_info_reply_t *ci =
-        xcb_randr_get_crtc_info_reply(app->conn, cc, NULL);
+        xcb_randr_get_crtc_info_reply(app->conn, cc[i], NULL);
     if (!ci) {
-      free(oi);
       continue;
     }
+    struct nizam_monitor *m = NULL;
+    if (ci->width > 0 && ci->height > 0 && (m = nizam_monitors_add(&app->monitors)) != NULL) {
+      m->x = (int)ci->x;
+      m->y = (int)ci->y;
+      m->w = (int)ci->width;
+      m->h = (int)ci->height;
+      m->crtc = crtcs[i];
+      m->output = outs[i];
+      m->primary = outs[i] == primary;
+      memcpy(m->name, names[i], sizeof(m->name));
+    }
+    free(ci);
+  }
+  if (any_crtc) {
+    app->roundtrips_total++;
+  }
 
-    int rx = (int)ci->x;
-    int ry = (int)ci->y;
-    int rw = (int)ci->width;
-    int rh = (int)ci->height;
+  free(oc);
+  free(cc);
+  free(crtcs);
+  free(names);
+  free(res);
 
-    if (rw > 0 && rh > 0) {
-      if (out == primary) {
-        primary_x = rx;
-        primary_y = ry;
-        primary_w = rw;
-        primary_h = rh;
-        have_primary_geom = 1;
-      }
+  if (nizam_dock_debug_enabled()) {
+    fprintf(stderr, "nizam-dock: monitors refreshed count=%zu primary=%d\n",
+            app->monitors.count, nizam_monitors_primary(&app->monitors));
+  }
+}
 
-      if (!picked && have_ptr && point_in_rect(px, py, rx, ry, rw, rh)) {
-        app->mon_x = rx;
-        app->mon_y = ry;
-        app->mon_w = rw;
-        app->mon_h = rh;
-        picked = 1;
-      }
-    }
+static const char *dock_monitor_spec(void) {
+  const char *env = getenv("NIZAM_DOCK_MONITORS");
+  return env && *env ? env : "all";
+}
 
-    free(ci);
-    free(oi);
-    if (picked) {
+static void dock_pick_monitor_for_pointer(struct nizam_dock_app *app) {
+  dock_set_default_monitor(app);
+  if (!app || !app->conn || !app->screen) {
+    return;
+  }
+  if (!app->monitors.valid) {
+    dock_monitors_refresh(app);
+  }
+  if (!app->have_pointer) {
+    app->have_pointer = query_pointer_root_xy(app, &app->pointer_root_x, &app->pointer_root_y);
+  }
+
+  int selected[16];
+  size_t nsel = nizam_monitors_select(&app->monitors, dock_monitor_spec(),
+                                      selected, sizeof(selected) / sizeof(selected[0]));
+  int px = app->pointer_root_x;
+  int py = app->pointer_root_y;
+  int under = app->have_pointer ? nizam_monitors_at(&app->monitors, px, py) : -1;
+  int primary = nizam_monitors_primary(&app->monitors);
+  int picked = -1;
+  for (size_t i = 0; i < nsel; ++i) {
+    if (selected[i] == under) {
+      picked = under;
       break;
     }
+    if (picked < 0 || selected[i] == primary) {
+      picked = selected[i];
+    }
   }
-
-  if (!picked && have_primary_geom) {
-    app->mon_x = primary_x;
-    app->mon_y = primary_y;
-    app->mon_w = primary_w;
-    app->mon_h = primary_h;
-    picked = 1;
+  if (nsel == 0) {
+    picked = under >= 0 ? under : primary;
+  }
+  if (picked >= 0 && (size_t)picked < app->monitors.count) {
+    const struct nizam_monitor *m = &app->monitors.items[picked];
+    app->mon_x = m->x;
+    app->mon_y = m->y;
+    app->mon_w = m->w;
+    app->mon_h = m->h;
   }
 
   if (nizam_dock_debug_enabled()) {
-    fprintf(stderr, "nizam-dock: monitor pick ptr=%s (%d,%d) mon=%dx%d+%d+%d primary=0x%08x\n",
-            have_ptr ? "yes" : "no", px, py,
+    fprintf(stderr, "nizam-dock: monitor pick ptr=%s (%d,%d) mon=%dx%d+%d+%d primary=%d selected=%zu\n",
+            app->have_pointer ? "yes" : "no", px, py,
             app->mon_w, app->mon_h, app->mon_x, app->mon_y,
-            (unsigned)primary);
+            primary, nsel);
   }
+}
 
-  free(res);
+static void track_pointer(struct nizam_dock_app *app, int root_x, int root_y) {
+  app->pointer_root_x = root_x;
+  app->pointer_root_y = root_y;
+  app->have_pointer = 1;
 }
 
 static void cancel_hide_pending(struct nizam_dock_app *app) {
@@ -604,18 +673,24 @@ static void nizam_dock_log_event_stats(struct nizam_dock_app *app) {
   }
   app->last_debug_log_ms = now;
   fprintf(stderr,
-          "[dock] motion=%llu redraw=%llu hover_changes=%llu timeout_redraw=%llu expose_redraw=%llu\n",
+          "[dock] motion=%llu redraw=%llu hover_changes=%llu timeout_redraw=%llu expose_redraw=%llu base_rebuilds=%llu slide_frames=%llu roundtrips=%llu\n",
           (unsigned long long)app->motion_events_total,
           (unsigned long long)app->redraw_total,
           (unsigned long long)app->hover_changes,
           (unsigned long long)app->redraw_reason_timeout,
-          (unsigned long long)app->redraw_reason_expose);
+          (unsigned long long)app->redraw_reason_expose,
+          (unsigned long long)app->layer_base_rebuilds,
+          (unsigned long long)app->anim_frames,
+          (unsigned long long)app->roundtrips_total);
   app->motion_events_total = 0;
   app->redraw_total = 0;
   app->hover_changes = 0;
   app->redraw_reason_motion = 0;
   app->redraw_reason_timeout = 0;
   app->redraw_reason_expose = 0;
+  app->layer_base_rebuilds = 0;
+  app->anim_frames = 0;
+  app->roundtrips_total = 0;
 }
 
 static void set_dock_stack(struct nizam_dock_app *app, int above);
@@ -656,6 +731,11 @@ static int update_hover_state(struct nizam_dock_app *app,
       new_tray == app->hovered_tray_idx) {
     return 0;
   }
+  if (new_launcher != app->hovered_launcher_idx) {
+    nizam_dock_damage_launcher(app, app->hovered_launcher_idx);
+    nizam_dock_damage_launcher(app, new_launcher);
+    app->prefetch_due_ms = new_launcher >= 0 ? now_ms() + NIZAM_DOCK_PREFETCH_DWELL_MS : 0;
+  }
   app->hovered_launcher_idx = new_launcher;
   app->hovered_tray_idx = new_tray;
   app->hover_changes++;
@@ -669,8 +749,13 @@ static void handle_motion_event(struct nizam_dock_app *app,
     return;
   }
   app->motion_events_total++;
+  track_pointer(app, motion->root_x, motion->root_y);
+  if (motion->event == app->window) {
+    app->pointer_inside = 1;
+  }
   if (app->is_hidden && app->strip != XCB_NONE && motion->event == app->strip) {
     if (show_dock(app)) {
+      nizam_dock_damage_all(app);
       schedule_redraw(app, 1, REDRAW_REASON_MOTION);
     }
     return;
@@ -692,16 +777,43 @@ static void process_event(struct nizam_dock_app *app,
   if (type == 0) {
     return;
   }
-  switch (type) {
-    case XCB_RANDR_SCREEN_CHANGE_NOTIFY:
+  if (app->randr_event_base &&
+      type == app->randr_event_base + XCB_RANDR_SCREEN_CHANGE_NOTIFY) {
+    app->monitors.valid = 0;
+    handle_screen_change(app, cfg);
+    nizam_dock_damage_all(app);
+    schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
+    return;
+  }
+  if (app->randr_event_base &&
+      type == app->randr_event_base + XCB_RANDR_NOTIFY) {
+    xcb_randr_notify_event_t *rn = (xcb_randr_notify_event_t *)event;
+    int changed = 0;
+    if (rn->subCode == XCB_RANDR_NOTIFY_CRTC_CHANGE) {
+      const xcb_randr_crtc_change_t *cc = &rn->u.cc;
+      int live = cc->mode != XCB_NONE;
+      changed = nizam_monitors_crtc_changed(&app->monitors, cc->crtc, cc->x, cc->y,
+                                            live ? cc->width : 0, live ? cc->height : 0);
+    } else if (rn->subCode == XCB_RANDR_NOTIFY_OUTPUT_CHANGE) {
+      changed = -1;
+    }
+    if (changed < 0) {
+      app->monitors.valid = 0;
+    }
+    if (changed != 0) {
       handle_screen_change(app, cfg);
+      nizam_dock_damage_all(app);
       schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
-      break;
+    }
+    return;
+  }
+  switch (type) {
     case XCB_PROPERTY_NOTIFY: {
       xcb_property_notify_event_t *prop = (xcb_property_notify_event_t *)event;
       if (prop->window == app->screen->root &&
           (prop->atom == app->atoms.xrootpmap_id || prop->atom == app->atoms.xsetroot_id)) {
         if (nizam_dock_xcb_update_root_pixmap(app)) {
+          nizam_dock_layers_invalidate(app);
           schedule_redraw(app, 0, REDRAW_REASON_TIMEOUT);
         }
       }
@@ -720,6 +832,7 @@ static void process_event(struct nizam_dock_app *app,
           }
           xembed_add_client(app, win);
           handle_screen_change(app, cfg);
+          nizam_dock_damage_tray(app);
           schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
         }
       }
@@ -730,6 +843,7 @@ static void process_event(struct nizam_dock_app *app,
       if (xembed_find(app, destroy->window) >= 0) {
         xembed_remove_client(app, destroy->window);
         handle_screen_change(app, cfg);
+        nizam_dock_damage_tray(app);
         schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
       }
       break;
@@ -739,17 +853,23 @@ static void process_event(struct nizam_dock_app *app,
       if (xembed_find(app, unmap->window) >= 0) {
         xembed_remove_client(app, unmap->window);
         handle_screen_change(app, cfg);
+        nizam_dock_damage_tray(app);
         schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
       }
       break;
     }
     case XCB_ENTER_NOTIFY: {
       xcb_enter_notify_event_t *enter = (xcb_enter_notify_event_t *)event;
+      track_pointer(app, enter->root_x, enter->root_y);
       if (enter->event == app->window) {
+        app->pointer_inside = 1;
         cancel_hide_pending(app);
       }
-      if (app->is_hidden && (app->strip != XCB_NONE && enter->event == app->strip)) {
+      if (app->is_hidden &&
+          ((app->strip != XCB_NONE && enter->event == app->strip) ||
+           (app->anim_active && enter->event == app->window))) {
         if (show_dock(app)) {
+          nizam_dock_damage_all(app);
           schedule_redraw(app, 1, REDRAW_REASON_MOTION);
         }
       }
@@ -762,7 +882,14 @@ static void process_event(struct nizam_dock_app *app,
     }
     case XCB_LEAVE_NOTIFY: {
       xcb_leave_notify_event_t *leave = (xcb_leave_notify_event_t *)event;
+      track_pointer(app, leave->root_x, leave->root_y);
       if (leave->event == app->window) {
+        if (leave->mode == XCB_NOTIFY_MODE_GRAB) {
+          app->pointer_inside = point_in_rect(leave->event_x, leave->event_y,
+                                              0, 0, app->panel_w, app->panel_h);
+        } else if (leave->detail != XCB_NOTIFY_DETAIL_INFERIOR) {
+          app->pointer_inside = 0;
+        }
         if (leave->detail != XCB_NOTIFY_DETAIL_INFERIOR) {
           schedule_hide(app, cfg);
         }
@@ -778,6 +905,7 @@ static void process_event(struct nizam_dock_app *app,
     }
     case XCB_BUTTON_PRESS: {
       xcb_button_press_event_t *press = (xcb_button_press_event_t *)event;
+      int64_t click_us = nizam_launch_now_us();
       if (app->menu_visible && press->event == app->menu_window) {
         int idx = press->event_y / app->menu_item_h;
         if (idx >= 0 && (size_t)idx < app->menu_count) {
@@ -821,11 +949,8 @@ static void process_event(struct nizam_dock_app *app,
           if (nizam_dock_debug_enabled()) {
             fprintf(stderr, "nizam-dock: tray hit (right) idx=%d\n", tray_idx);
           }
-          if (!menu_show(app, cfg, (size_t)tray_idx, anchor_x, anchor_y)) {
-            if (nizam_dock_sni_item_has_context(app, (size_t)tray_idx)) {
-              lower_dock_for_external_popup(app, 8000);
-              nizam_dock_sni_context_menu(app, (size_t)tray_idx, anchor_x, anchor_y);
-            }
+          if (!menu_request(app, (size_t)tray_idx, anchor_x, anchor_y, 3, press->time)) {
+            tray_menu_fallback(app, (size_t)tray_idx, anchor_x, anchor_y, 3, press->time);
           }
           break;
         }
@@ -833,7 +958,8 @@ static void process_event(struct nizam_dock_app *app,
       {
         int idx = hit_test_launcher(app, press->event_x, press->event_y);
         if (idx >= 0 && (size_t)idx < cfg->launcher_count) {
-          launch_cmd(cfg->launchers[idx].cmd);
+          nizam_dock_prefetch_note_launch(app->prefetch, cfg->launchers[idx].cmd);
+          nizam_launch_spawn(cfg->launchers[idx].cmd, click_us, 0);
         }
       }
       break;
@@ -866,39 +992,11 @@ static void process_event(struct nizam_dock_app *app,
             fprintf(stderr, "nizam-dock: tray hit (left) idx=%d\n", tray_idx);
           }
 
-          if (nizam_dock_sni_item_has_menu(app, (size_t)tray_idx)) {
-            if (menu_show(app, cfg, (size_t)tray_idx, anchor_x, anchor_y)) {
-              break;
-            }
-          }
-
-          int acted = 0;
-          if (nizam_dock_sni_item_has_xayatana_secondary(app, (size_t)tray_idx)) {
-            lower_dock_for_external_popup(app, 3000);
-            acted |= nizam_dock_sni_xayatana_secondary(app, (size_t)tray_idx, release->time);
-          }
-          if (nizam_dock_sni_item_has_secondary(app, (size_t)tray_idx)) {
-            lower_dock_for_external_popup(app, 8000);
-            acted |= nizam_dock_sni_secondary_activate(app, (size_t)tray_idx,
-                                                  anchor_x, anchor_y);
-          }
-          if (!acted && nizam_dock_sni_item_has_activate(app, (size_t)tray_idx)) {
-            lower_dock_for_external_popup(app, 8000);
-            acted = nizam_dock_sni_activate(app, (size_t)tray_idx,
-                                       anchor_x, anchor_y);
-          }
-          if (!acted && nizam_dock_sni_item_is_menu(app, (size_t)tray_idx)) {
-            acted = menu_show(app, cfg, (size_t)tray_idx,
-                              anchor_x, anchor_y);
-            if (!acted) {
-              lower_dock_for_external_popup(app, 8000);
-              acted = nizam_dock_sni_context_menu(app, (size_t)tray_idx,
-                                                  anchor_x, anchor_y);
-            }
-          }
-          if (!acted && nizam_dock_debug_enabled()) {
-            fprintf(stderr, "nizam-dock: tray left no action available\n");
+          if (nizam_dock_sni_item_has_menu(app, (size_t)tray_idx) &&
+              menu_request(app, (size_t)tray_idx, anchor_x, anchor_y, 1, release->time)) {
+            break;
           }
+          tray_menu_fallback(app, (size_t)tray_idx, anchor_x, anchor_y, 1, release->time);
           break;
         }
       }
@@ -911,6 +1009,7 @@ static void process_event(struct nizam_dock_app *app,
       } else if (expose->window == app->xembed_window) {
         xembed_update_background(app);
       } else if (expose->window == app->window) {
+        nizam_dock_damage_rect(app, expose->x, expose->y, expose->width, expose->height);
         schedule_redraw(app, 1, REDRAW_REASON_EXPOSE);
       }
       break;
@@ -923,6 +1022,7 @@ static void process_event(struct nizam_dock_app *app,
             (!app->suppress_raise_until_ms || now_ms() >= app->suppress_raise_until_ms)) {
           set_dock_stack(app, 1);
         }
+        nizam_dock_damage_all(app);
         schedule_redraw(app, 1, REDRAW_REASON_EXPOSE);
       } else if (vis->window == app->xembed_window) {
         xembed_update_background(app);
@@ -949,17 +1049,68 @@ static void move_window_x(struct nizam_dock_app *app, int x) {
   app->panel_x = x;
 }
 
-static void slide_window_x(struct nizam_dock_app *app, int from_x, int to_x) {
-  int steps = 10;
-  int delay_ms = 16;
-  for (int i = 1; i <= steps; ++i) {
-    int x = from_x + ((to_x - from_x) * i) / steps;
-    move_window_x(app, x);
-    xcb_flush(app->conn);
-    struct timespec ts = {0};
-    ts.tv_nsec = delay_ms * 1000000L;
-    nanosleep(&ts, NULL);
+static void slide_start(struct nizam_dock_app *app, int to_x) {
+  int from_x = app->panel_x;
+  int span = app->x_hidden - app->x_visible;
+  if (span < 0) span = -span;
+  int dist = to_x - from_x;
+  if (dist < 0) dist = -dist;
+  int64_t duration = NIZAM_DOCK_SLIDE_MS;
+  if (span > 0) {
+    duration = (NIZAM_DOCK_SLIDE_MS * dist) / span;
+  }
+  int64_t now = now_ms();
+  app->anim_active = 1;
+  app->anim_from_x = from_x;
+  app->anim_to_x = to_x;
+  app->anim_start_ms = now;
+  app->anim_duration_ms = duration;
+  app->anim_next_frame_ms = now;
+}
+
+static void slide_finish(struct nizam_dock_app *app) {
+  app->anim_active = 0;
+  move_window_x(app, app->anim_to_x);
+  if (app->is_hidden) {
+    
+    
+    xcb_unmap_window(app->conn, app->window);
+    set_strip_stack(app, 1);
+    
+    notify_panel_redraw(app);
+  } else {
+    set_strip_stack(app, 0);
   }
+  xcb_flush(app->conn);
+}
+
+static void slide_cancel(struct nizam_dock_app *app) {
+  if (!app->anim_active) {
+    return;
+  }
+  app->anim_to_x = app->is_hidden ? app->x_hidden : app->x_visible;
+  slide_finish(app);
+}
+
+static void slide_step(struct nizam_dock_app *app) {
+  if (!app->anim_active) {
+    return;
+  }
+  int64_t now = now_ms();
+  if (now < app->anim_next_frame_ms) {
+    return;
+  }
+  int64_t elapsed = now - app->anim_start_ms;
+  if (elapsed >= app->anim_duration_ms) {
+    slide_finish(app);
+    return;
+  }
+  int x = app->anim_from_x +
+          (int)(((int64_t)(app->anim_to_x - app->anim_from_x) * elapsed) / app->anim_duration_ms);
+  move_window_x(app, x);
+  xcb_flush(app->conn);
+  app->anim_frames++;
+  app->anim_next_frame_ms = now + NIZAM_DOCK_SLIDE_FRAME_MS;
 }
 
 static int show_dock(struct nizam_dock_app *app) {
@@ -967,7 +1118,7 @@ static int show_dock(struct nizam_dock_app *app) {
     return 0;
   }
   int64_t now = now_ms();
-  if (app->last_toggle_ms && now - app->last_toggle_ms < 200) {
+  if (!app->anim_active && app->last_toggle_ms && now - app->last_toggle_ms < 200) {
     return 0;
   }
   
@@ -975,39 +1126,22 @@ static int show_dock(struct nizam_dock_app *app) {
 
   
   
-  move_window_x(app, app->x_hidden);
+  if (!app->anim_active) {
+    move_window_x(app, app->x_hidden);
+  }
   xcb_map_window(app->conn, app->window);
   if (app->xembed_window != XCB_NONE) {
     xcb_map_window(app->conn, app->xembed_window);
   }
   xcb_flush(app->conn);
 
-  slide_window_x(app, app->x_hidden, app->x_visible);
-  set_strip_stack(app, 0);
+  slide_start(app, app->x_visible);
   app->is_hidden = 0;
   app->hide_pending = 0;
   app->last_toggle_ms = now;
-  xcb_flush(app->conn);
   return 1;
 }
 
-static int pointer_inside_window(struct nizam_dock_app *app) {
-  if (!app || app->window == XCB_NONE) {
-    return 0;
-  }
-  xcb_query_pointer_cookie_t cookie = xcb_query_pointer(app->conn, app->window);
-  xcb_query_pointer_reply_t *reply = xcb_query_pointer_reply(app->conn, cookie, NULL);
-  if (!reply) {
-    return 0;
-  }
-  int inside = reply->same_screen &&
-               reply->win_x >= 0 && reply->win_y >= 0 &&
-               reply->win_x < app->panel_w &&
-               reply->win_y < app->panel_h;
-  free(reply);
-  return inside;
-}
-
 static void xembed_update_background(struct nizam_dock_app *app);
 static void xembed_remove_client(struct nizam_dock_app *app, xcb_window_t win);
 
@@ -1106,8 +1240,6 @@ static void menu_draw(struct nizam_dock_app *app) {
   cairo_set_line_width(cr, 1.0);
   cairo_stroke(cr);
 
-  cairo_select_font_face(cr, "Sans", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
-  cairo_set_font_size(cr, 12.0);
   int y = 0;
   for (size_t i = 0; i < app->menu_count; ++i) {
     struct nizam_dock_menu_item *item = &app->menu_items[i];
@@ -1121,11 +1253,12 @@ static void menu_draw(struct nizam_dock_app *app) {
       double alpha = item->enabled ? 0.90 : 0.40;
       cairo_set_source_rgba(cr, 1.0, 1.0, 1.0, alpha);
       double indent = 12.0 + item->level * 12.0;
-      cairo_move_to(cr, indent, y + app->menu_item_h - 6);
-      cairo_show_text(cr, item->label[0] ? item->label : "(untitled)");
+      nizam_dock_text_draw(app->text_cache, cr, "Sans", 0, 12.0,
+                           indent, y + app->menu_item_h - 6,
+                           item->label[0] ? item->label : "(untitled)");
       if (item->submenu) {
-        cairo_move_to(cr, app->menu_w - 14.0, y + app->menu_item_h - 6);
-        cairo_show_text(cr, ">");
+        nizam_dock_text_draw(app->text_cache, cr, "Sans", 0, 12.0,
+                             app->menu_w - 14.0, y + app->menu_item_h - 6, ">");
       }
     }
     y += app->menu_item_h;
@@ -1137,19 +1270,13 @@ static void menu_draw(struct nizam_dock_app *app) {
 }
 
 static int menu_show(struct nizam_dock_app *app, const struct nizam_dock_config *cfg,
-                     size_t owner_idx, int x, int y) {
-  if (!app || !cfg) {
+                     size_t owner_idx, int x, int y,
+                     struct nizam_dock_menu_item *items, size_t count) {
+  if (!app || !cfg || !items || count == 0) {
+    free(items);
     return 0;
   }
   menu_free(app);
-  struct nizam_dock_menu_item *items = NULL;
-  size_t count = 0;
-  if (!nizam_dock_sni_menu_fetch(app, owner_idx, &items, &count)) {
-    if (nizam_dock_debug_enabled()) {
-      fprintf(stderr, "nizam-dock: menu fetch failed for idx=%zu\n", owner_idx);
-    }
-    return 0;
-  }
   if (nizam_dock_debug_enabled()) {
     fprintf(stderr, "nizam-dock: menu show count=%zu at %d,%d\n", count, x, y);
   }
@@ -1277,6 +1404,73 @@ static int menu_show(struct nizam_dock_app *app, const struct nizam_dock_config
   return 1;
 }
 
+static int menu_request(struct nizam_dock_app *app, size_t tray_idx,
+                        int anchor_x, int anchor_y, int button, uint32_t time) {
+  if (!nizam_dock_sni_menu_request(app, tray_idx)) {
+    return 0;
+  }
+  app->menu_pending = 1;
+  app->menu_pending_x = anchor_x;
+  app->menu_pending_y = anchor_y;
+  app->menu_pending_button = button;
+  app->menu_pending_time = time;
+  return 1;
+}
+
+static void tray_menu_fallback(struct nizam_dock_app *app, size_t tray_idx,
+                               int anchor_x, int anchor_y, int button, uint32_t time) {
+  if (button == 3) {
+    if (nizam_dock_sni_item_has_context(app, tray_idx)) {
+      lower_dock_for_external_popup(app, 8000);
+      nizam_dock_sni_context_menu(app, tray_idx, anchor_x, anchor_y);
+    }
+    return;
+  }
+  int acted = 0;
+  if (nizam_dock_sni_item_has_xayatana_secondary(app, tray_idx)) {
+    lower_dock_for_external_popup(app, 3000);
+    acted |= nizam_dock_sni_xayatana_secondary(app, tray_idx, time);
+  }
+  if (nizam_dock_sni_item_has_secondary(app, tray_idx)) {
+    lower_dock_for_external_popup(app, 8000);
+    acted |= nizam_dock_sni_secondary_activate(app, tray_idx, anchor_x, anchor_y);
+  }
+  if (!acted && nizam_dock_sni_item_has_activate(app, tray_idx)) {
+    lower_dock_for_external_popup(app, 8000);
+    acted = nizam_dock_sni_activate(app, tray_idx, anchor_x, anchor_y);
+  }
+  if (!acted && nizam_dock_sni_item_is_menu(app, tray_idx)) {
+    lower_dock_for_external_popup(app, 8000);
+    acted = nizam_dock_sni_context_menu(app, tray_idx, anchor_x, anchor_y);
+  }
+  if (!acted && nizam_dock_debug_enabled()) {
+    fprintf(stderr, "nizam-dock: tray left no action available\n");
+  }
+}
+
+static void handle_sni_menu(struct nizam_dock_app *app, const struct nizam_dock_config *cfg) {
+  if (!app->menu_pending) {
+    return;
+  }
+  size_t idx = 0;
+  struct nizam_dock_menu_item *items = NULL;
+  size_t count = 0;
+  int result = nizam_dock_sni_menu_take(app, &idx, &items, &count);
+  if (result == 0) {
+    return;
+  }
+  app->menu_pending = 0;
+  if (result > 0 &&
+      menu_show(app, cfg, idx, app->menu_pending_x, app->menu_pending_y, items, count)) {
+    return;
+  }
+  if (nizam_dock_debug_enabled()) {
+    fprintf(stderr, "nizam-dock: menu fetch failed for idx=%zu\n", idx);
+  }
+  tray_menu_fallback(app, idx, app->menu_pending_x, app->menu_pending_y,
+                     app->menu_pending_button, app->menu_pending_time);
+}
+
 static int hide_dock(struct nizam_dock_app *app) {
   if (app->is_hidden) {
     return 0;
@@ -1291,32 +1485,206 @@ static int hide_dock(struct nizam_dock_app *app) {
   if (app->suppress_hide_until_ms && now < app->suppress_hide_until_ms) {
     return 0;
   }
-  if (pointer_inside_window(app)) {
+  if (app->pointer_inside) {
     return 0;
   }
-  if (app->last_toggle_ms && now - app->last_toggle_ms < 200) {
+  if (!app->anim_active && app->last_toggle_ms && now - app->last_toggle_ms < 200) {
     return 0;
   }
   
   
   set_dock_stack(app, 0);
-  slide_window_x(app, app->x_visible, app->x_hidden);
-
-  
-  
-  xcb_unmap_window(app->conn, app->window);
-
-  set_strip_stack(app, 1);
+  slide_start(app, app->x_hidden);
   app->is_hidden = 1;
   app->hide_pending = 0;
   app->last_toggle_ms = now;
-
-  
-  notify_panel_redraw(app);
   xcb_flush(app->conn);
   return 1;
 }
 
+static void ipc_write_all(int fd, const char *msg) {
+  size_t len = strlen(msg);
+  while (len > 0) {
+    ssize_t n = send(fd, msg, len, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      struct pollfd pfd = {fd, POLLOUT, 0};
+      if (poll(&pfd, 1, NIZAM_DOCK_IPC_TIMEOUT_MS) > 0) {
+        continue;
+      }
+      return;
+    }
+    if (n <= 0) {
+      return;
+    }
+    msg += n;
+    len -= (size_t)n;
+  }
+}
+
+static void ipc_format_stats(struct nizam_dock_app *app, const struct nizam_dock_config *cfg,
+                             char *out, size_t out_size) {
+  long rss = 0;
+  read_proc_status_kb("VmRSS", &rss);
+  struct nizam_dock_icon_cache_stats stats;
+  memset(&stats, 0, sizeof(stats));
+  if (app->icon_cache) {
+    nizam_dock_icon_cache_get_stats(app->icon_cache, &stats);
+  }
+  struct nizam_dock_text_cache_stats text_stats;
+  memset(&text_stats, 0, sizeof(text_stats));
+  nizam_dock_text_cache_get_stats(app->text_cache, &text_stats);
+  struct nizam_dock_prefetch_stats prefetch_stats;
+  memset(&prefetch_stats, 0, sizeof(prefetch_stats));
+  nizam_dock_prefetch_get_stats(app->prefetch, &prefetch_stats);
+  struct nizam_launch_stats launch_stats;
+  nizam_launch_get_stats(&launch_stats);
+  snprintf(out, out_size,
+           "hidden=%d launchers=%zu tray=%zu xembed=%zu rss_kb=%ld\n"
+           "redraw=%llu motion=%llu base_rebuilds=%llu slide_frames=%llu roundtrips=%llu\n"
+           "icon_cache size=%d hits=%llu misses=%llu evictions=%llu uploads=%llu\n"
+           "text_cache size=%d hits=%llu misses=%llu\n"
+           "prefetch requests=%llu files=%llu bytes=%llu launches=%llu warm=%llu partial=%llu\n"
+           "launch total=%llu direct=%llu shell=%llu failed=%llu last_us=%lld max_us=%lld avg_us=%lld\n"
+           "monitors count=%zu refreshes=%llu crtc_updates=%llu\n",
+           app->is_hidden,
+           cfg->launcher_count,
+           nizam_dock_sni_count(app),
+           app->xembed_count,
+           rss,
+           (unsigned long long)app->redraw_total,
+           (unsigned long long)app->motion_events_total,
+           (unsigned long long)app->layer_base_rebuilds,
+           (unsigned long long)app->anim_frames,
+           (unsigned long long)app->roundtrips_total,
+           stats.size,
+           (unsigned long long)stats.hits,
+           (unsigned long long)stats.misses,
+           (unsigned long long)stats.evictions,
+           (unsigned long long)stats.uploads,
+           text_stats.size,
+           (unsigned long long)text_stats.hits,
+           (unsigned long long)text_stats.misses,
+           (unsigned long long)prefetch_stats.requests,
+           (unsigned long long)prefetch_stats.files,
+           (unsigned long long)prefetch_stats.bytes,
+           (unsigned long long)prefetch_stats.launches,
+           (unsigned long long)prefetch_stats.launches_warm,
+           (unsigned long long)prefetch_stats.launches_partial,
+           (unsigned long long)launch_stats.launches,
+           (unsigned long long)launch_stats.direct,
+           (unsigned long long)launch_stats.shell,
+           (unsigned long long)launch_stats.failures,
+           (long long)launch_stats.last_us,
+           (long long)launch_stats.max_us,
+           (long long)(launch_stats.launches > launch_stats.failures
+                           ? launch_stats.total_us / (int64_t)(launch_stats.launches - launch_stats.failures)
+                           : 0),
+           app->monitors.count,
+           (unsigned long long)app->monitors.refreshes,
+           (unsigned long long)app->monitors.crtc_updates);
+}
+
+static void ipc_handle_command(struct nizam_dock_app *app, const struct nizam_dock_config *cfg,
+                               int fd, const char *cmd) {
+  char reply[1024];
+  if (strcmp(cmd, "reload") == 0) {
+    g_reload_config = 1;
+    snprintf(reply, sizeof(reply), "ok\n");
+  } else if (strcmp(cmd, "show") == 0) {
+    cancel_hide_pending(app);
+    if (show_dock(app)) {
+      nizam_dock_damage_all(app);
+      schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
+    }
+    snprintf(reply, sizeof(reply), "ok hidden=%d\n", app->is_hidden);
+  } else if (strcmp(cmd, "hide") == 0) {
+    menu_hide(app);
+    cancel_hide_pending(app);
+    if (hide_dock(app)) {
+      nizam_dock_damage_all(app);
+      schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
+    }
+    snprintf(reply, sizeof(reply), "ok hidden=%d\n", app->is_hidden);
+  } else if (strcmp(cmd, "stats") == 0) {
+    ipc_format_stats(app, cfg, reply, sizeof(reply));
+  } else {
+    snprintf(reply, sizeof(reply), "error unknown command\n");
+  }
+  ipc_write_all(fd, reply);
+}
+
+static void ipc_client_close(struct nizam_dock_ipc_client *cl) {
+  if (cl->fd >= 0) {
+    close(cl->fd);
+  }
+  cl->fd = -1;
+  cl->len = 0;
+  cl->deadline_ms = 0;
+}
+
+static int ipc_client_read(struct nizam_dock_app *app, const struct nizam_dock_config *cfg,
+                           struct nizam_dock_ipc_client *cl) {
+  while (cl->len < sizeof(cl->buf) - 1) {
+    ssize_t n = read(cl->fd, cl->buf + cl->len, sizeof(cl->buf) - 1 - cl->len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return 0;
+    }
+    if (n <= 0) {
+      break;
+    }
+    cl->len += (size_t)n;
+    if (memchr(cl->buf, '\n', cl->len)) {
+      break;
+    }
+  }
+  cl->buf[cl->len] = '\0';
+  size_t len = strcspn(cl->buf, "\r\n");
+  cl->buf[len] = '\0';
+  if (len > 0) {
+    nizam_dock_debug_log(cl->buf);
+    ipc_handle_command(app, cfg, cl->fd, cl->buf);
+  }
+  return 1;
+}
+
+static void handle_ipc(struct nizam_dock_app *app, const struct nizam_dock_config *cfg) {
+  for (;;) {
+    int cfd = accept(app->ipc_fd, NULL, NULL);
+    if (cfd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    fcntl(cfd, F_SETFD, FD_CLOEXEC);
+    fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK);
+
+    struct nizam_dock_ipc_client *cl = NULL;
+    for (int i = 0; i < NIZAM_DOCK_IPC_CLIENTS; ++i) {
+      if (app->ipc_clients[i].fd < 0) {
+        cl = &app->ipc_clients[i];
+        break;
+      }
+    }
+    if (!cl) {
+      close(cfd);
+      continue;
+    }
+    cl->fd = cfd;
+    cl->len = 0;
+    cl->deadline_ms = now_ms() + NIZAM_DOCK_IPC_TIMEOUT_MS;
+    if (ipc_client_read(app, cfg, cl)) {
+      ipc_client_close(cl);
+    }
+  }
+}
+
 static int hit_test_launcher(const struct nizam_dock_app *app, int x, int y) {
   if (!app || !app->launcher_rects || app->launcher_rect_count == 0) {
     return -1;
@@ -1356,7 +1724,7 @@ static int hit_test_tray(const struct nizam_dock_app *app, const struct nizam_do
   return idx;
 }
 
-static void tray_icon_root_anchor(const struct nizam_dock_app *app,
+static void tray_icon_root_anchor(struct nizam_dock_app *app,
                                   int tray_idx,
                                   int event_x,
                                   int event_y,
@@ -1391,6 +1759,7 @@ static void tray_icon_root_anchor(const struct nizam_dock_app *app,
       xcb_translate_coordinates(app->conn, app->window, app->screen->root, 0, 0);
     xcb_translate_coordinates_reply_t *tr =
       xcb_translate_coordinates_reply(app->conn, tc, NULL);
+    app->roundtrips_total++;
     if (tr) {
       dock_root_x = tr->dst_x;
       dock_root_y = tr->dst_y;
@@ -1413,17 +1782,6 @@ static void tray_icon_root_anchor(const struct nizam_dock_app *app,
   }
 }
 
-static void launch_cmd(const char *cmd) {
-  if (!cmd || !*cmd) {
-    return;
-  }
-  pid_t pid = fork();
-  if (pid == 0) {
-    execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
-    _exit(127);
-  }
-}
-
 static int xembed_ensure_capacity(struct nizam_dock_app *app) {
   if (app->xembed_count < app->xembed_cap) {
     return 1;
@@ -1691,7 +2049,7 @@ static int compute_content_width(const struct nizam_dock_app *app, const struct
   int info_w = (int)(info_len * 7) + 8;
 
   size_t tray_count = nizam_dock_sni_count(app) + app->xembed_count;
-  int tray_size = 24;
+  int tray_size = NIZAM_DOCK_TRAY_ICON_SIZE;
   int tray_spacing = 3;
   int tray_w = 0;
   if (tray_count > 0) {
@@ -1770,7 +2128,13 @@ static void set_window_hints(struct nizam_dock_app *app) {
 
 int nizam_dock_xcb_init(struct nizam_dock_app *app, const struct nizam_dock_config *cfg) {
   memset(app, 0, sizeof(*app));
+  app->ipc_fd = -1;
+  for (int i = 0; i < NIZAM_DOCK_IPC_CLIENTS; ++i) {
+    app->ipc_clients[i].fd = -1;
+  }
   nizam_dock_debug_log("xcb init start");
+  app->text_cache = nizam_dock_text_cache_new(NIZAM_DOCK_TEXT_CACHE_CAP);
+  app->prefetch = nizam_dock_prefetch_new();
 
   
   
@@ -1810,6 +2174,7 @@ int nizam_dock_xcb_init(struct nizam_dock_app *app, const struct nizam_dock_conf
     1,
     XCB_EVENT_MASK_ENTER_WINDOW |
       XCB_EVENT_MASK_LEAVE_WINDOW |
+      XCB_EVENT_MASK_POINTER_MOTION |
       XCB_EVENT_MASK_EXPOSURE |
       XCB_EVENT_MASK_FOCUS_CHANGE |
       XCB_EVENT_MASK_BUTTON_PRESS |
@@ -1970,8 +2335,16 @@ int nizam_dock_xcb_init(struct nizam_dock_app *app, const struct nizam_dock_conf
   nizam_dock_xcb_update_root_pixmap(app);
   xembed_update_background(app);
 
+  {
+    const xcb_query_extension_reply_t *randr = xcb_get_extension_data(app->conn, &xcb_randr_id);
+    if (randr && randr->present) {
+      app->randr_event_base = randr->first_event;
+    }
+  }
   xcb_randr_select_input(app->conn, app->screen->root,
-                         XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE);
+                         XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE |
+                         XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE |
+                         XCB_RANDR_NOTIFY_MASK_OUTPUT_CHANGE);
 
   if (app->strip != XCB_NONE) {
     xcb_map_window(app->conn, app->strip);
@@ -2006,12 +2379,20 @@ void nizam_dock_xcb_cleanup(struct nizam_dock_app *app) {
   if (!app || !app->conn) {
     return;
   }
+  for (int i = 0; i < NIZAM_DOCK_IPC_CLIENTS; ++i) {
+    ipc_client_close(&app->ipc_clients[i]);
+  }
+  nizam_dock_layers_free(app);
   destroy_buffer(app);
   if (app->menu_window != XCB_NONE) {
     xcb_destroy_window(app->conn, app->menu_window);
     app->menu_window = XCB_NONE;
   }
   menu_free(app);
+  nizam_dock_text_cache_free(app->text_cache);
+  app->text_cache = NULL;
+  nizam_dock_prefetch_free(app->prefetch);
+  app->prefetch = NULL;
   if (app->xembed_window != XCB_NONE) {
     xcb_destroy_window(app->conn, app->xembed_window);
     app->xembed_window = XCB_NONE;
@@ -2026,6 +2407,7 @@ void nizam_dock_xcb_cleanup(struct nizam_dock_app *app) {
   free(app->launcher_rects);
   app->launcher_rects = NULL;
   app->launcher_rect_count = 0;
+  nizam_monitors_free(&app->monitors);
   xcb_destroy_window(app->conn, app->window);
   xcb_disconnect(app->conn);
   app->conn = NULL;
@@ -2074,10 +2456,17 @@ int nizam_dock_xcb_update_root_pixmap(struct nizam_dock_app *app) {
 }
 
 static void handle_screen_change(struct nizam_dock_app *app, const struct nizam_dock_config *cfg) {
+  slide_cancel(app);
   int old_w = app->panel_w;
   int old_h = app->panel_h;
+  int old_x = app->x_visible;
+  int old_y = app->panel_y;
   dock_pick_monitor_for_pointer(app);
   nizam_dock_xcb_recalc_geometry(app, cfg);
+  if (app->panel_w != old_w || app->panel_h != old_h ||
+      app->x_visible != old_x || app->panel_y != old_y) {
+    nizam_dock_layers_invalidate(app);
+  }
   uint32_t values[4] = {
     (uint32_t)app->panel_x,
     (uint32_t)app->panel_y,
@@ -2123,15 +2512,16 @@ void nizam_dock_xcb_apply_geometry(struct nizam_dock_app *app, const struct niza
   handle_screen_change(app, cfg);
 }
 
-static void maybe_draw(struct nizam_dock_app *app, const struct nizam_dock_config *cfg, int force) {
+static int maybe_draw(struct nizam_dock_app *app, const struct nizam_dock_config *cfg, int force) {
   int64_t now = now_ms();
   if (!force) {
     if (app->last_draw_ms != 0 && now - app->last_draw_ms < 50) {
-      return;
+      return 0;
     }
   }
   nizam_dock_draw(app, cfg);
   app->last_draw_ms = now;
+  return 1;
 }
 
 int nizam_dock_xcb_event_loop(struct nizam_dock_app *app, struct nizam_dock_config *cfg) {
@@ -2148,10 +2538,7 @@ int nizam_dock_xcb_event_loop(struct nizam_dock_app *app, struct nizam_dock_conf
     nizam_dock_log_event_stats(app);
     if (g_reload_config) {
       g_reload_config = 0;
-      nizam_dock_config_free(cfg);
-      nizam_dock_config_init_defaults(cfg);
-
-      (void)nizam_dock_config_load_launchers(cfg);
+      int changed = nizam_dock_config_reload_launchers(cfg);
 
       if (!cfg->enabled) {
         if (nizam_dock_debug_enabled()) {
@@ -2160,22 +2547,33 @@ int nizam_dock_xcb_event_loop(struct nizam_dock_app *app, struct nizam_dock_conf
         running = 0;
         break;
       }
-      nizam_dock_icons_free(app);
-      nizam_dock_icons_init(app, cfg);
-      handle_screen_change(app, cfg);
-      schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
+      if (changed > 0) {
+        nizam_dock_icons_retain(app, cfg);
+        handle_screen_change(app, cfg);
+        nizam_dock_layers_invalidate(app);
+        schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
+      }
     }
 
     int sni_fd = nizam_dock_sni_get_fd(app);
     int sni_enabled = app->sni != NULL;
     int sni_pollable = sni_fd >= 0;
     int sni_index = -1;
-    struct pollfd fds[2];
+    int ipc_index = -1;
+    int ipc_client_index[NIZAM_DOCK_IPC_CLIENTS];
+    struct pollfd fds[3 + NIZAM_DOCK_IPC_CLIENTS];
     int nfds = 0;
     fds[nfds].fd = xcb_fd;
     fds[nfds].events = POLLIN;
     fds[nfds].revents = 0;
     nfds++;
+    if (app->ipc_fd >= 0) {
+      ipc_index = nfds;
+      fds[nfds].fd = app->ipc_fd;
+      fds[nfds].events = POLLIN;
+      fds[nfds].revents = 0;
+      nfds++;
+    }
     if (sni_pollable) {
       sni_index = nfds;
       fds[nfds].fd = sni_fd;
@@ -2183,20 +2581,78 @@ int nizam_dock_xcb_event_loop(struct nizam_dock_app *app, struct nizam_dock_conf
       fds[nfds].revents = 0;
       nfds++;
     }
+    for (int i = 0; i < NIZAM_DOCK_IPC_CLIENTS; ++i) {
+      ipc_client_index[i] = -1;
+      if (app->ipc_clients[i].fd < 0) {
+        continue;
+      }
+      ipc_client_index[i] = nfds;
+      fds[nfds].fd = app->ipc_clients[i].fd;
+      fds[nfds].events = POLLIN;
+      fds[nfds].revents = 0;
+      nfds++;
+    }
 
     int64_t now = now_ms();
     if (app->suppress_raise_until_ms && now >= app->suppress_raise_until_ms) {
       app->suppress_raise_until_ms = 0;
       if (!app->is_hidden && !app->menu_visible) {
         set_dock_stack(app, 1);
+        nizam_dock_damage_all(app);
         schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
       }
     }
 
-    int timeout = app->redraw_pending ? 0 : -1;
+    slide_step(app);
+
+    if (app->prefetch_due_ms && now >= app->prefetch_due_ms) {
+      app->prefetch_due_ms = 0;
+      int idx = app->hovered_launcher_idx;
+      if (app->pointer_inside && idx >= 0 && (size_t)idx < cfg->launcher_count) {
+        nizam_dock_prefetch_request(app->prefetch, cfg->launchers[idx].cmd);
+      }
+    }
+
+    int timeout = -1;
+    if (app->anim_active) {
+      int64_t ms_left = app->anim_next_frame_ms - now_ms();
+      if (ms_left < 0) ms_left = 0;
+      timeout = (int)ms_left;
+    }
+    if (app->redraw_pending) {
+      int64_t ms_left = 0;
+      if (!app->redraw_force && app->last_draw_ms != 0) {
+        ms_left = app->last_draw_ms + 50 - now;
+        if (ms_left < 0) ms_left = 0;
+      }
+      if (timeout < 0 || ms_left < timeout) {
+        timeout = (int)ms_left;
+      }
+    }
     if (!sni_pollable && sni_enabled && timeout < 0) {
       timeout = 1000;
     }
+    int sni_timeout = nizam_dock_sni_timeout_ms(app);
+    if (sni_timeout >= 0 && (timeout < 0 || sni_timeout < timeout)) {
+      timeout = sni_timeout;
+    }
+    for (int i = 0; i < NIZAM_DOCK_IPC_CLIENTS; ++i) {
+      if (app->ipc_clients[i].fd < 0) {
+        continue;
+      }
+      int64_t ms_left = app->ipc_clients[i].deadline_ms - now;
+      if (ms_left < 0) ms_left = 0;
+      if (timeout < 0 || ms_left < timeout) {
+        timeout = (int)ms_left;
+      }
+    }
+    if (app->prefetch_due_ms) {
+      int64_t ms_left = app->prefetch_due_ms - now;
+      if (ms_left < 0) ms_left = 0;
+      if (timeout < 0 || ms_left < timeout) {
+        timeout = (int)ms_left;
+      }
+    }
 
     
     if (app->hide_pending && app->hide_deadline_ms > 0) {
@@ -2222,23 +2678,44 @@ int nizam_dock_xcb_event_loop(struct nizam_dock_app *app, struct nizam_dock_conf
       }
     }
     int pr = poll(fds, nfds, timeout);
+    nizam_launch_reap();
     if (pr < 0) {
       if (errno == EINTR) {
         continue;
       }
       break;
     }
-    if (sni_pollable && sni_index >= 0 && (fds[sni_index].revents & POLLIN)) {
-      if (nizam_dock_sni_process(app)) {
-        handle_screen_change(app, cfg);
-        schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
+    int64_t ipc_now = now_ms();
+    for (int i = 0; i < NIZAM_DOCK_IPC_CLIENTS; ++i) {
+      struct nizam_dock_ipc_client *cl = &app->ipc_clients[i];
+      if (cl->fd < 0) {
+        continue;
       }
+      int idx = ipc_client_index[i];
+      if (idx >= 0 && (fds[idx].revents & (POLLIN | POLLHUP | POLLERR)) &&
+          ipc_client_read(app, cfg, cl)) {
+        ipc_client_close(cl);
+      } else if (ipc_now >= cl->deadline_ms) {
+        ipc_client_close(cl);
+      }
+    }
+    if (ipc_index >= 0 && (fds[ipc_index].revents & POLLIN)) {
+      handle_ipc(app, cfg);
     }
-    if (!sni_pollable && sni_enabled) {
+    int sni_due = !sni_pollable && sni_enabled;
+    if (sni_pollable && sni_index >= 0 && (fds[sni_index].revents & POLLIN)) {
+      sni_due = 1;
+    }
+    if (sni_timeout >= 0 && nizam_dock_sni_timeout_ms(app) == 0) {
+      sni_due = 1;
+    }
+    if (sni_due) {
       if (nizam_dock_sni_process(app)) {
         handle_screen_change(app, cfg);
+        nizam_dock_damage_tray(app);
         schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
       }
+      handle_sni_menu(app, cfg);
     }
 
     xcb_generic_event_t *event = NULL;
@@ -2270,7 +2747,7 @@ int nizam_dock_xcb_event_loop(struct nizam_dock_app *app, struct nizam_dock_conf
       int64_t nowh = now_ms();
       if (!app->is_hidden && !app->menu_visible &&
           (!app->suppress_hide_until_ms || nowh >= app->suppress_hide_until_ms)) {
-        if (pointer_inside_window(app)) {
+        if (app->pointer_inside) {
           cancel_hide_pending(app);
         } else if (!app->hide_pending) {
           schedule_hide(app, cfg);
@@ -2281,16 +2758,17 @@ int nizam_dock_xcb_event_loop(struct nizam_dock_app *app, struct nizam_dock_conf
         app->hide_pending = 0;
         app->hide_deadline_ms = 0;
         if (hide_dock(app)) {
+          nizam_dock_damage_all(app);
           schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
         }
       }
     }
     if (app->menu_dirty) {
       app->menu_dirty = 0;
+      nizam_dock_damage_all(app);
       schedule_redraw(app, 1, REDRAW_REASON_TIMEOUT);
     }
-    if (app->redraw_pending) {
-      maybe_draw(app, cfg, app->redraw_force);
+    if (app->redraw_pending && maybe_draw(app, cfg, app->redraw_force)) {
       app->redraw_pending = 0;
       app->redraw_force = 0;
     }
@@ -66,6 +66,13 @@ int main(void) {
   assert(stats.size == 2);
   assert(stats.evictions >= 1);
 
+  cairo_surface_t *s3 = nizam_dock_icon_cache_get(cache, p3);
+  const char *keep[] = {p3, "nizam-missing-icon"};
+  nizam_dock_icon_cache_retain(cache, keep, 2);
+  nizam_dock_icon_cache_get_stats(cache, &stats);
+  assert(stats.size == 1);
+  assert(nizam_dock_icon_cache_get(cache, p3) == s3);
+
   nizam_dock_icon_cache_free(cache);
   unlink(p1);
   unlink(p2);
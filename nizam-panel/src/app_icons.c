@@ -0,0 +1,255 @@
+#include "panel_shared.h"
+
+#include <dirent.h>
+#include <stdint.h>
+#include <sys/inotify.h>
+
+#define APP_ICONS_MAX_DIRS 8
+#define APP_ICONS_CAP 8192
+#define APP_ICONS_RECHECK_MS 5000
+
+enum {
+    APP_KEY_STARTUP_CLASS = 0,
+    APP_KEY_BASENAME = 1,
+};
+
+typedef struct {
+    char *icon;
+    int rank;
+} AppIconValue;
+
+typedef struct {
+    char *path;
+    time_t mtime;
+} AppDirStamp;
+
+static GHashTable *class_icons = NULL;
+static AppDirStamp app_dirs[APP_ICONS_MAX_DIRS];
+static int app_dir_count = 0;
+static int built = 0;
+static int stale = 0;
+static int watch_fd = -1;
+static int watch_partial = 0;
+static int64_t last_recheck_ms = 0;
+
+static int64_t app_icons_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + (int64_t)(ts.tv_nsec / 1000000);
+}
+
+static void app_icon_value_free(gpointer data) {
+    AppIconValue *v = data;
+    if (!v) return;
+    free(v->icon);
+    free(v);
+}
+
+static void lower_copy(char *dst, size_t dst_sz, const char *src, size_t len) {
+    if (len >= dst_sz) len = dst_sz - 1;
+    for (size_t i = 0; i < len; i++) dst[i] = (char)tolower((unsigned char)src[i]);
+    dst[len] = '\0';
+}
+
+static void map_put(const char *key, size_t key_len, const char *icon, int rank) {
+    char lower[256];
+    if (key_len == 0 || !icon || !icon[0]) return;
+    lower_copy(lower, sizeof(lower), key, key_len);
+
+    AppIconValue *cur = g_hash_table_lookup(class_icons, lower);
+    if (cur) {
+        if (cur->rank <= rank) return;
+        char *dup = strdup(icon);
+        if (!dup) return;
+        free(cur->icon);
+        cur->icon = dup;
+        cur->rank = rank;
+        return;
+    }
+    if (g_hash_table_size(class_icons) >= APP_ICONS_CAP) return;
+
+    AppIconValue *v = calloc(1, sizeof(*v));
+    if (!v) return;
+    v->icon = strdup(icon);
+    v->rank = rank;
+    if (!v->icon) {
+        free(v);
+        return;
+    }
+    g_hash_table_insert(class_icons, g_strdup(lower), v);
+}
+
+static char *trim_value(char *s) {
+    while (*s == ' ' || *s == '\t') s++;
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+    *end = '\0';
+    return s;
+}
+
+static int read_desktop_entry(const char *path, char *icon, size_t icon_len, char *wm_class, size_t wm_class_len) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    char line[512];
+    int in_entry = 0;
+    icon[0] = '\0';
+    wm_class[0] = '\0';
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '[') {
+            if (in_entry) break;
+            in_entry = (strncmp(line, "[Desktop Entry]", 15) == 0);
+            continue;
+        }
+        if (!in_entry) continue;
+        if (strncmp(line, "Icon=", 5) == 0) {
+            snprintf(icon, icon_len, "%s", trim_value(line + 5));
+        } else if (strncmp(line, "StartupWMClass=", 15) == 0) {
+            snprintf(wm_class, wm_class_len, "%s", trim_value(line + 15));
+        }
+    }
+    fclose(f);
+    return icon[0] != '\0';
+}
+
+static void scan_applications_dir(const char *dir, int dir_rank) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+
+    struct stat st;
+    if (app_dir_count < APP_ICONS_MAX_DIRS && stat(dir, &st) == 0) {
+        app_dirs[app_dir_count].path = strdup(dir);
+        app_dirs[app_dir_count].mtime = st.st_mtime;
+        if (app_dirs[app_dir_count].path) app_dir_count++;
+    }
+    if (watch_fd >= 0 &&
+        inotify_add_watch(watch_fd, dir, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE) < 0) {
+        watch_partial = 1;
+    }
+
+    struct dirent *de;
+    char path[1280];
+    char icon[256];
+    char wm_class[256];
+    while ((de = readdir(d)) != NULL) {
+        size_t n = strlen(de->d_name);
+        if (de->d_name[0] == '.' || n <= 8 || strcmp(de->d_name + n - 8, ".desktop") != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+        if (!read_desktop_entry(path, icon, sizeof(icon), wm_class, sizeof(wm_class))) continue;
+        if (wm_class[0]) map_put(wm_class, strlen(wm_class), icon, dir_rank * 2 + APP_KEY_STARTUP_CLASS);
+        map_put(de->d_name, n - 8, icon, dir_rank * 2 + APP_KEY_BASENAME);
+    }
+    closedir(d);
+}
+
+static void app_icons_reset(void) {
+    if (class_icons) {
+        g_hash_table_destroy(class_icons);
+        class_icons = NULL;
+    }
+    for (int i = 0; i < app_dir_count; i++) free(app_dirs[i].path);
+    app_dir_count = 0;
+    if (watch_fd >= 0) {
+        close(watch_fd);
+        watch_fd = -1;
+    }
+    watch_partial = 0;
+    built = 0;
+    stale = 0;
+}
+
+static void app_icons_build(void) {
+    app_icons_reset();
+    class_icons = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, app_icon_value_free);
+    if (!class_icons) return;
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    char dir[1100];
+    int rank = 0;
+    const char *data_home = getenv("XDG_DATA_HOME");
+    const char *home = getenv("HOME");
+    if (data_home && *data_home) {
+        snprintf(dir, sizeof(dir), "%s/applications", data_home);
+        scan_applications_dir(dir, rank++);
+    } else if (home && *home) {
+        snprintf(dir, sizeof(dir), "%s/.local/share/applications", home);
+        scan_applications_dir(dir, rank++);
+    }
+    if (home && *home) {
+        snprintf(dir, sizeof(dir), "%s/.local/share/flatpak/exports/share/applications", home);
+        scan_applications_dir(dir, rank++);
+    }
+    scan_applications_dir("/var/lib/flatpak/exports/share/applications", rank++);
+    scan_applications_dir("/usr/local/share/applications", rank++);
+    scan_applications_dir("/usr/share/applications", rank++);
+
+    built = 1;
+    last_recheck_ms = app_icons_now_ms();
+    debug_log("nizam-panel: class icon map built entries=%u dirs=%d\n",
+              g_hash_table_size(class_icons), app_dir_count);
+}
+
+static int app_dirs_changed(void) {
+    for (int i = 0; i < app_dir_count; i++) {
+        struct stat st;
+        if (stat(app_dirs[i].path, &st) != 0) return 1;
+        if (st.st_mtime != app_dirs[i].mtime) return 1;
+    }
+    return 0;
+}
+
+static void app_icons_ensure(void) {
+    if (built && !stale && (watch_fd < 0 || watch_partial)) {
+        int64_t now = app_icons_now_ms();
+        if (now - last_recheck_ms >= APP_ICONS_RECHECK_MS) {
+            last_recheck_ms = now;
+            if (app_dirs_changed()) stale = 1;
+        }
+    }
+    if (!built || stale) app_icons_build();
+}
+
+int find_desktop_icon_for_class(const char *instance, const char *klass, char *out, size_t out_len) {
+    if (!out || out_len == 0) return 0;
+    app_icons_ensure();
+    if (!class_icons) return 0;
+
+    const char *keys[2] = {instance, klass};
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+        if (!keys[i] || !keys[i][0]) continue;
+        char lower[256];
+        lower_copy(lower, sizeof(lower), keys[i], strlen(keys[i]));
+        AppIconValue *v = g_hash_table_lookup(class_icons, lower);
+        if (!v) continue;
+        snprintf(out, out_len, "%s", v->icon);
+        return 1;
+    }
+    return 0;
+}
+
+int app_icons_watch_fd(void) {
+    return watch_fd;
+}
+
+int app_icons_handle_watch(void) {
+    if (watch_fd < 0) return 0;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    for (;;) {
+        ssize_t n = read(watch_fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        changed = 1;
+    }
+    if (changed && !stale) {
+        stale = 1;
+        debug_log("nizam-panel: class icon map invalidated\n");
+    }
+    return changed;
+}
+
+int app_icons_entry_count(void) {
+    return class_icons ? (int)g_hash_table_size(class_icons) : 0;
+}
+
+void app_icons_cleanup(void) {
+    app_icons_reset();
+}
@@ -0,0 +1,698 @@
+#include "panel_shared.h"
+
+#include <dirent.h>
+#include <stdint.h>
+#include <sys/inotify.h>
+
+#define ICON_THEME_MAX_THEMES 16
+#define ICON_THEME_MAX_ROOTS 12
+#define ICON_THEME_DIR_CAP 1024
+#define ICON_THEME_NAME_CAP 32768
+#define ICON_THEME_FILE_CAP 65536
+#define ICON_THEME_WATCH_CAP 1024
+#define ICON_THEME_STAMP_CAP 128
+#define ICON_THEME_RECHECK_MS 5000
+
+typedef enum {
+    ICON_DIR_FIXED = 0,
+    ICON_DIR_SCALABLE = 1,
+    ICON_DIR_THRESHOLD = 2,
+    ICON_DIR_FALLBACK = 3,
+} IconDirType;
+
+typedef enum {
+    ICON_EXT_PNG = 0,
+    ICON_EXT_XPM = 1,
+    ICON_EXT_SVG = 2,
+} IconExt;
+
+typedef struct {
+    char *path;
+    int theme;
+    int type;
+    int size;
+    int min_size;
+    int max_size;
+    int threshold;
+} IconDir;
+
+typedef struct {
+    int dir;
+    int ext;
+    int next;
+} IconFile;
+
+typedef struct {
+    char *name;
+    int type;
+    int size;
+    int min_size;
+    int max_size;
+    int threshold;
+    int scale;
+} ThemeDirSpec;
+
+typedef struct {
+    char *path;
+    time_t mtime;
+} IconStamp;
+
+static const char *icon_ext_str[] = {".png", ".xpm", ".svg"};
+
+static IconDir *dirs = NULL;
+static int dir_count = 0;
+static IconFile *files = NULL;
+static int file_count = 0;
+static int file_alloc = 0;
+static int *name_heads = NULL;
+static int *name_tails = NULL;
+static int name_count = 0;
+static int name_alloc = 0;
+static GHashTable *names = NULL;
+
+static char *themes[ICON_THEME_MAX_THEMES];
+static int theme_count = 0;
+static char *roots[ICON_THEME_MAX_ROOTS];
+static int root_count = 0;
+
+static IconStamp stamps[ICON_THEME_STAMP_CAP];
+static int stamp_count = 0;
+
+static int built = 0;
+static int stale = 0;
+static int watch_fd = -1;
+static int watch_count = 0;
+static int watch_partial = 0;
+static int64_t last_recheck_ms = 0;
+static unsigned long build_count = 0;
+
+static int64_t icon_theme_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + (int64_t)(ts.tv_nsec / 1000000);
+}
+
+static int is_dir(const char *path) {
+    struct stat st;
+    if (!path || path[0] == '\0') return 0;
+    if (stat(path, &st) != 0) return 0;
+    return S_ISDIR(st.st_mode);
+}
+
+static void path_parent_inplace(char *path) {
+    if (!path) return;
+    size_t n = strlen(path);
+    if (n == 0) return;
+
+    while (n > 1 && path[n - 1] == '/') {
+        path[n - 1] = '\0';
+        n--;
+    }
+    char *slash = strrchr(path, '/');
+    if (!slash) {
+        path[0] = '\0';
+        return;
+    }
+    if (slash == path) {
+        path[1] = '\0';
+        return;
+    }
+    *slash = '\0';
+}
+
+static void add_root(const char *path) {
+    if (!path || !path[0] || root_count >= ICON_THEME_MAX_ROOTS) return;
+    if (!is_dir(path)) return;
+    for (int i = 0; i < root_count; i++) {
+        if (strcmp(roots[i], path) == 0) return;
+    }
+    char *dup = strdup(path);
+    if (dup) roots[root_count++] = dup;
+}
+
+static void collect_roots(void) {
+    char path[1100];
+
+    const char *common_dir = getenv("NIZAM_COMMON_DIR");
+    if (common_dir && *common_dir) {
+        snprintf(path, sizeof(path), "%s/icons", common_dir);
+        add_root(path);
+    }
+
+    char exe_path[1024];
+    ssize_t n = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+    if (n > 0) {
+        exe_path[n] = '\0';
+        path_parent_inplace(exe_path);
+        for (int up = 0; up < 8 && exe_path[0]; up++) {
+            snprintf(path, sizeof(path), "%s/nizam-common/icons", exe_path);
+            if (is_dir(path)) {
+                add_root(path);
+                break;
+            }
+            path_parent_inplace(exe_path);
+        }
+    }
+
+    char cwd[1024];
+    if (getcwd(cwd, sizeof(cwd))) {
+        snprintf(path, sizeof(path), "%s/nizam-common/icons", cwd);
+        add_root(path);
+    }
+
+    const char *home = getenv("HOME");
+    if (home && *home) {
+        snprintf(path, sizeof(path), "%s/.local/share/icons", home);
+        add_root(path);
+        snprintf(path, sizeof(path), "%s/.icons", home);
+        add_root(path);
+        snprintf(path, sizeof(path), "%s/.local/share/flatpak/exports/share/icons", home);
+        add_root(path);
+    }
+    add_root("/var/lib/flatpak/exports/share/icons");
+    add_root("/usr/local/share/icons");
+    add_root("/usr/share/icons");
+}
+
+static void add_theme(const char *name, size_t len) {
+    while (len > 0 && (*name == ' ' || *name == '\t')) {
+        name++;
+        len--;
+    }
+    while (len > 0 && (name[len - 1] == ' ' || name[len - 1] == '\t')) len--;
+    if (len == 0 || theme_count >= ICON_THEME_MAX_THEMES) return;
+    for (int i = 0; i < theme_count; i++) {
+        if (strlen(themes[i]) == len && strncmp(themes[i], name, len) == 0) return;
+    }
+    char *dup = strndup(name, len);
+    if (dup) themes[theme_count++] = dup;
+}
+
+static void add_stamp(const char *path) {
+    if (stamp_count >= ICON_THEME_STAMP_CAP) return;
+    struct stat st;
+    if (stat(path, &st) != 0) return;
+    char *dup = strdup(path);
+    if (!dup) return;
+    stamps[stamp_count].path = dup;
+    stamps[stamp_count].mtime = st.st_mtime;
+    stamp_count++;
+}
+
+static void add_watch(const char *path) {
+    if (watch_fd < 0) return;
+    if (watch_count >= ICON_THEME_WATCH_CAP) {
+        watch_partial = 1;
+        return;
+    }
+    uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF;
+    if (inotify_add_watch(watch_fd, path, mask) >= 0) watch_count++;
+    else watch_partial = 1;
+}
+
+static int add_name(const char *name, size_t len) {
+    gpointer val = NULL;
+    char key[256];
+    if (len >= sizeof(key)) return -1;
+    memcpy(key, name, len);
+    key[len] = '\0';
+    if (g_hash_table_lookup_extended(names, key, NULL, &val)) return GPOINTER_TO_INT(val) - 1;
+    if (name_count >= ICON_THEME_NAME_CAP) return -1;
+    if (name_count == name_alloc) {
+        int next = name_alloc ? name_alloc * 2 : 1024;
+        int *grown = realloc(name_heads, (size_t)next * sizeof(*grown));
+        if (!grown) return -1;
+        name_heads = grown;
+        grown = realloc(name_tails, (size_t)next * sizeof(*grown));
+        if (!grown) return -1;
+        name_tails = grown;
+        name_alloc = next;
+    }
+    char *dup = g_strdup(key);
+    int id = name_count++;
+    name_heads[id] = -1;
+    name_tails[id] = -1;
+    g_hash_table_insert(names, dup, GINT_TO_POINTER(id + 1));
+    return id;
+}
+
+static void add_file(int dir, const char *name, size_t len, int ext) {
+    if (file_count >= ICON_THEME_FILE_CAP) return;
+    int id = add_name(name, len);
+    if (id < 0) return;
+    if (file_count == file_alloc) {
+        int next = file_alloc ? file_alloc * 2 : 4096;
+        IconFile *grown = realloc(files, (size_t)next * sizeof(*grown));
+        if (!grown) return;
+        files = grown;
+        file_alloc = next;
+    }
+    IconFile *f = &files[file_count];
+    f->dir = dir;
+    f->ext = ext;
+    f->next = -1;
+    if (name_tails[id] >= 0) files[name_tails[id]].next = file_count;
+    else name_heads[id] = file_count;
+    name_tails[id] = file_count;
+    file_count++;
+}
+
+static int icon_ext_of(const char *name, size_t *stem_len) {
+    size_t n = strlen(name);
+    if (n <= 4 || name[n - 4] != '.') return -1;
+    for (int e = 0; e < (int)(sizeof(icon_ext_str) / sizeof(icon_ext_str[0])); e++) {
+#ifndef NIZAM_HAVE_LIBRSVG
+        if (e == ICON_EXT_SVG) continue;
+#endif
+        if (strcmp(name + n - 4, icon_ext_str[e]) == 0) {
+            *stem_len = n - 4;
+            return e;
+        }
+    }
+    return -1;
+}
+
+static void scan_icon_dir(const char *path, int theme, const ThemeDirSpec *spec) {
+    if (dir_count >= ICON_THEME_DIR_CAP) return;
+    DIR *d = opendir(path);
+    if (!d) return;
+
+    char *dup = strdup(path);
+    if (!dup) {
+        closedir(d);
+        return;
+    }
+    int idx = dir_count++;
+    IconDir *dir = &dirs[idx];
+    dir->path = dup;
+    dir->theme = theme;
+    dir->type = spec->type;
+    dir->size = spec->size;
+    dir->min_size = spec->min_size;
+    dir->max_size = spec->max_size;
+    dir->threshold = spec->threshold;
+    add_watch(path);
+
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] == '.') continue;
+        size_t stem = 0;
+        int ext = icon_ext_of(de->d_name, &stem);
+        if (ext < 0) continue;
+        add_file(idx, de->d_name, stem, ext);
+    }
+    closedir(d);
+}
+
+static void spec_defaults(ThemeDirSpec *s) {
+    s->type = ICON_DIR_THRESHOLD;
+    s->size = 0;
+    s->min_size = -1;
+    s->max_size = -1;
+    s->threshold = 2;
+    s->scale = 1;
+}
+
+static void spec_finish(ThemeDirSpec *s) {
+    if (s->min_size < 0) s->min_size = s->size;
+    if (s->max_size < 0) s->max_size = s->size;
+}
+
+static void free_specs(ThemeDirSpec *specs, int n) {
+    for (int i = 0; i < n; i++) free(specs[i].name);
+    free(specs);
+}
+
+static char *trim_line(char *s) {
+    while (*s == ' ' || *s == '\t') s++;
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+    *end = '\0';
+    return s;
+}
+
+static int list_contains(const char *list, const char *item) {
+    if (!list) return 1;
+    size_t n = strlen(item);
+    const char *p = list;
+    while (*p) {
+        const char *comma = strchr(p, ',');
+        size_t len = comma ? (size_t)(comma - p) : strlen(p);
+        if (len == n && strncmp(p, item, n) == 0) return 1;
+        if (!comma) break;
+        p = comma + 1;
+    }
+    return 0;
+}
+
+static int parse_index_theme(const char *path, char **inherits, ThemeDirSpec **out, int *out_n) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+
+    ThemeDirSpec *specs = NULL;
+    int n = 0;
+    int alloc = 0;
+    char *directories = NULL;
+    ThemeDirSpec *cur = NULL;
+    int in_theme = 0;
+    char *line = NULL;
+    size_t line_sz = 0;
+
+    while (getline(&line, &line_sz, f) >= 0) {
+        char *s = trim_line(line);
+        if (s[0] == '#' || s[0] == '\0') continue;
+        if (s[0] == '[') {
+            char *close = strchr(s, ']');
+            if (!close) continue;
+            *close = '\0';
+            cur = NULL;
+            in_theme = (strcmp(s + 1, "Icon Theme") == 0);
+            if (in_theme || n >= ICON_THEME_DIR_CAP) continue;
+            if (n == alloc) {
+                int next = alloc ? alloc * 2 : 64;
+                ThemeDirSpec *grown = realloc(specs, (size_t)next * sizeof(*grown));
+                if (!grown) continue;
+                specs = grown;
+                alloc = next;
+            }
+            cur = &specs[n];
+            spec_defaults(cur);
+            cur->name = strdup(s + 1);
+            if (!cur->name) {
+                cur = NULL;
+                continue;
+            }
+            n++;
+            continue;
+        }
+        char *eq = strchr(s, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        char *key = trim_line(s);
+        char *val = trim_line(eq + 1);
+        if (in_theme) {
+            if (strcmp(key, "Inherits") == 0 && inherits && !*inherits) {
+                *inherits = strdup(val);
+            } else if (strcmp(key, "Directories") == 0 && !directories) {
+                directories = strdup(val);
+            }
+            continue;
+        }
+        if (!cur) continue;
+        if (strcmp(key, "Size") == 0) {
+            cur->size = atoi(val);
+        } else if (strcmp(key, "MinSize") == 0) {
+            cur->min_size = atoi(val);
+        } else if (strcmp(key, "MaxSize") == 0) {
+            cur->max_size = atoi(val);
+        } else if (strcmp(key, "Threshold") == 0) {
+            cur->threshold = atoi(val);
+        } else if (strcmp(key, "Scale") == 0) {
+            cur->scale = atoi(val);
+        } else if (strcmp(key, "Type") == 0) {
+            if (strcmp(val, "Fixed") == 0) cur->type = ICON_DIR_FIXED;
+            else if (strcmp(val, "Scalable") == 0) cur->type = ICON_DIR_SCALABLE;
+            else cur->type = ICON_DIR_THRESHOLD;
+        }
+    }
+    free(line);
+    fclose(f);
+
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        if (specs[i].scale != NIZAM_PANEL_ICON_SCALE || specs[i].size <= 0 ||
+            !list_contains(directories, specs[i].name)) {
+            free(specs[i].name);
+            continue;
+        }
+        spec_finish(&specs[i]);
+        specs[kept++] = specs[i];
+    }
+    free(directories);
+    *out = specs;
+    *out_n = kept;
+    return 1;
+}
+
+static int spec_from_dirname(const char *name, ThemeDirSpec *spec) {
+    spec_defaults(spec);
+    int w = 0, h = 0;
+    if (strcmp(name, "scalable") == 0 || strcmp(name, "symbolic") == 0) {
+        spec->type = ICON_DIR_SCALABLE;
+        spec->size = 64;
+        spec->min_size = 1;
+        spec->max_size = 512;
+        return 1;
+    }
+    char tail = '\0';
+    if (sscanf(name, "%dx%d%c", &w, &h, &tail) == 2 && w > 0 && w == h) {
+        spec->type = ICON_DIR_FIXED;
+        spec->size = w;
+        spec_finish(spec);
+        return 1;
+    }
+    return 0;
+}
+
+static void walk_theme_dir(const char *theme_dir, int theme) {
+    DIR *d = opendir(theme_dir);
+    if (!d) return;
+    struct dirent *de;
+    char sub[1024];
+    char leaf[1280];
+    while ((de = readdir(d)) != NULL) {
+        ThemeDirSpec spec;
+        if (de->d_name[0] == '.') continue;
+        if (!spec_from_dirname(de->d_name, &spec)) continue;
+        snprintf(sub, sizeof(sub), "%s/%s", theme_dir, de->d_name);
+        DIR *sd = opendir(sub);
+        if (!sd) continue;
+        add_watch(sub);
+        struct dirent *se;
+        while ((se = readdir(sd)) != NULL) {
+            if (se->d_name[0] == '.') continue;
+            snprintf(leaf, sizeof(leaf), "%s/%s", sub, se->d_name);
+            if (!is_dir(leaf)) continue;
+            scan_icon_dir(leaf, theme, &spec);
+        }
+        closedir(sd);
+    }
+    closedir(d);
+}
+
+static void index_theme(int theme) {
+    char theme_dir[1024];
+    char index_path[1100];
+    char dir_path[2048];
+    for (int r = 0; r < root_count; r++) {
+        snprintf(theme_dir, sizeof(theme_dir), "%s/%s", roots[r], themes[theme]);
+        if (!is_dir(theme_dir)) continue;
+        add_stamp(theme_dir);
+        add_watch(theme_dir);
+
+        snprintf(index_path, sizeof(index_path), "%s/index.theme", theme_dir);
+        char *inherits = NULL;
+        ThemeDirSpec *specs = NULL;
+        int nspecs = 0;
+        if (!parse_index_theme(index_path, &inherits, &specs, &nspecs)) {
+            walk_theme_dir(theme_dir, theme);
+            continue;
+        }
+        for (int i = 0; i < nspecs; i++) {
+            snprintf(dir_path, sizeof(dir_path), "%s/%s", theme_dir, specs[i].name);
+            scan_icon_dir(dir_path, theme, &specs[i]);
+        }
+        free_specs(specs, nspecs);
+        if (inherits) {
+            const char *p = inherits;
+            while (*p) {
+                const char *comma = strchr(p, ',');
+                size_t len = comma ? (size_t)(comma - p) : strlen(p);
+                add_theme(p, len);
+                if (!comma) break;
+                p = comma + 1;
+            }
+            free(inherits);
+        }
+    }
+}
+
+static void icon_theme_reset(void) {
+    for (int i = 0; i < dir_count; i++) free(dirs[i].path);
+    free(dirs);
+    dirs = NULL;
+    dir_count = 0;
+    free(files);
+    files = NULL;
+    file_count = 0;
+    file_alloc = 0;
+    free(name_heads);
+    name_heads = NULL;
+    free(name_tails);
+    name_tails = NULL;
+    name_count = 0;
+    name_alloc = 0;
+    if (names) {
+        g_hash_table_destroy(names);
+        names = NULL;
+    }
+    for (int i = 0; i < theme_count; i++) free(themes[i]);
+    theme_count = 0;
+    for (int i = 0; i < root_count; i++) free(roots[i]);
+    root_count = 0;
+    for (int i = 0; i < stamp_count; i++) free(stamps[i].path);
+    stamp_count = 0;
+    if (watch_fd >= 0) {
+        close(watch_fd);
+        watch_fd = -1;
+    }
+    watch_count = 0;
+    watch_partial = 0;
+    built = 0;
+    stale = 0;
+}
+
+static void icon_theme_build(void) {
+    icon_theme_reset();
+    names = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    dirs = calloc(ICON_THEME_DIR_CAP, sizeof(*dirs));
+    if (!names || !dirs) return;
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    collect_roots();
+    for (int r = 0; r < root_count; r++) {
+        add_stamp(roots[r]);
+        add_watch(roots[r]);
+    }
+
+    const char *base[] = {"hicolor", "Adwaita", "AdwaitaLegacy"};
+    for (size_t i = 0; i < sizeof(base) / sizeof(base[0]); i++) add_theme(base[i], strlen(base[i]));
+    for (int t = 0; t < theme_count; t++) index_theme(t);
+
+    ThemeDirSpec fallback;
+    spec_defaults(&fallback);
+    fallback.type = ICON_DIR_FALLBACK;
+    add_stamp("/usr/share/pixmaps");
+    scan_icon_dir("/usr/share/pixmaps", theme_count, &fallback);
+
+    built = 1;
+    build_count++;
+    last_recheck_ms = icon_theme_now_ms();
+    debug_log("nizam-panel: icon index built themes=%d roots=%d dirs=%d names=%d files=%d watches=%d%s\n",
+              theme_count, root_count, dir_count, name_count, file_count, watch_count,
+              watch_partial ? " (partial)" : "");
+}
+
+static int stamps_changed(void) {
+    for (int i = 0; i < stamp_count; i++) {
+        struct stat st;
+        if (stat(stamps[i].path, &st) != 0) return 1;
+        if (st.st_mtime != stamps[i].mtime) return 1;
+    }
+    return 0;
+}
+
+static void icon_theme_ensure(void) {
+    if (built && !stale && (watch_fd < 0 || watch_partial)) {
+        int64_t now = icon_theme_now_ms();
+        if (now - last_recheck_ms >= ICON_THEME_RECHECK_MS) {
+            last_recheck_ms = now;
+            if (stamps_changed()) stale = 1;
+        }
+    }
+    if (!built || stale) icon_theme_build();
+}
+
+static int dir_size_distance(const IconDir *d, int size) {
+    switch (d->type) {
+    case ICON_DIR_FIXED:
+        return abs(d->size - size);
+    case ICON_DIR_SCALABLE:
+        if (size < d->min_size) return d->min_size - size;
+        if (size > d->max_size) return size - d->max_size;
+        return 0;
+    case ICON_DIR_THRESHOLD:
+        if (size < d->size - d->threshold) return d->min_size - size;
+        if (size > d->size + d->threshold) return size - d->max_size;
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+static int find_best(const char *name, int size) {
+    gpointer val = g_hash_table_lookup(names, name);
+    if (!val) return -1;
+    int best = -1;
+    int best_theme = 0, best_dist = 0, best_svg = 0;
+    for (int i = name_heads[GPOINTER_TO_INT(val) - 1]; i >= 0; i = files[i].next) {
+        const IconDir *d = &dirs[files[i].dir];
+        int dist = dir_size_distance(d, size);
+        int svg = (files[i].ext == ICON_EXT_SVG);
+        if (best >= 0) {
+            if (d->theme > best_theme) continue;
+            if (d->theme == best_theme) {
+                if (dist > best_dist) continue;
+                if (dist == best_dist && svg >= best_svg) continue;
+            }
+        }
+        best = i;
+        best_theme = d->theme;
+        best_dist = dist;
+        best_svg = svg;
+    }
+    return best;
+}
+
+int icon_theme_lookup(const char *name, int size, char *out, size_t out_len) {
+    if (!name || !name[0] || !out || out_len == 0) return 0;
+    icon_theme_ensure();
+    if (!names) return 0;
+
+    const char *used = name;
+    int best = find_best(name, size);
+    char symbolic[256];
+    if (best < 0) {
+        size_t n = strlen(name);
+        if (n > 9 && strcmp(name + n - 9, "-symbolic") == 0) return 0;
+        snprintf(symbolic, sizeof(symbolic), "%s-symbolic", name);
+        best = find_best(symbolic, size);
+        used = symbolic;
+    }
+    if (best < 0) return 0;
+
+    int n = snprintf(out, out_len, "%s/%s%s", dirs[files[best].dir].path, used, icon_ext_str[files[best].ext]);
+    return n > 0 && (size_t)n < out_len;
+}
+
+int icon_theme_watch_fd(void) {
+    return watch_fd;
+}
+
+int icon_theme_handle_watch(void) {
+    if (watch_fd < 0) return 0;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    for (;;) {
+        ssize_t n = read(watch_fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        changed = 1;
+    }
+    if (changed && !stale) {
+        stale = 1;
+        debug_log("nizam-panel: icon index invalidated\n");
+    }
+    return changed;
+}
+
+int icon_theme_file_count(void) {
+    return file_count;
+}
+
+unsigned long icon_theme_build_count(void) {
+    return build_count;
+}
+
+void icon_theme_cleanup(void) {
+    icon_theme_reset();
+}
@@ -1,11 +1,17 @@
 
 #include "panel_shared.h"
+#include "nizam_launch.h"
+#include "nizam_monitors.h"
+#include "nizam_pixel.h"
 
 #include <errno.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdint.h>
 #include <dirent.h>
+#include <sys/prctl.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 
 #ifdef NIZAM_HAVE_LIBRSVG
 #include <librsvg/rsvg.h>
@@ -31,6 +37,29 @@ static PangoFontDescription *panel_font_desc = NULL;
 static volatile sig_atomic_t mem_debug_toggle_requested = 0;
 static int mem_debug_enabled = 0;
 
+unsigned long x_roundtrips = 0;
+static unsigned long redraw_roundtrips_last = 0;
+static unsigned long redraw_roundtrips_max = 0;
+
+#define PANEL_DAMAGE_MAX 16
+
+static Rect damage_rects[PANEL_DAMAGE_MAX];
+static int damage_count = 0;
+static unsigned long damage_pixels_last = 0;
+static unsigned long long damage_pixels_total = 0;
+static unsigned long damage_frames = 0;
+
+static struct nizam_monitors panel_monitors;
+
+typedef struct {
+    char hex[16];
+    PanelRGBA rgba;
+} PaletteEntry;
+
+static PaletteEntry palette[NIZAM_PANEL_PALETTE_CAP];
+static int palette_count = 0;
+static unsigned long palette_misses = 0;
+
 
 static Pixmap back_pixmap = None;
 static GC back_gc = None;
@@ -134,6 +163,7 @@ static Rect clock_sep_soft_rect = {0};
 Atom A_NET_CLIENT_LIST;
 Atom A_NET_ACTIVE_WINDOW;
 Atom A_NET_WM_NAME;
+Atom A_NET_WM_ICON;
 Atom A_UTF8_STRING;
 Atom A_NET_WM_STATE;
 Atom A_NET_WM_STATE_SKIP_TASKBAR;
@@ -150,7 +180,7 @@ Atom A_NET_WM_STATE_ABOVE;
 Atom A_NET_WM_STATE_STICKY;
 Atom A_NIZAM_PANEL_REDRAW;
 
-int running = 1;
+volatile sig_atomic_t running = 1;
 time_t last_clock_tick = 0;
 char clock_text[128] = {0};
 
@@ -178,6 +208,11 @@ static void on_sigusr1(int sig) {
     mem_debug_toggle_requested = 1;
 }
 
+static void on_sigterm(int sig) {
+    (void)sig;
+    running = 0;
+}
+
 static long read_rss_kb(void) {
     FILE *f = fopen("/proc/self/status", "r");
     if (!f) return -1;
@@ -211,14 +246,32 @@ static int pango_layout_count(void) {
 static void mem_debug_print_stats(const char *reason) {
     long rss_kb = read_rss_kb();
     fprintf(stderr,
-            "nizam-panel[mem]: %s rss=%ldkB icon_cache=%d/64 hits=%llu misses=%llu evict=%llu pango_layouts=%d\n",
+            "nizam-panel[mem]: %s rss=%ldkB icon_cache=%d/64 hits=%llu misses=%llu evict=%llu icon_index=%d/%lu class_icons=%d pango_layouts=%d"
+            " x_roundtrips=%lu redraw_roundtrips=%lu/%lu repaint_px=%lu frames=%lu avg_px=%llu"
+            " palette=%d palette_misses=%lu"
+            " monitor=%s monitors=%zu monitor_refreshes=%llu crtc_updates=%llu\n",
             reason ? reason : "stats",
             rss_kb,
             icon_cache_used_count(),
             (unsigned long long)icon_cache.hits,
             (unsigned long long)icon_cache.misses,
             (unsigned long long)icon_cache.evictions,
-            pango_layout_count());
+            icon_theme_file_count(),
+            icon_theme_build_count(),
+            app_icons_entry_count(),
+            pango_layout_count(),
+            x_roundtrips,
+            redraw_roundtrips_last,
+            redraw_roundtrips_max,
+            damage_pixels_last,
+            damage_frames,
+            damage_frames ? damage_pixels_total / damage_frames : 0ULL,
+            palette_count,
+            palette_misses,
+            settings.monitor[0] ? settings.monitor : "primary",
+            panel_monitors.count,
+            (unsigned long long)panel_monitors.refreshes,
+            (unsigned long long)panel_monitors.crtc_updates);
 }
 
 static int is_all_digits(const char *s) {
@@ -476,7 +529,7 @@ static void load_settings(PanelSettings *s) {
     s->position = PANEL_BOTTOM;
     s->height = 34;
     s->padding = 8;
-    s->monitor = 0;
+    s->monitor[0] = '\0';
     s->launcher_enabled = 1;
     s->launcher_cmd[0] = '\0';
     strcpy(s->launcher_label, "Applications");
@@ -486,19 +539,136 @@ static void load_settings(PanelSettings *s) {
     strcpy(s->clock_timezone, "local");
 }
 
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int parse_hex_rgba(const char *hex, PanelRGBA *out) {
+    if (!hex || hex[0] != '#') return 0;
+    size_t n = strlen(hex + 1);
+    int v[8];
+    if (n != 3 && n != 6 && n != 8) return 0;
+    for (size_t i = 0; i < n; i++) {
+        v[i] = hex_nibble(hex[1 + i]);
+        if (v[i] < 0) return 0;
+    }
+    if (n == 3) {
+        out->r = (v[0] * 17) / 255.0;
+        out->g = (v[1] * 17) / 255.0;
+        out->b = (v[2] * 17) / 255.0;
+        out->a = 1.0;
+        return 1;
+    }
+    out->r = (v[0] * 16 + v[1]) / 255.0;
+    out->g = (v[2] * 16 + v[3]) / 255.0;
+    out->b = (v[4] * 16 + v[5]) / 255.0;
+    out->a = (n == 8) ? (v[6] * 16 + v[7]) / 255.0 : 1.0;
+    return 1;
+}
+
+static int resolve_rgba(const char *hex, PanelRGBA *out) {
+    if (parse_hex_rgba(hex, out)) return 1;
+    if (!dpy || !hex) return 0;
+
+    XColor xc;
+    x_roundtrips++;
+    if (!XParseColor(dpy, DefaultColormap(dpy, screen), hex, &xc)) return 0;
+    out->r = xc.red / 65535.0;
+    out->g = xc.green / 65535.0;
+    out->b = xc.blue / 65535.0;
+    out->a = 1.0;
+    return 1;
+}
+
+static PaletteEntry *palette_find(const char *hex) {
+    for (int i = 0; i < palette_count; i++) {
+        if (strcmp(palette[i].hex, hex) == 0) return &palette[i];
+    }
+    return NULL;
+}
+
+void palette_register(const char *hex) {
+    if (!hex || !*hex || strlen(hex) >= sizeof(palette[0].hex)) return;
+    if (palette_find(hex)) return;
+
+    PanelRGBA rgba = {0.0, 0.0, 0.0, 1.0};
+    if (!resolve_rgba(hex, &rgba)) {
+        debug_log("nizam-panel: palette cannot resolve color '%s'\n", hex);
+    }
+    if (palette_count >= NIZAM_PANEL_PALETTE_CAP) {
+        palette_count = NIZAM_PANEL_PALETTE_CAP - 1;
+    }
+    PaletteEntry *e = &palette[palette_count++];
+    snprintf(e->hex, sizeof(e->hex), "%s", hex);
+    e->rgba = rgba;
+}
+
+void palette_init(void) {
+    palette_count = 0;
+    palette_register(color_bg);
+    palette_register(color_fg);
+    palette_register(color_active);
+    palette_register(color_active_text);
+    palette_register(color_sep);
+    palette_register(color_sep_soft);
+    menu_palette_init();
+    debug_log("nizam-panel: palette resolved %d color(s)\n", palette_count);
+}
+
+PanelRGBA palette_lookup(const char *hex) {
+    PanelRGBA black = {0.0, 0.0, 0.0, 1.0};
+    if (!hex || !*hex) return black;
+    PaletteEntry *e = palette_find(hex);
+    if (!e) {
+        palette_misses++;
+        palette_register(hex);
+        e = palette_find(hex);
+    }
+    return e ? e->rgba : black;
+}
+
+static unsigned long mask_channel(unsigned long mask, double v) {
+    if (!mask) return 0;
+    int shift = 0;
+    while (!(mask & 1UL)) {
+        mask >>= 1;
+        shift++;
+    }
+    return ((unsigned long)(v * (double)mask + 0.5) & mask) << shift;
+}
+
 unsigned long parse_color(Display *d, const char *hex) {
+    Visual *vis = DefaultVisual(d, screen);
+    if (vis->class == TrueColor) {
+        PanelRGBA c = palette_lookup(hex);
+        return mask_channel(vis->red_mask, c.r) | mask_channel(vis->green_mask, c.g) |
+               mask_channel(vis->blue_mask, c.b);
+    }
     XColor color;
     Colormap cmap = DefaultColormap(d, screen);
+    x_roundtrips++;
     if (XParseColor(d, cmap, hex, &color) && XAllocColor(d, cmap, &color)) {
         return color.pixel;
     }
     return BlackPixel(d, screen);
 }
 
+void palette_set_source(cairo_t *c, const char *hex) {
+    if (!c) return;
+    PanelRGBA rgba = palette_lookup(hex);
+    if (rgba.a >= 1.0) cairo_set_source_rgb(c, rgba.r, rgba.g, rgba.b);
+    else cairo_set_source_rgba(c, rgba.r, rgba.g, rgba.b, rgba.a);
+}
+
 static void setup_atoms(void) {
     A_NET_CLIENT_LIST = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
     A_NET_ACTIVE_WINDOW = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
     A_NET_WM_NAME = XInternAtom(dpy, "_NET_WM_NAME", False);
+    A_NET_WM_ICON = XInternAtom(dpy, "_NET_WM_ICON", False);
     A_UTF8_STRING = XInternAtom(dpy, "UTF8_STRING", False);
     A_NET_WM_STATE = XInternAtom(dpy, "_NET_WM_STATE", False);
     A_NET_WM_STATE_SKIP_TASKBAR = XInternAtom(dpy, "_NET_WM_STATE_SKIP_TASKBAR", False);
@@ -517,19 +687,58 @@ static void setup_atoms(void) {
     A_NIZAM_PANEL_REDRAW = XInternAtom(dpy, "_NIZAM_PANEL_REDRAW", False);
 }
 
-static int get_monitor_geometry(int idx, int *x, int *y, int *w, int *h) {
-    int n = 0;
-    XRRMonitorInfo *mons = XRRGetMonitors(dpy, root, True, &n);
-    if (mons && n > 0) {
-        if (idx < 0 || idx >= n) idx = 0;
-        *x = mons[idx].x;
-        *y = mons[idx].y;
-        *w = mons[idx].width;
-        *h = mons[idx].height;
-        XRRFreeMonitors(mons);
+static int rr_event_base = -1;
+
+#define PANEL_MONITOR_MAX 16
+
+static pid_t monitor_children[PANEL_MONITOR_MAX];
+static int monitor_child_count = 0;
+
+static void refresh_monitors(void) {
+    nizam_monitors_begin(&panel_monitors);
+    XRRScreenResources *res = XRRGetScreenResourcesCurrent(dpy, root);
+    x_roundtrips++;
+    if (!res) return;
+    RROutput primary = XRRGetOutputPrimary(dpy, root);
+    x_roundtrips++;
+    for (int i = 0; i < res->noutput; i++) {
+        XRROutputInfo *oi = XRRGetOutputInfo(dpy, res, res->outputs[i]);
+        x_roundtrips++;
+        if (!oi) continue;
+        if (oi->connection == RR_Connected && oi->crtc != None) {
+            XRRCrtcInfo *ci = XRRGetCrtcInfo(dpy, res, oi->crtc);
+            x_roundtrips++;
+            struct nizam_monitor *m = NULL;
+            if (ci && ci->width > 0 && ci->height > 0 &&
+                (m = nizam_monitors_add(&panel_monitors)) != NULL) {
+                m->x = ci->x;
+                m->y = ci->y;
+                m->w = (int)ci->width;
+                m->h = (int)ci->height;
+                m->crtc = (uint32_t)oi->crtc;
+                m->output = (uint32_t)res->outputs[i];
+                m->primary = res->outputs[i] == primary;
+                snprintf(m->name, sizeof(m->name), "%.*s", oi->nameLen, oi->name);
+            }
+            if (ci) XRRFreeCrtcInfo(ci);
+        }
+        XRRFreeOutputInfo(oi);
+    }
+    XRRFreeScreenResources(res);
+}
+
+static int get_monitor_geometry(const char *name, int *x, int *y, int *w, int *h) {
+    if (!panel_monitors.valid) refresh_monitors();
+    int idx = (name && *name) ? nizam_monitors_find(&panel_monitors, name) : -1;
+    if (idx < 0) idx = nizam_monitors_primary(&panel_monitors);
+    if (idx >= 0) {
+        const struct nizam_monitor *m = &panel_monitors.items[idx];
+        *x = m->x;
+        *y = m->y;
+        *w = m->w;
+        *h = m->h;
         return 1;
     }
-    if (mons) XRRFreeMonitors(mons);
     *x = 0;
     *y = 0;
     *w = DisplayWidth(dpy, screen);
@@ -537,6 +746,74 @@ static int get_monitor_geometry(int idx, int *x, int *y, int *w, int *h) {
     return 0;
 }
 
+static int handle_randr_event(XEvent *ev) {
+    if (rr_event_base < 0) return 0;
+    if (ev->type == rr_event_base + RRScreenChangeNotify) {
+        XRRUpdateConfiguration(ev);
+        panel_monitors.valid = 0;
+        return 1;
+    }
+    if (ev->type != rr_event_base + RRNotify) return 0;
+    XRRNotifyEvent *ne = (XRRNotifyEvent *)ev;
+    int rc = 0;
+    if (ne->subtype == RRNotify_CrtcChange) {
+        XRRCrtcChangeNotifyEvent *ce = (XRRCrtcChangeNotifyEvent *)ev;
+        int w = ce->mode != None ? (int)ce->width : 0;
+        int h = ce->mode != None ? (int)ce->height : 0;
+        rc = nizam_monitors_crtc_changed(&panel_monitors, (uint32_t)ce->crtc, ce->x, ce->y, w, h);
+    } else if (ne->subtype == RRNotify_OutputChange) {
+        rc = -1;
+    }
+    if (rc < 0) panel_monitors.valid = 0;
+    return rc != 0;
+}
+
+static void spawn_monitor_instances(const char *spec) {
+    int picked[PANEL_MONITOR_MAX];
+    size_t n = nizam_monitors_select(&panel_monitors, spec, picked, PANEL_MONITOR_MAX);
+    if (n == 0) return;
+
+    const struct nizam_monitor *first = &panel_monitors.items[picked[0]];
+    if (first->name[0]) {
+        snprintf(settings.monitor, sizeof(settings.monitor), "%s", first->name);
+    } else {
+        snprintf(settings.monitor, sizeof(settings.monitor), "%d", picked[0]);
+    }
+
+    extern char **environ;
+    for (size_t k = 1; k < n; k++) {
+        char name[NIZAM_MONITOR_NAME_MAX];
+        const struct nizam_monitor *m = &panel_monitors.items[picked[k]];
+        if (m->name[0]) {
+            snprintf(name, sizeof(name), "%s", m->name);
+        } else {
+            snprintf(name, sizeof(name), "%d", picked[k]);
+        }
+        char parent[32];
+        snprintf(parent, sizeof(parent), "%d", (int)getpid());
+        char *child_argv[] = {"nizam-panel", "--monitor", name, "--parent-pid", parent, NULL};
+        pid_t pid = -1;
+        int rc = posix_spawn(&pid, "/proc/self/exe", NULL, NULL, child_argv, environ);
+        if (rc != 0) {
+            fprintf(stderr, "nizam-panel: cannot start panel for monitor %s: %s\n", name, strerror(rc));
+            continue;
+        }
+        monitor_children[monitor_child_count++] = pid;
+    }
+}
+
+static void reap_monitor_instances(void) {
+    int i = 0;
+    while (i < monitor_child_count) {
+        pid_t r = waitpid(monitor_children[i], NULL, WNOHANG);
+        if (r == 0 || (r < 0 && errno == EINTR)) {
+            i++;
+            continue;
+        }
+        monitor_children[i] = monitor_children[--monitor_child_count];
+    }
+}
+
 static void update_clock_text(void) {
     clock_update_text();
 }
@@ -593,6 +870,7 @@ int get_root_cardinal(Atom prop, unsigned long *out) {
     int fmt;
     unsigned long nitems, bytes;
     unsigned char *data = NULL;
+    x_roundtrips++;
     if (XGetWindowProperty(dpy, root, prop, 0, 1, False, AnyPropertyType, &type, &fmt, &nitems, &bytes, &data) != Success) {
         return 0;
     }
@@ -610,6 +888,7 @@ int window_has_state(Window w, Atom state_atom) {
     int fmt;
     unsigned long nitems, bytes;
     unsigned char *data = NULL;
+    x_roundtrips++;
     if (XGetWindowProperty(dpy, w, A_NET_WM_STATE, 0, 1024, False, XA_ATOM, &type, &fmt, &nitems, &bytes, &data) != Success) {
         return 0;
     }
@@ -629,6 +908,7 @@ int window_is_type(Window w, Atom type_atom) {
     int fmt;
     unsigned long nitems, bytes;
     unsigned char *data = NULL;
+    x_roundtrips++;
     if (XGetWindowProperty(dpy, w, A_NET_WM_WINDOW_TYPE, 0, 16, False, XA_ATOM, &type, &fmt, &nitems, &bytes, &data) != Success) {
         return 0;
     }
@@ -648,6 +928,7 @@ int get_window_desktop(Window w, unsigned long *out) {
     int fmt;
     unsigned long nitems, bytes;
     unsigned char *data = NULL;
+    x_roundtrips++;
     if (XGetWindowProperty(dpy, w, A_NET_WM_DESKTOP, 0, 1, False, XA_CARDINAL, &type, &fmt, &nitems, &bytes, &data) != Success) {
         return 0;
     }
@@ -666,6 +947,7 @@ void get_window_title(Window w, char *out, size_t out_len) {
     int fmt;
     unsigned long nitems, bytes;
     unsigned char *data = NULL;
+    x_roundtrips++;
     if (XGetWindowProperty(dpy, w, A_NET_WM_NAME, 0, 1024, False, A_UTF8_STRING, &type, &fmt, &nitems, &bytes, &data) == Success) {
         if (data) {
             strncpy(out, (char *)data, out_len - 1);
@@ -679,6 +961,7 @@ void get_window_title(Window w, char *out, size_t out_len) {
         }
     }
     XTextProperty prop;
+    x_roundtrips++;
     if (XGetWMName(dpy, w, &prop) && prop.value) {
         strncpy(out, (char *)prop.value, out_len - 1);
         out[out_len - 1] = '\0';
@@ -694,6 +977,7 @@ void get_window_class(Window w, char *instance, size_t instance_len, char *klass
     instance[0] = '\0';
     klass[0] = '\0';
     XClassHint hint;
+    x_roundtrips++;
     if (XGetClassHint(dpy, w, &hint)) {
         if (hint.res_name) {
             strncpy(instance, hint.res_name, instance_len - 1);
@@ -713,50 +997,6 @@ static int file_exists(const char *path) {
     return (stat(path, &st) == 0);
 }
 
-static int dir_exists(const char *path) {
-    struct stat st;
-    if (!path || path[0] == '\0') return 0;
-    if (stat(path, &st) != 0) return 0;
-    return S_ISDIR(st.st_mode);
-}
-
-static void path_parent_inplace(char *path) {
-    if (!path) return;
-    size_t n = strlen(path);
-    if (n == 0) return;
-    
-    while (n > 1 && path[n - 1] == '/') {
-        path[n - 1] = '\0';
-        n--;
-    }
-    char *slash = strrchr(path, '/');
-    if (!slash) {
-        path[0] = '\0';
-        return;
-    }
-    if (slash == path) {
-        
-        path[1] = '\0';
-        return;
-    }
-    *slash = '\0';
-}
-
-static int build_common_icons_path(char *dst, size_t dst_sz, const char *base) {
-    if (!dst || dst_sz == 0 || !base) return 0;
-    const char *suffix = "/nizam-common/icons";
-    size_t blen = strlen(base);
-    size_t slen = strlen(suffix);
-    if (blen + slen + 1 > dst_sz) {
-        dst[0] = '\0';
-        return 0;
-    }
-    memcpy(dst, base, blen);
-    memcpy(dst + blen, suffix, slen);
-    dst[blen + slen] = '\0';
-    return 1;
-}
-
 static cairo_surface_t *load_icon_from_path(const char *path) {
     if (!path || path[0] == '\0') return NULL;
     if (!file_exists(path)) return NULL;
@@ -791,22 +1031,18 @@ static cairo_surface_t *load_icon_from_path(const char *path) {
     int nchan = gdk_pixbuf_get_n_channels(pb);
     int has_alpha = gdk_pixbuf_get_has_alpha(pb);
 
-    
     for (int y = 0; y < h; y++) {
         const unsigned char *srow = src + y * src_stride;
-        unsigned char *drow = dst + y * dst_stride;
-        for (int x = 0; x < w; x++) {
-            const unsigned char *sp = srow + x * nchan;
-            unsigned char r = sp[0];
-            unsigned char g = sp[1];
-            unsigned char b = sp[2];
-            unsigned char a = has_alpha ? sp[3] : 0xff;
-
-            unsigned char *dp = drow + x * 4;
-            dp[0] = (unsigned char)((b * a) / 255);
-            dp[1] = (unsigned char)((g * a) / 255);
-            dp[2] = (unsigned char)((r * a) / 255);
-            dp[3] = a;
+        uint32_t *drow = (uint32_t *)(dst + y * dst_stride);
+        if (has_alpha && nchan == 4) {
+            nizam_pixel_rgba_to_argb32(drow, srow, (size_t)w);
+        } else if (!has_alpha && nchan == 3) {
+            nizam_pixel_rgb_to_argb32(drow, srow, (size_t)w);
+        } else {
+            for (int x = 0; x < w; x++) {
+                const unsigned char *sp = srow + x * nchan;
+                drow[x] = 0xff000000u | (uint32_t)sp[0] << 16 | (uint32_t)sp[1] << 8 | sp[2];
+            }
         }
     }
 
@@ -830,79 +1066,6 @@ static int ends_with(const char *s, const char *suffix) {
     return strcmp(s + (ls - lf), suffix) == 0;
 }
 
-static cairo_surface_t *try_icon_path_raster(const char *root, const char *theme, int sz, const char *name, const char *ext_with_dot) {
-    if (!root || !theme || !name || !ext_with_dot) return NULL;
-    
-    const char *dirs[] = {
-        "apps",
-        "categories",
-        "places",
-        "actions",
-        "status",
-        "devices",
-        "mimetypes",
-        "emblems",
-    };
-    for (size_t d = 0; d < sizeof(dirs) / sizeof(dirs[0]); d++) {
-        
-        size_t need = strlen(root) + 1 + strlen(theme) + 1 + 10 + 1 + strlen(dirs[d]) + 1 + strlen(name) + strlen(ext_with_dot) + 1;
-        char *p = malloc(need);
-        if (!p) return NULL;
-        snprintf(p, need, "%s/%s/%dx%d/%s/%s%s", root, theme, sz, sz, dirs[d], name, ext_with_dot);
-        cairo_surface_t *surf = load_icon_from_path(p);
-        free(p);
-        if (surf) return surf;
-    }
-    return NULL;
-}
-
-#ifdef NIZAM_HAVE_LIBRSVG
-static cairo_surface_t *load_svg_icon_from_path(const char *path, int size);
-
-static cairo_surface_t *try_icon_path_svg(const char *root, const char *theme, const char *name, int size) {
-    if (!root || !theme || !name) return NULL;
-    const char *size_dirs[] = {"scalable", "symbolic"};
-    
-    const char *icon_dirs[] = {
-        "apps",
-        "categories",
-        "places",
-        "actions",
-        "status",
-        "devices",
-        "mimetypes",
-        "emblems",
-    };
-
-    char name_symbolic[512];
-    name_symbolic[0] = '\0';
-    if (!ends_with(name, "-symbolic")) {
-        snprintf(name_symbolic, sizeof(name_symbolic), "%s-symbolic", name);
-    }
-
-    for (size_t sd = 0; sd < sizeof(size_dirs) / sizeof(size_dirs[0]); sd++) {
-        for (size_t d = 0; d < sizeof(icon_dirs) / sizeof(icon_dirs[0]); d++) {
-            const char *candidates[2];
-            size_t cand_count = 0;
-            candidates[cand_count++] = name;
-            if (name_symbolic[0]) candidates[cand_count++] = name_symbolic;
-
-            for (size_t c = 0; c < cand_count; c++) {
-                
-                size_t need = strlen(root) + 1 + strlen(theme) + 1 + strlen(size_dirs[sd]) + 1 + strlen(icon_dirs[d]) + 1 + strlen(candidates[c]) + 4 + 1;
-                char *p = malloc(need);
-                if (!p) return NULL;
-                snprintf(p, need, "%s/%s/%s/%s/%s.svg", root, theme, size_dirs[sd], icon_dirs[d], candidates[c]);
-                cairo_surface_t *surf = load_svg_icon_from_path(p, size);
-                free(p);
-                if (surf) return surf;
-            }
-        }
-    }
-    return NULL;
-}
-#endif
-
 #ifdef NIZAM_HAVE_LIBRSVG
 static cairo_surface_t *load_svg_icon_from_path(const char *path, int size) {
     if (!path || path[0] == '\0') return NULL;
@@ -964,63 +1127,6 @@ static cairo_surface_t *load_svg_icon_from_path(const char *path, int size) {
 }
 #endif
 
-static int read_desktop_icon(const char *path, char *out, size_t out_len) {
-    FILE *f = fopen(path, "r");
-    if (!f) return 0;
-    char line[512];
-    int in_entry = 0;
-    while (fgets(line, sizeof(line), f)) {
-        if (line[0] == '[') {
-            in_entry = (strncmp(line, "[Desktop Entry]", 15) == 0);
-            continue;
-        }
-        if (!in_entry) continue;
-        if (strncmp(line, "Icon=", 5) == 0) {
-            char *val = line + 5;
-            while (*val == ' ' || *val == '\t') val++;
-            char *end = val + strlen(val);
-            while (end > val && (end[-1] == '\n' || end[-1] == '\r')) end--;
-            size_t len = (size_t)(end - val);
-            if (len >= out_len) len = out_len - 1;
-            memcpy(out, val, len);
-            out[len] = '\0';
-            fclose(f);
-            return 1;
-        }
-    }
-    fclose(f);
-    return 0;
-}
-
-int find_desktop_icon_for_class(const char *instance, const char *klass, char *out, size_t out_len) {
-    const char *home = getenv("HOME");
-    char path[512];
-    const char *names[4];
-    char inst_lower[128], class_lower[128];
-    size_t i = 0;
-    if (instance && instance[0]) names[i++] = instance;
-    if (klass && klass[0]) names[i++] = klass;
-    if (instance && instance[0]) {
-        snprintf(inst_lower, sizeof(inst_lower), "%s", instance);
-        for (char *p = inst_lower; *p; p++) *p = (char)tolower(*p);
-        names[i++] = inst_lower;
-    }
-    if (klass && klass[0]) {
-        snprintf(class_lower, sizeof(class_lower), "%s", klass);
-        for (char *p = class_lower; *p; p++) *p = (char)tolower(*p);
-        names[i++] = class_lower;
-    }
-    for (size_t n = 0; n < i; n++) {
-        if (home) {
-            snprintf(path, sizeof(path), "%s/.local/share/applications/%s.desktop", home, names[n]);
-            if (read_desktop_icon(path, out, out_len)) return 1;
-        }
-        snprintf(path, sizeof(path), "/usr/share/applications/%s.desktop", names[n]);
-        if (read_desktop_icon(path, out, out_len)) return 1;
-    }
-    return 0;
-}
-
 static cairo_surface_t *load_icon_from_name_uncached(const char *name, int size) {
     if (!name || name[0] == '\0') return NULL;
     if (strchr(name, '/')) {
@@ -1065,127 +1171,12 @@ static cairo_surface_t *load_icon_from_name_uncached(const char *name, int size)
         }
     }
 
-    const char *home = getenv("HOME");
-    const char *themes[] = {"hicolor", "Adwaita", "AdwaitaLegacy"};
-    const int sizes[] = {16, 22, 24, 32, 48, 64, 96, 128, 256};
     char path[1024];
-
-    
-    
-    char common_icons_root[1024];
-    common_icons_root[0] = '\0';
-    const char *common_dir = getenv("NIZAM_COMMON_DIR");
-    if (common_dir && *common_dir) {
-        snprintf(common_icons_root, sizeof(common_icons_root), "%s/icons", common_dir);
-        if (!dir_exists(common_icons_root)) common_icons_root[0] = '\0';
-    }
-
-    char exe_icons_root[1024];
-    exe_icons_root[0] = '\0';
-    {
-        char exe_path[1024];
-        ssize_t n = readlink("/proc/self/exe", exe_path, (sizeof(exe_path) - 1));
-        if (n > 0) {
-            exe_path[n] = '\0';
-            
-            
-            path_parent_inplace(exe_path);
-            for (int up = 0; up < 8; up++) {
-                if (!build_common_icons_path(exe_icons_root, sizeof(exe_icons_root), exe_path)) {
-                    exe_icons_root[0] = '\0';
-                    break;
-                }
-                if (dir_exists(exe_icons_root)) break;
-                exe_icons_root[0] = '\0';
-                path_parent_inplace(exe_path);
-                if (exe_path[0] == '\0') break;
-            }
-        }
-    }
-
-    char cwd_icons_root[1024];
-    cwd_icons_root[0] = '\0';
-    {
-        char cwd[1024];
-        if (getcwd(cwd, sizeof(cwd))) {
-            build_common_icons_path(cwd_icons_root, sizeof(cwd_icons_root), cwd);
-            if (!dir_exists(cwd_icons_root)) cwd_icons_root[0] = '\0';
-        }
-    }
-
-    
-    char fp_user[1024];
-    fp_user[0] = '\0';
-    if (home) snprintf(fp_user, sizeof(fp_user), "%s/.local/share/flatpak/exports/share/icons", home);
-    const char *icon_roots[] = {
-        common_icons_root[0] ? common_icons_root : NULL,
-        exe_icons_root[0] ? exe_icons_root : NULL,
-        cwd_icons_root[0] ? cwd_icons_root : NULL,
-        home ? "~/.local/share/icons" : NULL, 
-        home ? "~/.icons" : NULL,             
-        fp_user[0] ? fp_user : NULL,
-        "/var/lib/flatpak/exports/share/icons",
-        "/usr/local/share/icons",
-        "/usr/share/icons",
-    };
-
-    char home_icons[1024];
-    char home_doticons[1024];
-    home_icons[0] = '\0';
-    home_doticons[0] = '\0';
-    if (home) {
-        snprintf(home_icons, sizeof(home_icons), "%s/.local/share/icons", home);
-        snprintf(home_doticons, sizeof(home_doticons), "%s/.icons", home);
-    }
-
-    for (size_t t = 0; t < sizeof(themes)/sizeof(themes[0]); t++) {
-        for (size_t r = 0; r < sizeof(icon_roots)/sizeof(icon_roots[0]); r++) {
-            const char *root = icon_roots[r];
-            if (!root) continue;
-            if (strcmp(root, "~/.local/share/icons") == 0) root = home_icons;
-            if (strcmp(root, "~/.icons") == 0) root = home_doticons;
-
-            for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
-                cairo_surface_t *surf = try_icon_path_raster(root, themes[t], sizes[s], lookup, ".png");
-                if (surf) return surf;
-                surf = try_icon_path_raster(root, themes[t], sizes[s], lookup, ".xpm");
-                if (surf) return surf;
-            }
-        }
-    }
-
+    if (!icon_theme_lookup(lookup, size, path, sizeof(path))) return NULL;
 #ifdef NIZAM_HAVE_LIBRSVG
-    
-    for (size_t t = 0; t < sizeof(themes)/sizeof(themes[0]); t++) {
-        for (size_t r = 0; r < sizeof(icon_roots)/sizeof(icon_roots[0]); r++) {
-            const char *root = icon_roots[r];
-            if (!root) continue;
-            if (strcmp(root, "~/.local/share/icons") == 0) root = home_icons;
-            if (strcmp(root, "~/.icons") == 0) root = home_doticons;
-
-            cairo_surface_t *surf = try_icon_path_svg(root, themes[t], lookup, size);
-            if (surf) return surf;
-        }
-    }
-    
-    snprintf(path, sizeof(path), "/usr/share/icons/hicolor/scalable/apps/%s.svg", lookup);
-    cairo_surface_t *surf_svg = load_svg_icon_from_path(path, size);
-    if (surf_svg) return surf_svg;
+    if (ends_with(path, ".svg")) return load_svg_icon_from_path(path, size);
 #endif
-    snprintf(path, sizeof(path), "/usr/share/pixmaps/%s.png", lookup);
-    cairo_surface_t *surf = load_icon_from_path(path);
-    if (surf) return surf;
-    snprintf(path, sizeof(path), "/usr/share/pixmaps/%s.xpm", lookup);
-    surf = load_icon_from_path(path);
-    if (surf) return surf;
-
-#ifdef NIZAM_HAVE_LIBRSVG
-    snprintf(path, sizeof(path), "/usr/share/pixmaps/%s.svg", lookup);
-    surf = load_svg_icon_from_path(path, size);
-    if (surf) return surf;
-#endif
-
-    return NULL;
+    return load_icon_from_path(path);
 }
 
 cairo_surface_t *load_icon_from_name(const char *name, int size) {
@@ -1211,68 +1202,128 @@ cairo_surface_t *load_icon_from_name(const char *name, int size) {
     return surf;
 }
 
-cairo_surface_t *load_window_icon(Window w, int size) {
-    Atom A_NET_WM_ICON = XInternAtom(dpy, "_NET_WM_ICON", False);
+#define NET_WM_ICON_MAX_CANDIDATES 32
+#define NET_WM_ICON_MAX_SIDE 1024
+
+static int read_net_wm_icon(Window w, long offset, long length, unsigned long **out, unsigned long *out_n,
+                            unsigned long *bytes_after) {
     Atom type;
     int fmt;
-    unsigned long nitems, bytes;
+    unsigned long nitems = 0, bytes = 0;
     unsigned char *data = NULL;
-    if (XGetWindowProperty(dpy, w, A_NET_WM_ICON, 0, 1048576, False, XA_CARDINAL,
+    *out = NULL;
+    *out_n = 0;
+    x_roundtrips++;
+    if (XGetWindowProperty(dpy, w, A_NET_WM_ICON, offset, length, False, XA_CARDINAL,
                            &type, &fmt, &nitems, &bytes, &data) != Success) {
-        return NULL;
+        return 0;
     }
-    if (!data || type != XA_CARDINAL || fmt != 32 || nitems < 2) {
+    if (!data || type != XA_CARDINAL || fmt != 32 || nitems == 0) {
         if (data) XFree(data);
-        return NULL;
+        return 0;
     }
+    *out = (unsigned long *)data;
+    *out_n = nitems;
+    if (bytes_after) *bytes_after = bytes;
+    return 1;
+}
 
-    unsigned long *icons = (unsigned long *)data;
-    unsigned long best_w = 0, best_h = 0;
-    unsigned long best_score = 0;
-    unsigned long *best = NULL;
-    unsigned long idx = 0;
-    while (idx + 1 < nitems) {
-        unsigned long w0 = icons[idx++];
-        unsigned long h0 = icons[idx++];
-        if (w0 == 0 || h0 == 0) break;
-        if (idx + w0 * h0 > nitems) break;
-        unsigned long score = (unsigned long)labs((long)w0 - size) + (unsigned long)labs((long)h0 - size);
-        if (!best || score < best_score) {
-            best = &icons[idx];
-            best_w = w0;
-            best_h = h0;
-            best_score = score;
-        }
-        idx += w0 * h0;
-    }
-    if (!best) {
-        XFree(data);
+static cairo_surface_t *argb_to_icon_surface(const unsigned long *argb, int w, int h, int size) {
+    cairo_surface_t *src = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, w, h);
+    if (cairo_surface_status(src) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(src);
         return NULL;
     }
+    unsigned char *dst = cairo_image_surface_get_data(src);
+    int stride = cairo_image_surface_get_stride(src);
+    for (int y = 0; y < h; y++) {
+        uint32_t *row = (uint32_t *)(dst + y * stride);
+        const unsigned long *in = argb + (size_t)y * (size_t)w;
+        for (int x = 0; x < w; x++) row[x] = (uint32_t)in[x];
+        nizam_pixel_premultiply_argb32(row, row, (size_t)w);
+    }
+    cairo_surface_mark_dirty(src);
+    if (w == size && h == size) return src;
+
+    cairo_surface_t *out = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+    if (cairo_surface_status(out) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(out);
+        return src;
+    }
+    if (w >= size && h >= size) {
+        cairo_surface_flush(out);
+        nizam_pixel_downscale_box((uint32_t *)cairo_image_surface_get_data(out), size, size,
+                                  cairo_image_surface_get_stride(out) / 4,
+                                  (const uint32_t *)dst, w, h, stride / 4);
+        cairo_surface_mark_dirty(out);
+        cairo_surface_destroy(src);
+        return out;
+    }
+    cairo_t *c = cairo_create(out);
+    cairo_scale(c, (double)size / (double)w, (double)size / (double)h);
+    cairo_set_source_surface(c, src, 0, 0);
+    cairo_pattern_set_filter(cairo_get_source(c), CAIRO_FILTER_GOOD);
+    cairo_paint(c);
+    cairo_destroy(c);
+    cairo_surface_destroy(src);
+    cairo_surface_flush(out);
+    return out;
+}
 
-    cairo_surface_t *surf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, (int)best_w, (int)best_h);
-    unsigned char *dst = cairo_image_surface_get_data(surf);
-    int stride = cairo_image_surface_get_stride(surf);
-    for (unsigned long y = 0; y < best_h; y++) {
-        for (unsigned long x = 0; x < best_w; x++) {
-            unsigned long argb = best[y * best_w + x];
-            unsigned char a = (argb >> 24) & 0xff;
-            unsigned char r = (argb >> 16) & 0xff;
-            unsigned char g = (argb >> 8) & 0xff;
-            unsigned char b = (argb) & 0xff;
-            unsigned char *p = dst + y * stride + x * 4;
-            p[0] = (unsigned char)((b * a) / 255);
-            p[1] = (unsigned char)((g * a) / 255);
-            p[2] = (unsigned char)((r * a) / 255);
-            p[3] = a;
-        }
+cairo_surface_t *load_window_icon(Window w, int size) {
+    if (size < 1) size = 1;
+
+    long offsets[NET_WM_ICON_MAX_CANDIDATES];
+    unsigned long widths[NET_WM_ICON_MAX_CANDIDATES];
+    unsigned long heights[NET_WM_ICON_MAX_CANDIDATES];
+    int count = 0;
+    long offset = 0;
+    while (count < NET_WM_ICON_MAX_CANDIDATES) {
+        unsigned long *hdr = NULL;
+        unsigned long n = 0, after = 0;
+        if (!read_net_wm_icon(w, offset, 2, &hdr, &n, &after)) break;
+        unsigned long w0 = n >= 2 ? hdr[0] : 0;
+        unsigned long h0 = n >= 2 ? hdr[1] : 0;
+        XFree(hdr);
+        if (w0 == 0 || h0 == 0 || w0 > NET_WM_ICON_MAX_SIDE || h0 > NET_WM_ICON_MAX_SIDE) break;
+        if ((unsigned long long)w0 * h0 * 4 > after) break;
+        offsets[count] = offset + 2;
+        widths[count] = w0;
+        heights[count] = h0;
+        count++;
+        offset += 2 + (long)(w0 * h0);
+        if ((unsigned long long)w0 * h0 * 4 == after) break;
+    }
+    if (count == 0) return NULL;
+
+    int best = -1;
+    for (int i = 0; i < count; i++) {
+        int fits = widths[i] >= (unsigned long)size && heights[i] >= (unsigned long)size;
+        if (best < 0) { best = i; continue; }
+        int best_fits = widths[best] >= (unsigned long)size && heights[best] >= (unsigned long)size;
+        unsigned long area = widths[i] * heights[i];
+        unsigned long best_area = widths[best] * heights[best];
+        if (fits && (!best_fits || area < best_area)) best = i;
+        else if (!fits && !best_fits && area > best_area) best = i;
+    }
+
+    unsigned long *pixels = NULL;
+    unsigned long n = 0;
+    long want = (long)(widths[best] * heights[best]);
+    if (!read_net_wm_icon(w, offsets[best], want, &pixels, &n, NULL)) return NULL;
+    if (n < (unsigned long)want) {
+        XFree(pixels);
+        return NULL;
     }
-    cairo_surface_mark_dirty(surf);
-    XFree(data);
+    debug_log("nizam-panel: _NET_WM_ICON 0x%lx picked %lux%lu of %d size(s)\n",
+              w, widths[best], heights[best], count);
+    cairo_surface_t *surf = argb_to_icon_surface(pixels, (int)widths[best], (int)heights[best], size);
+    XFree(pixels);
     return surf;
 }
 
 cairo_surface_t *load_window_icon_hint(Window w, int size) {
+    x_roundtrips++;
     XWMHints *hints = XGetWMHints(dpy, w);
     if (!hints) return NULL;
     if (!(hints->flags & IconPixmapHint) || hints->icon_pixmap == None) {
@@ -1283,25 +1334,33 @@ cairo_surface_t *load_window_icon_hint(Window w, int size) {
     XFree(hints);
 
     XWindowAttributes attr;
+    x_roundtrips++;
     if (!XGetWindowAttributes(dpy, root, &attr)) return NULL;
 
+    x_roundtrips++;
     XImage *img = XGetImage(dpy, pix, 0, 0, (unsigned int)size, (unsigned int)size, AllPlanes, ZPixmap);
     if (!img) return NULL;
 
     cairo_surface_t *surf = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
     unsigned char *dst = cairo_image_surface_get_data(surf);
     int stride = cairo_image_surface_get_stride(surf);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    int host_order = LSBFirst;
+#else
+    int host_order = MSBFirst;
+#endif
+    int direct = img->bits_per_pixel == 32 && img->byte_order == host_order &&
+                 img->red_mask == 0xff0000 && img->green_mask == 0xff00 && img->blue_mask == 0xff;
     for (int y = 0; y < size; y++) {
+        uint32_t *row = (uint32_t *)(dst + y * stride);
+        if (direct) {
+            nizam_pixel_xrgb_to_argb32(row, (const uint32_t *)(img->data + (size_t)y * img->bytes_per_line),
+                                       (size_t)size);
+            continue;
+        }
         for (int x = 0; x < size; x++) {
             unsigned long pixel = XGetPixel(img, x, y);
-            unsigned char r = (pixel >> 16) & 0xff;
-            unsigned char g = (pixel >> 8) & 0xff;
-            unsigned char b = (pixel) & 0xff;
-            unsigned char *p = dst + y * stride + x * 4;
-            p[0] = b;
-            p[1] = g;
-            p[2] = r;
-            p[3] = 0xff;
+            row[x] = 0xff000000u | (uint32_t)(pixel & 0xffffff);
         }
     }
     cairo_surface_mark_dirty(surf);
@@ -1315,14 +1374,11 @@ static int64_t now_ms(void) {
     return (int64_t)ts.tv_sec * 1000 + (int64_t)(ts.tv_nsec / 1000000);
 }
 
-static void update_clients(int force) {
-    static int64_t last_ms = 0;
-    int64_t now = now_ms();
-    if (!force && (now - last_ms) < 80) {
-        return;
-    }
-    last_ms = now;
-    tasklist_update_clients();
+static const int64_t TASK_FRAME_MS = 16;
+static const int64_t MENU_PRELOAD_DELAY_MS = 250;
+
+static int update_clients(void) {
+    return tasklist_update_clients();
 }
 
 void iconify_window(Window w) {
@@ -1465,14 +1521,7 @@ static void update_layout(void) {
 }
 
 void draw_rect(cairo_t *c, Rect r, const char *hex, int fill) {
-    unsigned long pixel = parse_color(dpy, hex);
-    XColor xc;
-    xc.pixel = pixel;
-    XQueryColor(dpy, DefaultColormap(dpy, screen), &xc);
-    double rr = xc.red / 65535.0;
-    double gg = xc.green / 65535.0;
-    double bb = xc.blue / 65535.0;
-    cairo_set_source_rgb(c, rr, gg, bb);
+    palette_set_source(c, hex);
     cairo_rectangle(c, r.x, r.y, r.w, r.h);
     if (fill) cairo_fill(c);
     else cairo_stroke(c);
@@ -1499,14 +1548,7 @@ void draw_text_role(PanelTextRole role,
     if (align_center) pango_layout_set_alignment(ly, PANGO_ALIGN_CENTER);
     else pango_layout_set_alignment(ly, PANGO_ALIGN_LEFT);
 
-    unsigned long pixel = parse_color(dpy, hex);
-    XColor xc;
-    xc.pixel = pixel;
-    XQueryColor(dpy, DefaultColormap(dpy, screen), &xc);
-    double rr = xc.red / 65535.0;
-    double gg = xc.green / 65535.0;
-    double bb = xc.blue / 65535.0;
-    cairo_set_source_rgb(cr, rr, gg, bb);
+    palette_set_source(cr, hex);
     int tw = 0, th = 0;
     pango_layout_get_pixel_size(ly, &tw, &th);
     int dy = y + (h - th) / 2;
@@ -1542,32 +1584,17 @@ void draw_icon_tinted_to(cairo_t *c, cairo_surface_t *icon, int x, int y, int si
     double sx = (double)size / (double)iw;
     double sy = (double)size / (double)ih;
 
-    unsigned long pixel = parse_color(dpy, hex);
-    XColor xc;
-    xc.pixel = pixel;
-    XQueryColor(dpy, DefaultColormap(dpy, screen), &xc);
-    double rr = xc.red / 65535.0;
-    double gg = xc.green / 65535.0;
-    double bb = xc.blue / 65535.0;
-
     cairo_save(c);
     cairo_translate(c, x, y);
     cairo_scale(c, sx, sy);
-    cairo_set_source_rgb(c, rr, gg, bb);
+    palette_set_source(c, hex);
     cairo_mask_surface(c, icon, 0, 0);
     cairo_restore(c);
 }
 
 
 void draw_triangle(int x, int y, int w, int h, int dir_left, const char *hex) {
-    unsigned long pixel = parse_color(dpy, hex);
-    XColor xc;
-    xc.pixel = pixel;
-    XQueryColor(dpy, DefaultColormap(dpy, screen), &xc);
-    double rr = xc.red / 65535.0;
-    double gg = xc.green / 65535.0;
-    double bb = xc.blue / 65535.0;
-    cairo_set_source_rgb(cr, rr, gg, bb);
+    palette_set_source(cr, hex);
     
     int size = (w < h ? w : h);
     size = (int)(size * 0.35);
@@ -1596,57 +1623,126 @@ void draw_triangle(int x, int y, int w, int h, int dir_left, const char *hex) {
     cairo_fill(cr);
 }
 
-static void redraw(void) {
-    if (!surface) return;
+static void note_redraw_roundtrips(unsigned long start, const char *what) {
+    redraw_roundtrips_last = x_roundtrips - start;
+    if (redraw_roundtrips_last > redraw_roundtrips_max) redraw_roundtrips_max = redraw_roundtrips_last;
+    if (redraw_roundtrips_last > 0) {
+        debug_log("nizam-panel: %s made %lu X round trip(s)\n", what, redraw_roundtrips_last);
+    }
+}
 
-    
-    Rect full = {0, 0, panel_w, panel_h};
-    draw_rect(cr, full, color_bg, 1);
+static int rect_intersects(Rect a, Rect b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
 
-    menu_draw();
-    
-    tasklist_draw();
-    clock_draw();
-    if (launcher_sep_rect.w > 0) draw_rect(cr, launcher_sep_rect, color_sep, 1);
-    if (launcher_sep_soft_rect.w > 0) draw_rect(cr, launcher_sep_soft_rect, color_sep_soft, 1);
-    if (clock_sep_rect.w > 0) draw_rect(cr, clock_sep_rect, color_sep, 1);
-    if (clock_sep_soft_rect.w > 0) draw_rect(cr, clock_sep_soft_rect, color_sep_soft, 1);
+static Rect rect_union(Rect a, Rect b) {
+    int x0 = a.x < b.x ? a.x : b.x;
+    int y0 = a.y < b.y ? a.y : b.y;
+    int x1 = (a.x + a.w) > (b.x + b.w) ? (a.x + a.w) : (b.x + b.w);
+    int y1 = (a.y + a.h) > (b.y + b.h) ? (a.y + a.h) : (b.y + b.h);
+    Rect r = {x0, y0, x1 - x0, y1 - y0};
+    return r;
+}
 
-    cairo_surface_flush(surface);
+void panel_damage(Rect r) {
+    if (r.x < 0) { r.w += r.x; r.x = 0; }
+    if (r.y < 0) { r.h += r.y; r.y = 0; }
+    if (r.x + r.w > panel_w) r.w = panel_w - r.x;
+    if (r.y + r.h > panel_h) r.h = panel_h - r.y;
+    if (r.w <= 0 || r.h <= 0) return;
 
-    if (back_pixmap != None) {
-        XCopyArea(dpy, back_pixmap, win, back_gc, 0, 0, (unsigned int)panel_w, (unsigned int)panel_h, 0, 0);
+    int merged = 1;
+    while (merged) {
+        merged = 0;
+        for (int i = 0; i < damage_count; i++) {
+            if (!rect_intersects(damage_rects[i], r)) continue;
+            r = rect_union(damage_rects[i], r);
+            damage_rects[i] = damage_rects[--damage_count];
+            merged = 1;
+            break;
+        }
     }
-    XFlush(dpy);
+    if (damage_count >= PANEL_DAMAGE_MAX) {
+        for (int i = 0; i < damage_count; i++) r = rect_union(damage_rects[i], r);
+        damage_count = 0;
+    }
+    damage_rects[damage_count++] = r;
 }
 
-static void redraw_clock_only(void) {
-    if (!surface || !settings.clock_enabled) return;
+void panel_damage_all(void) {
+    Rect full = {0, 0, panel_w, panel_h};
+    damage_count = 0;
+    panel_damage(full);
+}
+
+static int is_damaged(Rect r) {
+    if (r.w <= 0 || r.h <= 0) return 0;
+    for (int i = 0; i < damage_count; i++) {
+        if (rect_intersects(damage_rects[i], r)) return 1;
+    }
+    return 0;
+}
+
+static void present_rect(Rect r) {
+    if (back_pixmap == None || r.w <= 0 || r.h <= 0) return;
+    XCopyArea(dpy, back_pixmap, win, back_gc, r.x, r.y, (unsigned int)r.w, (unsigned int)r.h, r.x, r.y);
+}
+
+static void redraw_damage(void) {
+    if (!surface || damage_count == 0) return;
+    unsigned long rt_start = x_roundtrips;
 
     cairo_save(cr);
-    cairo_rectangle(cr, clock_rect.x, clock_rect.y, clock_rect.w, clock_rect.h);
+    for (int i = 0; i < damage_count; i++) {
+        cairo_rectangle(cr, damage_rects[i].x, damage_rects[i].y, damage_rects[i].w, damage_rects[i].h);
+    }
     cairo_clip(cr);
 
-    draw_rect(cr, clock_rect, color_bg, 1);
-    clock_draw();
+    Rect full = {0, 0, panel_w, panel_h};
+    draw_rect(cr, full, color_bg, 1);
+
+    if (is_damaged(launcher_rect)) menu_draw();
+    for (int i = 0; i < client_count; i++) {
+        if (is_damaged(task_rects[i])) tasklist_draw_one(i);
+    }
+    if (is_damaged(clock_rect)) clock_draw();
+    if (is_damaged(launcher_sep_rect)) draw_rect(cr, launcher_sep_rect, color_sep, 1);
+    if (is_damaged(launcher_sep_soft_rect)) draw_rect(cr, launcher_sep_soft_rect, color_sep_soft, 1);
+    if (is_damaged(clock_sep_rect)) draw_rect(cr, clock_sep_rect, color_sep, 1);
+    if (is_damaged(clock_sep_soft_rect)) draw_rect(cr, clock_sep_soft_rect, color_sep_soft, 1);
 
     cairo_restore(cr);
     cairo_surface_flush(surface);
 
-    if (back_pixmap != None) {
-        XCopyArea(dpy,
-                  back_pixmap,
-                  win,
-                  back_gc,
-                  clock_rect.x,
-                  clock_rect.y,
-                  (unsigned int)clock_rect.w,
-                  (unsigned int)clock_rect.h,
-                  clock_rect.x,
-                  clock_rect.y);
+    unsigned long pixels = 0;
+    for (int i = 0; i < damage_count; i++) {
+        present_rect(damage_rects[i]);
+        pixels += (unsigned long)damage_rects[i].w * (unsigned long)damage_rects[i].h;
     }
     XFlush(dpy);
-    if (mem_debug_enabled) mem_debug_print_stats("clock_redraw");
+
+    damage_pixels_last = pixels;
+    damage_pixels_total += pixels;
+    damage_frames++;
+    debug_log("nizam-panel: repaint %d rect(s) %lu px of %lu\n",
+              damage_count, pixels, (unsigned long)panel_w * (unsigned long)panel_h);
+    damage_count = 0;
+    note_redraw_roundtrips(rt_start, "redraw");
+}
+
+static void redraw(void) {
+    panel_damage_all();
+    redraw_damage();
+}
+
+static void damage_dirty_tasks(void) {
+    if (!settings.taskbar_enabled) return;
+    if (tasklist_refresh_dirty() == 0) return;
+    for (int i = 0; i < client_count; i++) {
+        if (!clients[i].dirty) continue;
+        clients[i].dirty = 0;
+        panel_damage(task_rects[i]);
+    }
 }
 
 static void recreate_backbuffer(void) {
@@ -1692,11 +1788,11 @@ static void recreate_backbuffer(void) {
 static void update_struts(void) {
     unsigned long strut[12] = {0};
     if (settings.position == PANEL_TOP) {
-        strut[2] = panel_h; 
+        strut[2] = panel_y + panel_h;
         strut[8] = panel_x;
         strut[9] = panel_x + panel_w - 1;
     } else {
-        strut[3] = panel_h; 
+        strut[3] = DisplayHeight(dpy, screen) - panel_y;
         strut[10] = panel_x;
         strut[11] = panel_x + panel_w - 1;
     }
@@ -1753,6 +1849,11 @@ static void init_window(void) {
 }
 
 static void cleanup(void) {
+    for (int i = 0; i < monitor_child_count; i++) {
+        kill(monitor_children[i], SIGTERM);
+    }
+    nizam_monitors_free(&panel_monitors);
+    if (dpy) menu_cleanup();
     if (layout_clock) g_object_unref(layout_clock);
     if (layout_title) g_object_unref(layout_title);
     if (layout_status) g_object_unref(layout_status);
@@ -1761,6 +1862,8 @@ static void cleanup(void) {
         panel_font_desc = NULL;
     }
     icon_cache_destroy_all();
+    icon_theme_cleanup();
+    app_icons_cleanup();
     if (cr) cairo_destroy(cr);
     if (surface) cairo_surface_destroy(surface);
     if (back_pixmap != None) XFreePixmap(dpy, back_pixmap);
@@ -1769,9 +1872,23 @@ static void cleanup(void) {
 }
 
 int main(int argc, char **argv) {
-    
-    
+    const char *monitor_arg = NULL;
+    const char *monitors_spec = getenv("NIZAM_PANEL_MONITORS");
+    pid_t parent_pid = 0;
+
     for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--monitor") == 0 && (i + 1) < argc) {
+            monitor_arg = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--monitors") == 0 && (i + 1) < argc) {
+            monitors_spec = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--parent-pid") == 0 && (i + 1) < argc) {
+            parent_pid = (pid_t)atoi(argv[++i]);
+            continue;
+        }
         if (strcmp(argv[i], "--debug-stats") == 0 || strcmp(argv[i], "--mem-stats") == 0) {
             pid_t pids[32];
             int n = find_nizam_panel_pids(pids, (int)(sizeof(pids) / sizeof(pids[0])));
@@ -1797,6 +1914,11 @@ int main(int argc, char **argv) {
         }
     }
 
+    if (parent_pid > 0) {
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (getppid() != parent_pid) return 0;
+    }
+
     dpy = XOpenDisplay(NULL);
     if (!dpy) {
         fprintf(stderr, "nizam-panel: cannot open display\n");
@@ -1817,17 +1939,36 @@ int main(int argc, char **argv) {
     sigemptyset(&sa.sa_mask);
     sa.sa_flags = SA_RESTART;
     sigaction(SIGUSR1, &sa, NULL);
+    sa.sa_handler = on_sigterm;
+    sa.sa_flags = 0;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
 
     setup_atoms();
     load_settings(&settings);
+    palette_init();
     if (!settings.panel_enabled) {
         fprintf(stderr, "nizam-panel: disabled by config\n");
         cleanup();
         return 0;
     }
 
+    int rr_error_base = 0;
+    if (XRRQueryExtension(dpy, &rr_event_base, &rr_error_base)) {
+        XRRSelectInput(dpy, root, RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+    } else {
+        rr_event_base = -1;
+    }
+    nizam_monitors_init(&panel_monitors);
+    refresh_monitors();
+    if (monitor_arg) {
+        snprintf(settings.monitor, sizeof(settings.monitor), "%s", monitor_arg);
+    } else {
+        spawn_monitor_instances(monitors_spec);
+    }
+
     init_window();
-    update_clients(1);
+    update_clients();
     update_layout();
     redraw();
 
@@ -1837,10 +1978,17 @@ int main(int argc, char **argv) {
     int64_t next_clock_ms = next_clock_deadline_ms();
     int64_t last_rt_ms = now_realtime_ms();
     int64_t next_icon_cache_log_ms = now_ms() + 30000;
+    int tasks_pending = 0;
+    int64_t last_task_paint_ms = 0;
+    int64_t menu_preload_due_ms = settings.launcher_enabled ? now_ms() + MENU_PRELOAD_DELAY_MS : 0;
     while (running) {
         int need_redraw = 0;
         int need_layout = 0;
         int need_clock_only = 0;
+        int need_clients = 0;
+        int need_monitors = 0;
+        int has_expose = 0;
+        Rect expose_rect = {0, 0, 0, 0};
 
         if (mem_debug_toggle_requested) {
             mem_debug_toggle_requested = 0;
@@ -1905,6 +2053,22 @@ int main(int argc, char **argv) {
         fd_set fds;
         FD_ZERO(&fds);
         FD_SET(xfd, &fds);
+        int ifd = icon_theme_watch_fd();
+        int afd = app_icons_watch_fd();
+        int mfd = settings.launcher_enabled ? menu_watch_fd() : -1;
+        int maxfd = xfd;
+        if (ifd >= 0) {
+            FD_SET(ifd, &fds);
+            if (ifd > maxfd) maxfd = ifd;
+        }
+        if (afd >= 0) {
+            FD_SET(afd, &fds);
+            if (afd > maxfd) maxfd = afd;
+        }
+        if (mfd >= 0) {
+            FD_SET(mfd, &fds);
+            if (mfd > maxfd) maxfd = mfd;
+        }
         struct timeval tv;
         
         int64_t timeout_ms = 250;
@@ -1914,10 +2078,31 @@ int main(int argc, char **argv) {
             if (diff < 0) diff = 0;
             timeout_ms = diff;
         }
+        if (tasks_pending) {
+            int64_t wait = last_task_paint_ms + TASK_FRAME_MS - now_ms();
+            if (wait < 0) wait = 0;
+            if (wait < timeout_ms) timeout_ms = wait;
+        }
+        if (menu_preload_due_ms) {
+            int64_t wait = menu_preload_due_ms - now_ms();
+            if (wait < 0) wait = 0;
+            if (wait < timeout_ms) timeout_ms = wait;
+        }
         if (timeout_ms > 60000) timeout_ms = 60000;
         tv.tv_sec = (int)(timeout_ms / 1000);
         tv.tv_usec = (int)((timeout_ms % 1000) * 1000);
-        int r = select(xfd + 1, &fds, NULL, NULL, &tv);
+        int r = select(maxfd + 1, &fds, NULL, NULL, &tv);
+        nizam_launch_reap();
+        if (monitor_child_count > 0) reap_monitor_instances();
+        if (menu_preload_due_ms && r == 0 && now_ms() >= menu_preload_due_ms) {
+            menu_preload_due_ms = 0;
+            menu_model_preload();
+        }
+        if (r > 0 && ifd >= 0 && FD_ISSET(ifd, &fds) && icon_theme_handle_watch()) {
+            icon_cache_destroy_all();
+        }
+        if (r > 0 && afd >= 0 && FD_ISSET(afd, &fds)) app_icons_handle_watch();
+        if (r > 0 && mfd >= 0 && FD_ISSET(mfd, &fds)) menu_handle_watch();
         if (r > 0 && FD_ISSET(xfd, &fds)) {
             while (XPending(dpy)) {
                 XEvent ev;
@@ -1928,10 +2113,20 @@ int main(int argc, char **argv) {
                     continue;
                 }
 
-                if (ev.type == Expose) {
-                    if (ev.xexpose.window == win) need_redraw = 1;
+                if (handle_randr_event(&ev)) {
+                    need_monitors = 1;
+                } else if (ev.type == Expose) {
+                    if (ev.xexpose.window == win) {
+                        Rect r = {ev.xexpose.x, ev.xexpose.y, ev.xexpose.width, ev.xexpose.height};
+                        expose_rect = has_expose ? rect_union(expose_rect, r) : r;
+                        has_expose = 1;
+                    }
                 } else if (ev.type == VisibilityNotify) {
-                    if (ev.xvisibility.window == win) need_redraw = 1;
+                    if (ev.xvisibility.window == win) {
+                        Rect r = {0, 0, panel_w, panel_h};
+                        expose_rect = r;
+                        has_expose = 1;
+                    }
                 } else if (ev.type == ClientMessage) {
                     if (ev.xclient.message_type == A_NIZAM_PANEL_REDRAW) {
                         need_redraw = 1;
@@ -1951,29 +2146,48 @@ int main(int argc, char **argv) {
                 } else if (ev.type == PropertyNotify) {
                     if (ev.xproperty.window == root) {
                         if (ev.xproperty.atom == A_NET_CLIENT_LIST) {
-                            update_clients(0);
-                            need_layout = 1;
-                            need_redraw = 1;
+                            need_clients = 1;
                         } else if (ev.xproperty.atom == A_NET_ACTIVE_WINDOW) {
-                            tasklist_update_active();
-                            need_redraw = 1;
+                            if (tasklist_update_active()) tasks_pending = 1;
                         }
                     } else {
-                        
+                        int flag = tasklist_handle_property(ev.xproperty.window, ev.xproperty.atom);
+                        if (flag == CLIENT_DIRTY_REPROBE) need_clients = 1;
+                        else if (flag) tasks_pending = 1;
                     }
                 } else if (ev.type == MapNotify || ev.type == UnmapNotify || ev.type == DestroyNotify) {
-                    update_clients(0);
-                    need_layout = 1;
-                    need_redraw = 1;
+                    need_clients = 1;
                 }
             }
         }
 
-        if (need_layout) update_layout();
-        
-        menu_poll_live_updates();
-        if (need_redraw) redraw();
-        else if (need_clock_only) redraw_clock_only();
+        if (need_clients && update_clients()) {
+            need_layout = 1;
+            need_redraw = 1;
+        }
+
+        if (need_layout || need_monitors) {
+            update_layout();
+            if (need_monitors) update_struts();
+            need_redraw = 1;
+        }
+        if (need_redraw) panel_damage_all();
+        if (need_clock_only) panel_damage(clock_rect);
+        if (tasks_pending && (need_redraw || now_ms() - last_task_paint_ms >= TASK_FRAME_MS)) {
+            damage_dirty_tasks();
+            tasks_pending = 0;
+            last_task_paint_ms = now_ms();
+        }
+        redraw_damage();
+        if (has_expose) {
+            if (back_pixmap == None) {
+                panel_damage(expose_rect);
+                redraw_damage();
+            } else {
+                present_rect(expose_rect);
+                XFlush(dpy);
+            }
+        }
     }
 
     cleanup();
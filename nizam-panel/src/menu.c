@@ -1,8 +1,9 @@
 #include "panel_shared.h"
+#include "nizam_launch.h"
 
 #include <X11/keysym.h>
-#include <fcntl.h>
 #include <sqlite3.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -36,11 +37,17 @@ static cairo_t *sub_cr = NULL;
 static PangoLayout *cat_layout = NULL;
 static PangoLayout *sub_layout = NULL;
 static int apps_visible = 0;
-static int64_t live_reload_last_ms = 0;
 static int64_t live_last_db_stamp = -1;
+static int64_t live_data_version = -1;
+static int64_t menu_event_us = 0;
+static sqlite3 *live_db = NULL;
+static int live_watch_fd = -1;
+static int live_watch_tried = 0;
+static char live_db_name[256];
 
 static int get_nizam_db_path(char *out, size_t out_sz);
 static int sqlite_column_exists(sqlite3 *db, const char *table, const char *column);
+static void menu_check_live_updates(void);
 
 static int64_t live_now_ms(void) {
     struct timespec ts;
@@ -48,19 +55,43 @@ static int64_t live_now_ms(void) {
     return (int64_t)ts.tv_sec * 1000 + (int64_t)ts.tv_nsec / 1000000;
 }
 
-static int64_t fetch_desktop_entries_stamp(void) {
+static sqlite3 *menu_db_open(void) {
+    if (live_db) return live_db;
+
     char db_path[1024];
-    if (!get_nizam_db_path(db_path, sizeof(db_path))) return -1;
+    if (!get_nizam_db_path(db_path, sizeof(db_path))) return NULL;
 
     sqlite3 *db = NULL;
     if (sqlite3_open_v2(db_path, &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
         if (db) sqlite3_close(db);
-        return -1;
+        return NULL;
     }
 
     sqlite3_busy_timeout(db, 2000);
     (void)sqlite3_exec(db, "PRAGMA query_only=ON;", NULL, NULL, NULL);
+    live_db = db;
+    return live_db;
+}
+
+static void menu_db_close(void) {
+    if (live_db) {
+        sqlite3_close(live_db);
+        live_db = NULL;
+    }
+    live_data_version = -1;
+}
 
+static int64_t fetch_data_version(sqlite3 *db) {
+    sqlite3_stmt *st = NULL;
+    int64_t v = -1;
+    if (sqlite3_prepare_v2(db, "PRAGMA data_version", -1, &st, NULL) == SQLITE_OK && st) {
+        if (sqlite3_step(st) == SQLITE_ROW) v = sqlite3_column_int64(st, 0);
+        sqlite3_finalize(st);
+    }
+    return v;
+}
+
+static int64_t fetch_desktop_entries_stamp(sqlite3 *db) {
     int has_deleted = sqlite_column_exists(db, "desktop_entries", "deleted");
     const char *where_deleted = has_deleted ? " WHERE coalesce(deleted,0)=0" : "";
 
@@ -82,8 +113,6 @@ static int64_t fetch_desktop_entries_stamp(void) {
         }
         sqlite3_finalize(st);
     }
-
-    sqlite3_close(db);
     return stamp;
 }
 
@@ -110,6 +139,8 @@ static AppEntry top_tools[4];
 
 static AppEntry *apps = NULL;
 static int apps_count = 0;
+static int apps_cap = 0;
+static int model_loaded = 0;
 static CategoryGroup *cats = NULL;
 static int cat_count = 0;
 static MenuItem *cat_items = NULL;
@@ -121,6 +152,12 @@ static const char *MENU_DIM = "#c0c5c9";
 static const char *MENU_BORDER = "#1c1f21";
 static const char *MENU_BG = "#2e3436";
 
+void menu_palette_init(void) {
+    palette_register(MENU_DIM);
+    palette_register(MENU_BORDER);
+    palette_register(MENU_BG);
+}
+
 #ifndef NIZAM_PANEL_VERSION
 #define NIZAM_PANEL_VERSION "0.1.0"
 #endif
@@ -198,11 +235,7 @@ static int sqlite_column_exists(sqlite3 *db, const char *table, const char *colu
 
 static void draw_menu_border(cairo_t *c, int w, int h, const char *hex) {
     if (!c || w <= 0 || h <= 0) return;
-    unsigned long pixel = parse_color(dpy, hex);
-    XColor xc;
-    xc.pixel = pixel;
-    XQueryColor(dpy, DefaultColormap(dpy, screen), &xc);
-    cairo_set_source_rgb(c, xc.red / 65535.0, xc.green / 65535.0, xc.blue / 65535.0);
+    palette_set_source(c, hex);
     cairo_set_antialias(c, CAIRO_ANTIALIAS_NONE);
     cairo_set_line_width(c, 1.0);
     cairo_rectangle(c, 0.5, 0.5, (double)w - 1.0, (double)h - 1.0);
@@ -229,11 +262,7 @@ static cairo_surface_t *load_menu_icon_prefer_symbolic(const char *name, int siz
 
 static void draw_menu_triangle(cairo_t *c, int x, int y, int w, int h, int dir_left, const char *hex) {
     if (!c || w <= 0 || h <= 0) return;
-    unsigned long pixel = parse_color(dpy, hex);
-    XColor xc;
-    xc.pixel = pixel;
-    XQueryColor(dpy, DefaultColormap(dpy, screen), &xc);
-    cairo_set_source_rgb(c, xc.red / 65535.0, xc.green / 65535.0, xc.blue / 65535.0);
+    palette_set_source(c, hex);
 
     cairo_new_path(c);
     if (dir_left) {
@@ -472,7 +501,21 @@ static const char *category_icon_name(const char *cat) {
     return "nizam-system";
 }
 
-static void apps_free(void) {
+static void menu_view_reset(void) {
+    if (sub_items) {
+        free(sub_items);
+        sub_items = NULL;
+        sub_item_count = 0;
+    }
+    cat_scroll = 0;
+    cat_hover = -1;
+    sub_scroll = 0;
+    sub_content_h = 0;
+    sub_hover = -1;
+    active_category = 0;
+}
+
+static void menu_model_free(void) {
     
     for (int i = 0; i < TOP_TOOLS_COUNT; i++) {
         if (top_tools[i].icon_surf) {
@@ -491,11 +534,7 @@ static void apps_free(void) {
         cat_items = NULL;
         cat_item_count = 0;
     }
-    if (sub_items) {
-        free(sub_items);
-        sub_items = NULL;
-        sub_item_count = 0;
-    }
+    menu_view_reset();
     if (cats) {
         free(cats);
         cats = NULL;
@@ -508,14 +547,10 @@ static void apps_free(void) {
         free(apps);
         apps = NULL;
         apps_count = 0;
+        apps_cap = 0;
     }
-    cat_scroll = 0;
     cat_content_h = 0;
-    cat_hover = -1;
-    sub_scroll = 0;
-    sub_content_h = 0;
-    sub_hover = -1;
-    active_category = 0;
+    model_loaded = 0;
 }
 
 static void init_top_tools(void) {
@@ -592,19 +627,8 @@ static int get_nizam_db_path(char *out, size_t out_sz) {
 }
 
 static void scan_apps_from_sqlite(void) {
-    char db_path[1024];
-    if (!get_nizam_db_path(db_path, sizeof(db_path))) return;
-
-    sqlite3 *db = NULL;
-    
-    
-    if (sqlite3_open_v2(db_path, &db, SQLITE_OPEN_READWRITE, NULL) != SQLITE_OK) {
-        if (db) sqlite3_close(db);
-        return;
-    }
-
-    sqlite3_busy_timeout(db, 2000);
-    (void)sqlite3_exec(db, "PRAGMA query_only=ON;", NULL, NULL, NULL);
+    sqlite3 *db = menu_db_open();
+    if (!db) return;
 
     int has_user_name = sqlite_column_exists(db, "desktop_entries", "user_name");
     int has_user_exec = sqlite_column_exists(db, "desktop_entries", "user_exec");
@@ -633,7 +657,7 @@ static void scan_apps_from_sqlite(void) {
 
     sqlite3_stmt *st = NULL;
     if (sqlite3_prepare_v2(db, sql_buf, -1, &st, NULL) != SQLITE_OK) {
-        sqlite3_close(db);
+        menu_db_close();
         return;
     }
 
@@ -665,14 +689,17 @@ static void scan_apps_from_sqlite(void) {
 
         e.icon_surf = NULL;
 
-        AppEntry *n = realloc(apps, sizeof(AppEntry) * (apps_count + 1));
-        if (!n) break;
-        apps = n;
+        if (apps_count == apps_cap) {
+            int next = apps_cap ? apps_cap * 2 : 64;
+            AppEntry *n = realloc(apps, sizeof(AppEntry) * (size_t)next);
+            if (!n) break;
+            apps = n;
+            apps_cap = next;
+        }
         apps[apps_count++] = e;
     }
 
     sqlite3_finalize(st);
-    sqlite3_close(db);
 }
 
 static int app_cmp2(const void *a, const void *b) {
@@ -841,19 +868,10 @@ static void build_sub_items_for(int cat_idx) {
 
 static void apps_spawn(const char *cmd) {
     if (!cmd || cmd[0] == '\0') return;
-    pid_t pid = fork();
-    if (pid == 0) {
-        
-        setsid();
-        int fd = open("/dev/null", O_RDWR);
-        if (fd >= 0) {
-            dup2(fd, STDIN_FILENO);
-            dup2(fd, STDOUT_FILENO);
-            dup2(fd, STDERR_FILENO);
-            if (fd > STDERR_FILENO) close(fd);
-        }
-        execl("/bin/sh", "sh", "-lc", cmd, (char *)NULL);
-        _exit(127);
+    if (nizam_launch_spawn(cmd, menu_event_us, NIZAM_LAUNCH_QUIET) > 0) {
+        struct nizam_launch_stats st;
+        nizam_launch_get_stats(&st);
+        debug_log("nizam-panel: launched \"%s\" in %lld us\n", cmd, (long long)st.last_us);
     }
 }
 
@@ -928,11 +946,7 @@ static void draw_menu_list(cairo_t *c, PangoLayout **layout_ptr,
         pango_layout_set_width(*layout_ptr, (ww - text_x - pad) * PANGO_SCALE);
         pango_layout_set_ellipsize(*layout_ptr, PANGO_ELLIPSIZE_END);
 
-        unsigned long pixel = parse_color(dpy, fg);
-        XColor xc;
-        xc.pixel = pixel;
-        XQueryColor(dpy, DefaultColormap(dpy, screen), &xc);
-        cairo_set_source_rgb(c, xc.red / 65535.0, xc.green / 65535.0, xc.blue / 65535.0);
+        palette_set_source(c, fg);
 
         int tw = 0, th = 0;
         pango_layout_get_pixel_size(*layout_ptr, &tw, &th);
@@ -964,11 +978,7 @@ static void draw_menu_list(cairo_t *c, PangoLayout **layout_ptr,
         if (sep_y > hh - 2) sep_y = hh - 2;
 
         
-        unsigned long pixel = parse_color(dpy, MENU_BORDER);
-        XColor xc;
-        xc.pixel = pixel;
-        XQueryColor(dpy, DefaultColormap(dpy, screen), &xc);
-        cairo_set_source_rgb(c, xc.red / 65535.0, xc.green / 65535.0, xc.blue / 65535.0);
+        palette_set_source(c, MENU_BORDER);
         cairo_set_antialias(c, CAIRO_ANTIALIAS_NONE);
         cairo_set_line_width(c, 1.0);
         cairo_move_to(c, 0.0, sep_y + 0.5);
@@ -987,10 +997,7 @@ static void draw_menu_list(cairo_t *c, PangoLayout **layout_ptr,
         pango_layout_set_alignment(f, PANGO_ALIGN_CENTER);
         pango_layout_set_text(f, footer_text, -1);
 
-        pixel = parse_color(dpy, MENU_DIM);
-        xc.pixel = pixel;
-        XQueryColor(dpy, DefaultColormap(dpy, screen), &xc);
-        cairo_set_source_rgb(c, xc.red / 65535.0, xc.green / 65535.0, xc.blue / 65535.0);
+        palette_set_source(c, MENU_DIM);
 
         int tw = 0, th = 0;
         pango_layout_get_pixel_size(f, &tw, &th);
@@ -1071,7 +1078,7 @@ static void apps_close(void) {
         XDestroyWindow(dpy, cat_win);
         cat_win = None;
     }
-    apps_free();
+    menu_view_reset();
 }
 
 static int clamp_menu_y_gap(int y, int h, int gap_px) {
@@ -1118,21 +1125,44 @@ static void position_submenu(int cat_x, int cat_y) {
     }
 }
 
-static void apps_open(void) {
-    apps_close();
-
-    apps_free();
-
-    
+static void menu_model_load(void) {
+    int64_t t0 = live_now_ms();
+    menu_model_free();
+    sqlite3 *db = menu_db_open();
+    if (db) {
+        live_data_version = fetch_data_version(db);
+        live_last_db_stamp = fetch_desktop_entries_stamp(db);
+    }
     scan_apps_from_sqlite();
-    live_reload_last_ms = live_now_ms();
-    live_last_db_stamp = fetch_desktop_entries_stamp();
-
     if (apps_count > 0) {
         build_categories();
     }
     build_category_items();
-    active_category = 0;
+    model_loaded = 1;
+    debug_log("nizam-panel: menu model loaded apps=%d categories=%d in %lldms\n",
+              apps_count, cat_count, (long long)(live_now_ms() - t0));
+}
+
+void menu_model_preload(void) {
+    if (!model_loaded) menu_model_load();
+}
+
+void menu_cleanup(void) {
+    apps_close();
+    menu_model_free();
+    menu_db_close();
+    if (live_watch_fd >= 0) {
+        close(live_watch_fd);
+        live_watch_fd = -1;
+    }
+}
+
+static void apps_open(void) {
+    apps_close();
+
+    if (!model_loaded) menu_model_load();
+    else if (live_watch_fd < 0) menu_check_live_updates();
+    menu_view_reset();
 
     
     
@@ -1211,6 +1241,7 @@ static void apps_open(void) {
     
     
     
+    x_roundtrips++;
     XGrabPointer(dpy, cat_win, False,
                  ButtonPressMask | ButtonReleaseMask | PointerMotionMask,
                  GrabModeSync, GrabModeAsync, None, None, CurrentTime);
@@ -1221,28 +1252,19 @@ static void apps_open(void) {
     cat_redraw();
 }
 
-void menu_poll_live_updates(void) {
-    if (!apps_visible) return;
+static void menu_check_live_updates(void) {
+    sqlite3 *db = menu_db_open();
+    if (!db) return;
 
-    
-    
-    
-    
-    int64_t now = live_now_ms();
-    if (live_reload_last_ms != 0 && (now - live_reload_last_ms) < 500) {
-        return;
-    }
-    live_reload_last_ms = now;
+    int64_t version = fetch_data_version(db);
+    if (version != -1 && version == live_data_version) return;
+    live_data_version = version;
 
-    
-    int64_t stamp = fetch_desktop_entries_stamp();
-    if (stamp != -1 && stamp == live_last_db_stamp) {
-        return;
-    }
-    live_last_db_stamp = stamp;
+    int64_t stamp = fetch_desktop_entries_stamp(db);
+    if (stamp != -1 && stamp == live_last_db_stamp) return;
+    debug_log("nizam-panel: desktop_entries changed (data_version=%lld), reloading menu model\n",
+              (long long)version);
 
-    
-    
     if (sub_layout) {
         g_object_unref(sub_layout);
         sub_layout = NULL;
@@ -1260,20 +1282,50 @@ void menu_poll_live_updates(void) {
         sub_win = None;
     }
 
-    apps_free();
-    scan_apps_from_sqlite();
-    if (apps_count > 0) {
-        build_categories();
-    }
-    build_category_items();
-    if (active_category < 0) active_category = 0;
-    if (active_category >= cat_count) active_category = 0;
-    cat_scroll = 0;
-    sub_scroll = 0;
+    menu_model_load();
+    menu_view_reset();
 
     cat_redraw();
 }
 
+int menu_watch_fd(void) {
+    if (live_watch_fd >= 0 || live_watch_tried) return live_watch_fd;
+    live_watch_tried = 1;
+
+    char db_path[1024];
+    if (!get_nizam_db_path(db_path, sizeof(db_path))) return -1;
+    char *slash = strrchr(db_path, '/');
+    if (!slash || slash == db_path) return -1;
+    snprintf(live_db_name, sizeof(live_db_name), "%s", slash + 1);
+    *slash = '\0';
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return -1;
+    if (inotify_add_watch(fd, db_path, IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        close(fd);
+        return -1;
+    }
+    live_watch_fd = fd;
+    return live_watch_fd;
+}
+
+void menu_handle_watch(void) {
+    if (live_watch_fd < 0) return;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    size_t name_len = strlen(live_db_name);
+    int touched = 0;
+    for (;;) {
+        ssize_t n = read(live_watch_fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        for (char *p = buf; p < buf + n;) {
+            struct inotify_event *ev = (struct inotify_event *)p;
+            if (ev->len > 0 && strncmp(ev->name, live_db_name, name_len) == 0) touched = 1;
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    if (touched && model_loaded) menu_check_live_updates();
+}
+
 static void allow_pointer_async(XEvent *ev) {
     if (!ev) return;
     Time t = CurrentTime;
@@ -1288,6 +1340,7 @@ static int root_xy_in_window(Window win, int root_x, int root_y, int *out_x, int
     Window dummy;
     int wx = 0, wy = 0;
     unsigned int ww = 0, hh = 0, bw = 0, depth = 0;
+    x_roundtrips++;
     if (!XGetGeometry(dpy, win, &dummy, &wx, &wy, &ww, &hh, &bw, &depth)) return 0;
     if (root_x < wx || root_y < wy) return 0;
     if (root_x >= wx + (int)ww || root_y >= wy + (int)hh) return 0;
@@ -1351,6 +1404,7 @@ int menu_handle_click(int x, int y) {
 
 int menu_handle_xevent(XEvent *ev) {
     if (!apps_visible) return 0;
+    menu_event_us = nizam_launch_now_us();
 
     if (cat_win == None) return 0;
     int on_cat = (ev->xany.window == cat_win);
@@ -1468,6 +1522,7 @@ int menu_handle_xevent(XEvent *ev) {
                 Window dummy;
                 int wx, wy;
                 unsigned int ww, hh, bw, depth;
+                x_roundtrips++;
                 if (XGetGeometry(dpy, cat_win, &dummy, &wx, &wy, &ww, &hh, &bw, &depth)) {
                     position_submenu(wx, wy);
                 }
@@ -1513,6 +1568,7 @@ int menu_handle_xevent(XEvent *ev) {
                     Window dummy;
                     int wx, wy;
                     unsigned int ww, hh, bw, depth;
+                    x_roundtrips++;
                     if (XGetGeometry(dpy, cat_win, &dummy, &wx, &wy, &ww, &hh, &bw, &depth)) {
                         cat_x = wx;
                         cat_y = wy;
@@ -1578,6 +1634,7 @@ int menu_handle_xevent(XEvent *ev) {
             Window dummy;
             int cat_x = 0, cat_y = 0;
             unsigned int ww, hh, bw, depth;
+            x_roundtrips++;
             if (XGetGeometry(dpy, cat_win, &dummy, &cat_x, &cat_y, &ww, &hh, &bw, &depth)) {
                 
                 if (sub_win == None) {
@@ -17,6 +17,7 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/select.h>
+#include <signal.h>
 #include <ctype.h>
 
 
@@ -47,7 +48,7 @@ typedef struct {
     PanelEdge position;
     int height;
     int padding;
-    int monitor;
+    char monitor[32];
     int launcher_enabled;
     char launcher_cmd[256];
     char launcher_label[128];
@@ -63,12 +64,19 @@ typedef struct {
 
 typedef struct {
     Window win;
+    Window frame;
     char title[256];
     int is_active;
     int skip_taskbar;
+    int dirty;
     cairo_surface_t *icon;
 } ClientItem;
 
+#define CLIENT_DIRTY_TITLE 1
+#define CLIENT_DIRTY_ICON 2
+#define CLIENT_DIRTY_STATE 4
+#define CLIENT_DIRTY_REPROBE 8
+
 typedef struct {
     Window win;
     int desktop;
@@ -105,6 +113,7 @@ extern Rect clock_rect;
 extern Atom A_NET_CLIENT_LIST;
 extern Atom A_NET_ACTIVE_WINDOW;
 extern Atom A_NET_WM_NAME;
+extern Atom A_NET_WM_ICON;
 extern Atom A_UTF8_STRING;
 extern Atom A_NET_WM_STATE;
 extern Atom A_NET_WM_STATE_SKIP_TASKBAR;
@@ -128,7 +137,7 @@ extern Atom A_NET_DESKTOP_VIEWPORT;
 extern Atom A_NET_DESKTOP_GEOMETRY;
 extern Atom A_WIN_WORKSPACE;
 
-extern int running;
+extern volatile sig_atomic_t running;
 extern time_t last_clock_tick;
 extern char clock_text[128];
 
@@ -137,9 +146,23 @@ extern const char *color_fg;
 extern const char *color_active;
 extern const char *color_active_text;
 
+#define NIZAM_PANEL_PALETTE_CAP 32
+
+typedef struct {
+    double r;
+    double g;
+    double b;
+    double a;
+} PanelRGBA;
+
+extern unsigned long x_roundtrips;
 
 int clamp_int(int v, int lo, int hi);
 unsigned long parse_color(Display *d, const char *hex);
+void palette_init(void);
+void palette_register(const char *hex);
+PanelRGBA palette_lookup(const char *hex);
+void palette_set_source(cairo_t *c, const char *hex);
 int get_root_cardinal(Atom prop, unsigned long *out);
 int point_in_rect(int x, int y, Rect r);
 
@@ -151,6 +174,8 @@ void set_current_desktop(int idx);
 void iconify_window(Window w);
 
 void draw_rect(cairo_t *c, Rect r, const char *hex, int fill);
+void panel_damage(Rect r);
+void panel_damage_all(void);
 
 typedef enum {
     PANEL_TEXT_CLOCK = 0,
@@ -186,15 +211,21 @@ void draw_triangle(int x, int y, int w, int h, int dir_left, const char *hex);
 void menu_draw(void);
 int menu_handle_click(int x, int y);
 int menu_handle_xevent(XEvent *ev);
-void menu_poll_live_updates(void);
+int menu_watch_fd(void);
+void menu_handle_watch(void);
+void menu_model_preload(void);
+void menu_cleanup(void);
+void menu_palette_init(void);
 
 void clock_update_text(void);
 void clock_draw(void);
 
 
-void tasklist_update_clients(void);
-void tasklist_update_active(void);
-void tasklist_draw(void);
+int tasklist_update_clients(void);
+int tasklist_update_active(void);
+void tasklist_draw_one(int i);
+int tasklist_handle_property(Window w, Atom atom);
+int tasklist_refresh_dirty(void);
 int tasklist_handle_click(int x, int y);
 
 
@@ -208,3 +239,16 @@ cairo_surface_t *load_icon_from_name(const char *name, int size);
 cairo_surface_t *load_window_icon(Window w, int size);
 cairo_surface_t *load_window_icon_hint(Window w, int size);
 int find_desktop_icon_for_class(const char *instance, const char *klass, char *out, size_t out_len);
+
+
+int icon_theme_lookup(const char *name, int size, char *out, size_t out_len);
+int icon_theme_watch_fd(void);
+int icon_theme_handle_watch(void);
+int icon_theme_file_count(void);
+unsigned long icon_theme_build_count(void);
+void icon_theme_cleanup(void);
+
+int app_icons_watch_fd(void);
+int app_icons_handle_watch(void);
+int app_icons_entry_count(void);
+void app_icons_cleanup(void);
@@ -1,195 +1,450 @@
 #include "panel_shared.h"
 
-static void free_client_icons(void) {
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+
+typedef struct {
+    Window frame;
+    Window win;
+    long wm_state;
+    int include;
+    char title[256];
+    char inst[64];
+    char klass[64];
+} ClientProbe;
+
+static ClientItem prev_clients[MAX_WINDOWS];
+static Window prev_order[MAX_WINDOWS];
+static int prev_client_count = 0;
+
+static ClientProbe probes[MAX_WINDOWS];
+static Window slot_frames[MAX_WINDOWS];
+static int slot_probe[MAX_WINDOWS];
+
+static int has_client_window(Window w) {
     for (int i = 0; i < client_count; i++) {
-        if (clients[i].icon) {
-            cairo_surface_destroy(clients[i].icon);
-            clients[i].icon = NULL;
-        }
+        if (clients[i].win == w) return 1;
     }
+    return 0;
 }
 
-static int get_wm_state(Window w, long *out_state) {
-    Atom type;
-    int fmt;
-    unsigned long nitems, bytes;
-    unsigned char *data = NULL;
-    if (XGetWindowProperty(dpy, w, A_WM_STATE, 0, 2, False, A_WM_STATE,
-                           &type, &fmt, &nitems, &bytes, &data) != Success) {
-        return 0;
-    }
+static xcb_get_property_reply_t *get_property_reply(xcb_connection_t *c, xcb_get_property_cookie_t ck) {
+    xcb_generic_error_t *err = NULL;
+    xcb_get_property_reply_t *r = xcb_get_property_reply(c, ck, &err);
+    free(err);
+    return r;
+}
+
+static int reply_wm_state(xcb_connection_t *c, xcb_get_property_cookie_t ck, long *out_state) {
+    xcb_get_property_reply_t *r = get_property_reply(c, ck);
+    if (!r) return 0;
     int ok = 0;
-    if (data && type == A_WM_STATE && fmt == 32 && nitems >= 1) {
-        *out_state = ((long *)data)[0];
+    if (r->type == (xcb_atom_t)A_WM_STATE && r->format == 32 && xcb_get_property_value_length(r) >= 4) {
+        *out_state = (long)((uint32_t *)xcb_get_property_value(r))[0];
         ok = 1;
     }
-    if (data) XFree(data);
+    free(r);
     return ok;
 }
 
-static int should_include_window(Window w) {
-    XWindowAttributes attr;
-    if (!XGetWindowAttributes(dpy, w, &attr)) return 0;
-    if (attr.override_redirect) return 0;
-
-    if (window_is_type(w, A_NET_WM_WINDOW_TYPE_DOCK) || window_is_type(w, A_NET_WM_WINDOW_TYPE_DESKTOP)) return 0;
-    if (window_has_state(w, A_NET_WM_STATE_SKIP_TASKBAR)) return 0;
+static int reply_has_atom(xcb_get_property_reply_t *r, Atom a) {
+    if (!r || r->type != XCB_ATOM_ATOM || r->format != 32) return 0;
+    int n = xcb_get_property_value_length(r) / 4;
+    const uint32_t *atoms = xcb_get_property_value(r);
+    for (int i = 0; i < n; i++) {
+        if (atoms[i] == (uint32_t)a) return 1;
+    }
+    return 0;
+}
 
-    long wm_state = 0;
-    if (!get_wm_state(w, &wm_state)) return 0;
-    if (wm_state != NormalState && wm_state != IconicState) return 0;
+static int reply_copy_string(xcb_get_property_reply_t *r, char *out, size_t out_len) {
+    if (!r || r->format != 8 || r->type == XCB_ATOM_NONE) return 0;
+    int len = xcb_get_property_value_length(r);
+    if (len <= 0) return 0;
+    size_t n = (size_t)len < out_len - 1 ? (size_t)len : out_len - 1;
+    memcpy(out, xcb_get_property_value(r), n);
+    out[n] = '\0';
+    for (size_t i = 0; i < n; i++) {
+        if (out[i] == '\n' || out[i] == '\r') out[i] = ' ';
+    }
+    return out[0] != '\0';
+}
 
-    return 1;
+static void reply_copy_class(xcb_get_property_reply_t *r, char *inst, size_t inst_len, char *klass, size_t klass_len) {
+    inst[0] = '\0';
+    klass[0] = '\0';
+    if (!r || r->format != 8) return;
+    int len = xcb_get_property_value_length(r);
+    const char *v = xcb_get_property_value(r);
+    if (len <= 0) return;
+    size_t n1 = strnlen(v, (size_t)len);
+    snprintf(inst, inst_len, "%.*s", (int)n1, v);
+    if ((int)n1 + 1 < len) {
+        const char *k = v + n1 + 1;
+        size_t n2 = strnlen(k, (size_t)len - n1 - 1);
+        snprintf(klass, klass_len, "%.*s", (int)n2, k);
+    }
 }
 
-static int has_client_window(Window w) {
-    for (int i = 0; i < client_count; i++) {
-        if (clients[i].win == w) return 1;
+static void resolve_probe_windows(xcb_connection_t *c, ClientProbe *p, int n) {
+    xcb_get_property_cookie_t state_ck[MAX_WINDOWS];
+    xcb_query_tree_cookie_t tree_ck[MAX_WINDOWS];
+    xcb_query_tree_reply_t *trees[MAX_WINDOWS];
+    xcb_get_property_cookie_t *child_ck[MAX_WINDOWS];
+
+    for (int i = 0; i < n; i++) {
+        p[i].win = None;
+        state_ck[i] = xcb_get_property(c, 0, (xcb_window_t)p[i].frame, (xcb_atom_t)A_WM_STATE,
+                                       (xcb_atom_t)A_WM_STATE, 0, 2);
+        tree_ck[i] = xcb_query_tree(c, (xcb_window_t)p[i].frame);
+    }
+    x_roundtrips++;
+
+    for (int i = 0; i < n; i++) {
+        trees[i] = NULL;
+        child_ck[i] = NULL;
+        if (reply_wm_state(c, state_ck[i], &p[i].wm_state)) {
+            p[i].win = p[i].frame;
+            xcb_discard_reply(c, tree_ck[i].sequence);
+            continue;
+        }
+        xcb_generic_error_t *err = NULL;
+        trees[i] = xcb_query_tree_reply(c, tree_ck[i], &err);
+        free(err);
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!trees[i]) continue;
+        int nchildren = xcb_query_tree_children_length(trees[i]);
+        if (nchildren <= 0) continue;
+        child_ck[i] = malloc(sizeof(*child_ck[i]) * (size_t)nchildren);
+        if (!child_ck[i]) continue;
+        xcb_window_t *children = xcb_query_tree_children(trees[i]);
+        for (int k = 0; k < nchildren; k++) {
+            child_ck[i][k] = xcb_get_property(c, 0, children[k], (xcb_atom_t)A_WM_STATE,
+                                              (xcb_atom_t)A_WM_STATE, 0, 2);
+        }
+    }
+    x_roundtrips++;
+
+    for (int i = 0; i < n; i++) {
+        if (!trees[i]) continue;
+        if (child_ck[i]) {
+            int nchildren = xcb_query_tree_children_length(trees[i]);
+            xcb_window_t *children = xcb_query_tree_children(trees[i]);
+            for (int k = 0; k < nchildren; k++) {
+                long state = 0;
+                if (p[i].win != None) {
+                    xcb_discard_reply(c, child_ck[i][k].sequence);
+                } else if (reply_wm_state(c, child_ck[i][k], &state)) {
+                    p[i].win = children[k];
+                    p[i].wm_state = state;
+                }
+            }
+            free(child_ck[i]);
+        }
+        free(trees[i]);
     }
-    return 0;
 }
 
-static Window find_client_window(Window w) {
-    long wm_state = 0;
-    if (get_wm_state(w, &wm_state)) {
-        return w;
+static void probe_clients(ClientProbe *p, int n) {
+    if (n <= 0) return;
+    xcb_connection_t *c = XGetXCBConnection(dpy);
+    resolve_probe_windows(c, p, n);
+
+    xcb_get_window_attributes_cookie_t attr_ck[MAX_WINDOWS];
+    xcb_get_property_cookie_t type_ck[MAX_WINDOWS];
+    xcb_get_property_cookie_t state_ck[MAX_WINDOWS];
+    xcb_get_property_cookie_t class_ck[MAX_WINDOWS];
+    xcb_get_property_cookie_t name_ck[MAX_WINDOWS];
+    xcb_get_property_cookie_t wm_name_ck[MAX_WINDOWS];
+
+    for (int i = 0; i < n; i++) {
+        p[i].include = 0;
+        if (p[i].win == None) continue;
+        xcb_window_t w = (xcb_window_t)p[i].win;
+        attr_ck[i] = xcb_get_window_attributes(c, w);
+        type_ck[i] = xcb_get_property(c, 0, w, (xcb_atom_t)A_NET_WM_WINDOW_TYPE, XCB_ATOM_ATOM, 0, 16);
+        state_ck[i] = xcb_get_property(c, 0, w, (xcb_atom_t)A_NET_WM_STATE, XCB_ATOM_ATOM, 0, 1024);
+        class_ck[i] = xcb_get_property(c, 0, w, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, 128);
+        name_ck[i] = xcb_get_property(c, 0, w, (xcb_atom_t)A_NET_WM_NAME, (xcb_atom_t)A_UTF8_STRING, 0, 1024);
+        wm_name_ck[i] = xcb_get_property(c, 0, w, XCB_ATOM_WM_NAME, XCB_ATOM_ANY, 0, 1024);
     }
+    x_roundtrips++;
 
-    Window root_ret, parent_ret;
-    Window *children = NULL;
-    unsigned int nchildren = 0;
-    if (!XQueryTree(dpy, w, &root_ret, &parent_ret, &children, &nchildren)) {
-        return None;
-    }
-    Window found = None;
-    for (unsigned int i = 0; i < nchildren; i++) {
-        if (get_wm_state(children[i], &wm_state)) {
-            found = children[i];
-            break;
+    for (int i = 0; i < n; i++) {
+        if (p[i].win == None) continue;
+        xcb_generic_error_t *err = NULL;
+        xcb_get_window_attributes_reply_t *attr = xcb_get_window_attributes_reply(c, attr_ck[i], &err);
+        free(err);
+        xcb_get_property_reply_t *type = get_property_reply(c, type_ck[i]);
+        xcb_get_property_reply_t *state = get_property_reply(c, state_ck[i]);
+        xcb_get_property_reply_t *klass = get_property_reply(c, class_ck[i]);
+        xcb_get_property_reply_t *name = get_property_reply(c, name_ck[i]);
+        xcb_get_property_reply_t *wm_name = get_property_reply(c, wm_name_ck[i]);
+
+        p[i].include = attr && !attr->override_redirect &&
+                       !reply_has_atom(type, A_NET_WM_WINDOW_TYPE_DOCK) &&
+                       !reply_has_atom(type, A_NET_WM_WINDOW_TYPE_DESKTOP) &&
+                       !reply_has_atom(state, A_NET_WM_STATE_SKIP_TASKBAR) &&
+                       (p[i].wm_state == NormalState || p[i].wm_state == IconicState);
+        if (p[i].include) {
+            p[i].title[0] = '\0';
+            if (!reply_copy_string(name, p[i].title, sizeof(p[i].title))) {
+                reply_copy_string(wm_name, p[i].title, sizeof(p[i].title));
+            }
+            reply_copy_class(klass, p[i].inst, sizeof(p[i].inst), p[i].klass, sizeof(p[i].klass));
         }
+
+        free(attr);
+        free(type);
+        free(state);
+        free(klass);
+        free(name);
+        free(wm_name);
     }
-    if (children) XFree(children);
-    return found;
 }
 
-static void add_client(Window w) {
-    if (client_count >= MAX_WINDOWS) return;
-    Window cw = find_client_window(w);
-    if (cw == None) return;
-    if (has_client_window(cw)) return;
-    if (!should_include_window(cw)) return;
+static cairo_surface_t *load_client_icon(Window cw, const char *inst, const char *klass) {
+    cairo_surface_t *icon = load_window_icon(cw, NIZAM_PANEL_ICON_PX);
+    if (!icon) icon = load_window_icon_hint(cw, NIZAM_PANEL_ICON_PX);
+    if (!icon) {
+        char inst_buf[64], klass_buf[64], icon_name[256];
+        if (!inst || !klass) {
+            get_window_class(cw, inst_buf, sizeof(inst_buf), klass_buf, sizeof(klass_buf));
+            inst = inst_buf;
+            klass = klass_buf;
+        }
+        if (find_desktop_icon_for_class(inst, klass, icon_name, sizeof(icon_name))) {
+            icon = load_icon_from_name(icon_name, NIZAM_PANEL_ICON_PX);
+        }
+    }
+    return icon;
+}
+
+static void load_client_title(ClientItem *c) {
+    get_window_title(c->win, c->title, sizeof(c->title));
+    if (c->title[0] == '\0') strcpy(c->title, "(untitled)");
+}
+
+static int find_prev_client(Window w) {
+    for (int i = 0; i < prev_client_count; i++) {
+        ClientItem *p = &prev_clients[i];
+        if (p->win == None) continue;
+        if (p->frame == w || p->win == w) return i;
+    }
+    return -1;
+}
+
+static void adopt_prev_client(int idx) {
+    ClientItem *p = &prev_clients[idx];
+    if (client_count < MAX_WINDOWS && !has_client_window(p->win)) clients[client_count++] = *p;
+    else if (p->icon) cairo_surface_destroy(p->icon);
+    p->win = None;
+    p->icon = NULL;
+}
+
+static int add_probed_client(const ClientProbe *pr) {
+    if (client_count >= MAX_WINDOWS) return 0;
+    if (!pr->include || pr->win == None) return 0;
+    if (has_client_window(pr->win)) return 0;
 
-    XSelectInput(dpy, cw, PropertyChangeMask);
+    XSelectInput(dpy, pr->win, PropertyChangeMask);
 
     ClientItem *c = &clients[client_count++];
-    c->win = cw;
+    c->win = pr->win;
+    c->frame = pr->frame;
     c->is_active = 0;
     c->skip_taskbar = 0;
-    c->icon = load_window_icon(cw, NIZAM_PANEL_ICON_PX);
-    if (!c->icon) c->icon = load_window_icon_hint(cw, NIZAM_PANEL_ICON_PX);
-    if (!c->icon) {
-        char inst[64], klass[64], icon_name[256];
-        get_window_class(cw, inst, sizeof(inst), klass, sizeof(klass));
-        if (find_desktop_icon_for_class(inst, klass, icon_name, sizeof(icon_name))) {
-            c->icon = load_icon_from_name(icon_name, NIZAM_PANEL_ICON_PX);
+    c->dirty = 0;
+    c->icon = load_client_icon(pr->win, pr->inst, pr->klass);
+    snprintf(c->title, sizeof(c->title), "%s", pr->title[0] ? pr->title : "(untitled)");
+    return 1;
+}
+
+static int merge_client_batch(const Window *wins, unsigned long n) {
+    int slots = 0;
+    int nprobe = 0;
+    for (unsigned long i = 0; i < n && slots < MAX_WINDOWS; i++) {
+        slot_frames[slots] = wins[i];
+        int prev = find_prev_client(wins[i]);
+        if (prev >= 0 && !(prev_clients[prev].dirty & CLIENT_DIRTY_REPROBE)) {
+            slot_probe[slots] = -1;
+        } else {
+            probes[nprobe].frame = wins[i];
+            slot_probe[slots] = nprobe++;
         }
+        slots++;
     }
-    get_window_title(cw, c->title, sizeof(c->title));
-    if (c->title[0] == '\0') strcpy(c->title, "(untitled)");
+
+    probe_clients(probes, nprobe);
+
+    int added = 0;
+    for (int i = 0; i < slots; i++) {
+        if (slot_probe[i] < 0) {
+            int idx = find_prev_client(slot_frames[i]);
+            if (idx >= 0) adopt_prev_client(idx);
+        } else {
+            const ClientProbe *pr = &probes[slot_probe[i]];
+            int idx = find_prev_client(slot_frames[i]);
+            if (idx < 0) {
+                added += add_probed_client(pr);
+            } else if (pr->include) {
+                prev_clients[idx].dirty &= ~CLIENT_DIRTY_REPROBE;
+                adopt_prev_client(idx);
+            }
+        }
+    }
+    return added;
+}
+
+static int merge_clients(const Window *wins, unsigned long n) {
+    int added = 0;
+    for (unsigned long start = 0; start < n && client_count < MAX_WINDOWS; start += MAX_WINDOWS) {
+        unsigned long batch = n - start;
+        if (batch > MAX_WINDOWS) batch = MAX_WINDOWS;
+        added += merge_client_batch(wins + start, batch);
+    }
+    return added;
 }
 
-static void append_clients_from_tree(void) {
+static int append_clients_from_tree(void) {
     Window root_ret, parent_ret;
     Window *children = NULL;
     unsigned int nchildren = 0;
+    x_roundtrips++;
     if (!XQueryTree(dpy, root, &root_ret, &parent_ret, &children, &nchildren)) {
-        return;
-    }
-    for (unsigned int i = 0; i < nchildren && client_count < MAX_WINDOWS; i++) {
-        add_client(children[i]);
+        return 0;
     }
+    int added = merge_clients(children, nchildren);
     if (children) XFree(children);
+    return added;
+}
+
+static int same_client_order(int prev_count) {
+    if (client_count != prev_count) return 0;
+    for (int i = 0; i < client_count; i++) {
+        if (clients[i].win != prev_order[i]) return 0;
+    }
+    return 1;
 }
 
-void tasklist_update_clients(void) {
-    free_client_icons();
+int tasklist_update_clients(void) {
+    prev_client_count = client_count;
+    memcpy(prev_clients, clients, sizeof(ClientItem) * (size_t)client_count);
+    for (int i = 0; i < client_count; i++) prev_order[i] = clients[i].win;
     client_count = 0;
-    
 
+    int added = 0;
+    int have_list = 0;
     Atom type;
     int fmt;
     unsigned long nitems, bytes;
     unsigned char *data = NULL;
+    x_roundtrips++;
     if (XGetWindowProperty(dpy, root, A_NET_CLIENT_LIST, 0, 4096, False, XA_WINDOW,
-                           &type, &fmt, &nitems, &bytes, &data) != Success) {
-        return;
+                           &type, &fmt, &nitems, &bytes, &data) == Success &&
+        data && type == XA_WINDOW) {
+        have_list = 1;
+        added += merge_clients((Window *)data, nitems);
     }
-    if (!data || type != XA_WINDOW) {
-        if (data) XFree(data);
-        return;
+    if (data) XFree(data);
+
+    if (!have_list) added += append_clients_from_tree();
+
+    int removed = 0;
+    for (int i = 0; i < prev_client_count; i++) {
+        if (prev_clients[i].win == None) continue;
+        if (prev_clients[i].icon) cairo_surface_destroy(prev_clients[i].icon);
+        prev_clients[i].icon = NULL;
+        removed++;
     }
 
-    Window *wins = (Window *)data;
-    for (unsigned long i = 0; i < nitems && client_count < MAX_WINDOWS; i++) {
-        add_client(wins[i]);
+    int changed = added > 0 || removed > 0 || !same_client_order(prev_client_count);
+    prev_client_count = 0;
+
+    tasklist_update_active();
+    if (changed) {
+        debug_log("nizam-panel: tasklist +%d -%d kept=%d\n", added, removed, client_count - added);
     }
-    XFree(data);
+    return changed;
+}
 
-    append_clients_from_tree();
+int tasklist_handle_property(Window w, Atom atom) {
+    int flag = 0;
+    if (atom == A_NET_WM_NAME || atom == XA_WM_NAME) flag = CLIENT_DIRTY_TITLE;
+    else if (atom == A_NET_WM_ICON) flag = CLIENT_DIRTY_ICON;
+    else if (atom == A_NET_WM_STATE || atom == A_NET_WM_WINDOW_TYPE || atom == A_WM_STATE) flag = CLIENT_DIRTY_REPROBE;
+    else return 0;
 
-    
-    data = NULL;
-    if (XGetWindowProperty(dpy, root, A_NET_ACTIVE_WINDOW, 0, 1, False, XA_WINDOW,
-                           &type, &fmt, &nitems, &bytes, &data) == Success) {
-        if (data && nitems == 1) {
-            Window aw = *((Window *)data);
-            if (aw != None && aw != 0) {
-                for (int i = 0; i < client_count; i++) {
-                    if (clients[i].win == aw) clients[i].is_active = 1;
-                }
+    for (int i = 0; i < client_count; i++) {
+        if (clients[i].win != w) continue;
+        clients[i].dirty |= flag;
+        return flag;
+    }
+    return 0;
+}
+
+int tasklist_refresh_dirty(void) {
+    int n = 0;
+    for (int i = 0; i < client_count; i++) {
+        ClientItem *c = &clients[i];
+        if (!c->dirty) continue;
+        if (c->dirty & CLIENT_DIRTY_TITLE) {
+            char old_title[sizeof(c->title)];
+            memcpy(old_title, c->title, sizeof(old_title));
+            load_client_title(c);
+            if (strcmp(old_title, c->title) == 0) c->dirty &= ~CLIENT_DIRTY_TITLE;
+        }
+        if (c->dirty & CLIENT_DIRTY_ICON) {
+            cairo_surface_t *icon = load_client_icon(c->win, NULL, NULL);
+            if (icon || !c->icon) {
+                if (c->icon) cairo_surface_destroy(c->icon);
+                c->icon = icon;
+            } else {
+                c->dirty &= ~CLIENT_DIRTY_ICON;
             }
         }
+        if (c->dirty) n++;
     }
-    if (data) XFree(data);
+    return n;
 }
 
-void tasklist_update_active(void) {
-    for (int i = 0; i < client_count; i++) clients[i].is_active = 0;
-
+int tasklist_update_active(void) {
+    Window aw = None;
     Atom type;
     int fmt;
     unsigned long nitems, bytes;
     unsigned char *data = NULL;
+    x_roundtrips++;
     if (XGetWindowProperty(dpy, root, A_NET_ACTIVE_WINDOW, 0, 1, False, XA_WINDOW,
                            &type, &fmt, &nitems, &bytes, &data) == Success) {
-        if (data && nitems == 1) {
-            Window aw = *((Window *)data);
-            if (aw != None && aw != 0) {
-                for (int i = 0; i < client_count; i++) {
-                    if (clients[i].win == aw) clients[i].is_active = 1;
-                }
-            }
-        }
+        if (data && nitems == 1) aw = *((Window *)data);
     }
     if (data) XFree(data);
-}
-
-void tasklist_draw(void) {
-    if (!settings.taskbar_enabled) return;
 
+    int changed = 0;
     for (int i = 0; i < client_count; i++) {
-        if (task_rects[i].w <= 0) continue;
-        const char *bg = clients[i].is_active ? color_active : color_bg;
-        const char *fg = clients[i].is_active ? color_active_text : color_fg;
-        (void)bg;
-        if (clients[i].icon) {
-            draw_icon(clients[i].icon, task_icon_rects[i].x, task_icon_rects[i].y, NIZAM_PANEL_ICON_PX);
-            draw_text_role(PANEL_TEXT_TITLE, clients[i].title, task_rects[i].x + 26, task_rects[i].y,
-                      task_rects[i].w - 32, task_rects[i].h, fg, 0, 0);
-        } else {
-            draw_text_role(PANEL_TEXT_TITLE, clients[i].title, task_rects[i].x + 6, task_rects[i].y,
-                      task_rects[i].w - 10, task_rects[i].h, fg, 0, 0);
-        }
+        int active = (aw != None && clients[i].win == aw);
+        if (clients[i].is_active == active) continue;
+        clients[i].is_active = active;
+        clients[i].dirty |= CLIENT_DIRTY_STATE;
+        changed = 1;
+    }
+    return changed;
+}
+
+void tasklist_draw_one(int i) {
+    if (!settings.taskbar_enabled || i < 0 || i >= client_count) return;
+    if (task_rects[i].w <= 0) return;
+    const char *fg = clients[i].is_active ? color_active_text : color_fg;
+    if (clients[i].icon) {
+        draw_icon(clients[i].icon, task_icon_rects[i].x, task_icon_rects[i].y, NIZAM_PANEL_ICON_PX);
+        draw_text_role(PANEL_TEXT_TITLE, clients[i].title, task_rects[i].x + 26, task_rects[i].y,
+                  task_rects[i].w - 32, task_rects[i].h, fg, 0, 0);
+    } else {
+        draw_text_role(PANEL_TEXT_TITLE, clients[i].title, task_rects[i].x + 6, task_rects[i].y,
+                  task_rects[i].w - 10, task_rects[i].h, fg, 0, 0);
     }
 }
 
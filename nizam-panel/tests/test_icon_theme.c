@@ -0,0 +1,72 @@
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "panel_shared.h"
+
+void debug_log(const char *fmt, ...) {
+    (void)fmt;
+}
+
+static void make_icon(const char *root, const char *name) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/icons", root);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/icons/hicolor", root);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/icons/hicolor/48x48", root);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/icons/hicolor/48x48/apps", root);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/icons/hicolor/48x48/apps/%s.png", root, name);
+    FILE *f = fopen(path, "w");
+    assert(f);
+    fclose(f);
+}
+
+static void remove_tree(const char *root) {
+    char cmd[1100];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", root);
+    assert(system(cmd) == 0);
+}
+
+int main(void) {
+    char common[] = "/tmp/nizam-panel-common-XXXXXX";
+    char home[] = "/tmp/nizam-panel-home-XXXXXX";
+    assert(mkdtemp(common));
+    assert(mkdtemp(home));
+
+    const char *name = "nizam-test-root-order";
+    make_icon(common, name);
+    char local[1100];
+    snprintf(local, sizeof(local), "%s/.local", home);
+    mkdir(local, 0700);
+    snprintf(local, sizeof(local), "%s/.local/share", home);
+    mkdir(local, 0700);
+    make_icon(local, name);
+
+    setenv("NIZAM_COMMON_DIR", common, 1);
+    setenv("HOME", home, 1);
+
+    char out[2048];
+    char want[2048];
+    assert(icon_theme_lookup(name, 48, out, sizeof(out)));
+    snprintf(want, sizeof(want), "%s/icons/hicolor/48x48/apps/%s.png", common, name);
+    assert(strcmp(out, want) == 0);
+
+    icon_theme_cleanup();
+    snprintf(want, sizeof(want), "%s/icons/hicolor/48x48/apps/%s.png", common, name);
+    unlink(want);
+    assert(icon_theme_lookup(name, 48, out, sizeof(out)));
+    snprintf(want, sizeof(want), "%s/.local/share/icons/hicolor/48x48/apps/%s.png", home, name);
+    assert(strcmp(out, want) == 0);
+
+    icon_theme_cleanup();
+    remove_tree(common);
+    remove_tree(home);
+    return 0;
+}